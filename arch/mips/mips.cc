@@ -35,10 +35,16 @@
  * updated to show the new state of the world. If for read, we
  * load the current value from memory into the register. If for
  * write, we mark the register as dirty (since it is getting a
- * new value).
+ * new value). A var given a register by the allocator is simply
+ * there, with no descriptor to update and no memory to touch.
  */
 Mips::Register Mips::GetRegister(Location *var, Reason reason,
                                  Register avoid1, Register avoid2) {
+  if (var->GetRegister() >= 0) {
+    Assert(var->GetRegister() < NumAllocatableRegs);
+    return Register(s0 + var->GetRegister());
+  }
+
   Register reg;
   if (!FindRegisterWithContents(var, reg)) {
     if (!FindRegisterWithContents(NULL, reg)) {
@@ -49,11 +55,10 @@ Mips::Register Mips::GetRegister(Location *var, Reason reason,
     // Load current value.
     if (reason == ForRead) {
       Assert(var->GetOffset() % 4 == 0); // all variables are 4 bytes
-      const char *offsetFromWhere = var->GetSegment() == fpRelative
-          ? regs[fp].name : regs[gp].name;
+      const char *offsetFromWhere = regs[BaseRegister(var)].name;
       Emit("lw %s, %d(%s)\t# load %s from %s%+d into %s", regs[reg].name,
-          var->GetOffset(), offsetFromWhere, var->GetName(),
-          offsetFromWhere, var->GetOffset(), regs[reg].name);
+          BaseOffset(var), offsetFromWhere, var->GetName(),
+          offsetFromWhere, BaseOffset(var), regs[reg].name);
       regs[reg].isDirty = false;
     }
   }
@@ -85,6 +90,15 @@ static bool LocationsAreSame(Location *var1, Location *var2) {
                  && var1->GetOffset() == var2->GetOffset()));
 }
 
+// The register var's address is relative to, and its offset from it.
+Mips::Register Mips::BaseRegister(Location *var) {
+  return var->GetSegment() == fpRelative ? frameReg : gp;
+}
+
+int Mips::BaseOffset(Location *var) {
+  return var->GetOffset() + (var->GetSegment() == fpRelative ? frameBias : 0);
+}
+
 /* Method: FindRegisterWithContents
  * --------------------------------
  * Searches the descriptors for one with contents var. Assigns
@@ -137,12 +151,11 @@ Mips::Register Mips::SelectRegisterToSpill(Register avoid1, Register avoid2) {
 void Mips::SpillRegister(Register reg) {
   Location *var = regs[reg].var;
   if (var && regs[reg].isDirty) {
-    const char *offsetFromWhere = var->GetSegment() == fpRelative
-        ? regs[fp].name : regs[gp].name;
+    const char *offsetFromWhere = regs[BaseRegister(var)].name;
     Assert(var->GetOffset() % 4 == 0); // all variables are 4 bytes in size
     Emit("sw %s, %d(%s)\t# spill %s from %s to %s%+d", regs[reg].name,
-       var->GetOffset(), offsetFromWhere, var->GetName(), regs[reg].name,
-       offsetFromWhere,var->GetOffset());
+       BaseOffset(var), offsetFromWhere, var->GetName(), regs[reg].name,
+       offsetFromWhere, BaseOffset(var));
   }
   regs[reg].var = NULL;
 }
@@ -151,10 +164,17 @@ void Mips::SpillRegister(Register reg) {
  * ------------------------------
  * Used before flow of control change (branch, label, jump, etc.) to
  * save contents of all dirty registers. This synchs the contents of
- * the registers with the memory locations for the variables.
+ * the registers with the memory locations for the variables. Operands
+ * of the current instruction that die with it have already been read
+ * by now and are just dropped.
  */
 void Mips::SpillAllDirtyRegisters() {
   Register i;
+  for (i = zero; i < NumRegs; i = Register(i + 1)) {
+    if (regs[i].var && IsDying(regs[i].var)) {
+      regs[i].var = NULL;
+    }
+  }
   for (i = zero; i < NumRegs; i = Register(i + 1)) {
     if (regs[i].var && regs[i].isDirty) {
       break;
@@ -190,11 +210,47 @@ void Mips::SpillForEndFunction() {
   }
 }
 
+/* Method: SetDeadOperands
+ * ------------------------
+ * Records the operands of the instruction about to be emitted whose
+ * values are not needed after it (see Instruction::GetDead).
+ */
+void Mips::SetDeadOperands(Location **vars, int n) {
+  dying = vars;
+  numDying = n;
+}
+
+bool Mips::IsDying(Location *var) {
+  for (int i = 0; i < numDying; i++) {
+    if (LocationsAreSame(var, dying[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Method: DiscardDeadOperands
+ * ---------------------------
+ * Once the instruction is emitted, empties the registers holding its
+ * dead operands without writing them back, so a temp that is computed
+ * and consumed within a block never touches its stack slot.
+ */
+void Mips::DiscardDeadOperands() {
+  for (Register i = zero; i < NumRegs; i = Register(i+1)) {
+    if (regs[i].isGeneralPurpose && regs[i].var && IsDying(regs[i].var)) {
+      regs[i].var = NULL;
+      regs[i].isDirty = false;
+    }
+  }
+  numDying = 0;
+}
+
 /* Method: Emit
  * ------------
  * General purpose helper used to emit assembly instructions in
  * a reasonable tidy manner.  Takes printf-style formatting strings
- * and variable arguments.
+ * and variable arguments.  Lines go through the peephole window on
+ * their way to the output file.
  */
 void Mips::Emit(const char *fmt, ...) {
   va_list args;
@@ -202,16 +258,11 @@ void Mips::Emit(const char *fmt, ...) {
   va_start(args, fmt);
   vsprintf(buf, fmt, args);
   va_end(args);
-  if (buf[strlen(buf) - 1] != ':') {
-    fprintf(kOutputFile, "\t"); // don't tab in labels
-  }
-  if (buf[0] != '#') {
-    fprintf(kOutputFile, "  ");   // outdent comments a little
-  }
-  fprintf(kOutputFile, "%s", buf);
-  if (buf[strlen(buf)-1] != '\n') {
-    fprintf(kOutputFile, "\n"); // end with a newline
-  }
+  peephole.Append(buf);
+}
+
+void Mips::Flush() {
+  peephole.Flush();
 }
 
 /* Method: EmitLoadConstant
@@ -228,18 +279,21 @@ void Mips::EmitLoadConstant(Location *dst, int val) {
 
 /* Method: EmitLoadStringConstant
  * ------------------------------
- * Used to assign a variable a pointer to string constant. Emits
- * assembly directives to create a new null-terminated string in the
- * data segment and assigns it a unique label. Slaves dst into a register
- * and loads that label address into the register.
+ * Used to assign a variable a pointer to string constant. The first
+ * time a string is seen, emits assembly directives to create it as a
+ * null-terminated string in the data segment, word aligned for
+ * _StringEqual, under its label. Slaves dst into a register and loads
+ * that label address into the register.
  */
 void Mips::EmitLoadStringConstant(Location *dst, const char *str) {
-  static int strNum = 1;
-  char label[16];
-  sprintf(label, "_string%d", strNum++);
-  Emit(".data\t\t\t# create string constant marked with label");
-  Emit("%s: .asciiz %s", label, str);
-  Emit(".text");
+  bool isNew;
+  const char *label = StringLabel(str, &isNew);
+  if (isNew) {
+    Emit(".data\t\t\t# create string constant marked with label");
+    Emit(".align 2");
+    Emit("%s: .asciiz %s", label, str);
+    Emit(".text");
+  }
   EmitLoadLabel(dst, label);
 }
 
@@ -261,6 +315,9 @@ void Mips::EmitLoadLabel(Location *dst, const char *label) {
  */
 void Mips::EmitCopy(Location *dst, Location *src) {
   Register rSrc = GetRegister(src), rDst = GetRegisterForWrite(dst, rSrc);
+  if (rSrc == rDst) {
+    return;   // the allocator put both in the same register
+  }
   Emit("move %s, %s\t\t# copy value", regs[rDst].name, regs[rSrc].name);
 }
 
@@ -310,6 +367,44 @@ void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
      regs[rLeft].name, regs[rRight].name);
 }
 
+/* Method: EmitBinaryOp
+ * --------------------
+ * The immediate form: slaves the first operand and dst to registers and
+ * emits the instruction that takes imm in place of the second register,
+ * which the caller has checked with FitsImmediate.
+ */
+void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                        Location *op1, int imm) {
+  Assert(FitsImmediate(code, imm));
+  Register rLeft = GetRegister(op1);
+  Register rDst = GetRegisterForWrite(dst, rLeft);
+
+  Emit("%s %s, %s, %d\t", immediateName[code], regs[rDst].name,
+     regs[rLeft].name, imm);
+}
+
+/* Method: FitsImmediate
+ * ---------------------
+ * Arithmetic and slti sign-extend their 16-bit immediate, the logical
+ * instructions zero-extend it and shifts take a 5-bit amount.
+ */
+bool Mips::FitsImmediate(BinaryOp::OpCode code, int val) {
+  switch (code) {
+    case BinaryOp::Add:
+    case BinaryOp::Less:
+      return val >= -32768 && val <= 32767;
+    case BinaryOp::And:
+    case BinaryOp::Or:
+    case BinaryOp::Xor:
+      return val >= 0 && val <= 65535;
+    case BinaryOp::Shl:
+    case BinaryOp::Shr:
+      return val >= 0 && val <= 31;
+    default:
+      return false;
+  }
+}
+
 /* Method: EmitLabel
  * -----------------
  * Used to emit label marker. Before a label, we spill all registers since
@@ -348,14 +443,75 @@ void Mips::EmitIfZ(Location *test, const char *label) {
      test->GetName());
 }
 
+/* Method: EmitIfCompare
+ * ---------------------
+ * Used for a branch on a comparison of two variables, emitted as one
+ * of the compare-and-branch forms (blt, bge, etc.). As with IfZ, the
+ * operands are slaved to registers before spilling.
+ */
+void Mips::EmitIfCompare(BinaryOp::OpCode rel, Location *op1, Location *op2,
+                         const char *label) {
+  Register rLeft = GetRegister(op1);
+  Register rRight = GetRegister(op2, rLeft);
+  SpillAllDirtyRegisters();
+  Assert(branchName[rel] != NULL);
+  Emit("%s %s, %s, %s\t# branch if %s %s %s", branchName[rel],
+       regs[rLeft].name, regs[rRight].name, label, op1->GetName(),
+       BinaryOp::opName[rel], op2->GetName());
+}
+
+/* Method: EmitJumpTable
+ * ---------------------
+ * Lays out the target addresses as a table in the data segment and
+ * jumps through the index'th entry. Once everything is spilled no
+ * register but the index's holds anything, so two others are free
+ * for the address arithmetic.
+ */
+void Mips::EmitJumpTable(Location *index, const char *tableLabel,
+                         List<const char*> *targets) {
+  Register rIndex = GetRegister(index);
+  SpillAllDirtyRegisters();
+  Register rBase = rIndex == t0 ? t1 : t0;
+  Register rEntry = rIndex == t2 ? t3 : t2;
+  Emit(".data");
+  Emit(".align 2");
+  Emit("%s:\t\t# jump table", tableLabel);
+  for (int i = 0; i < targets->NumElements(); i++) {
+    Emit(".word %s", targets->Nth(i));
+  }
+  Emit(".text");
+  Emit("la %s, %s\t# load jump table", regs[rBase].name, tableLabel);
+  Emit("sll %s, %s, 2", regs[rEntry].name, regs[rIndex].name);
+  Emit("addu %s, %s, %s", regs[rEntry].name, regs[rBase].name,
+       regs[rEntry].name);
+  Emit("lw %s, 0(%s)\t# load target of case %s", regs[rEntry].name,
+       regs[rEntry].name, index->GetName());
+  Emit("jr %s\t\t# jump to case", regs[rEntry].name);
+}
+
 /* Method: EmitParam
  * -----------------
  * Used to push a parameter on the stack in anticipation of upcoming
  * function call. Decrements the stack pointer by 4. Slaves argument into
  * register and then stores contents to location just made at end of
- * stack.
+ * stack. An argument passed in a register is instead copied there,
+ * straight from memory if it is not already in one. Nothing else
+ * uses the argument registers, so they hold until the call.
  */
-void Mips::EmitParam(Location *arg) {
+void Mips::EmitParam(Location *arg, int argReg) {
+  if (argReg >= 0) {
+    Assert(argReg < NumArgRegs);
+    Register dst = Register(a0 + argReg), src;
+    if (arg->GetRegister() >= 0 || FindRegisterWithContents(arg, src)) {
+      Emit("move %s, %s\t\t# pass %s in %s", regs[dst].name,
+           regs[GetRegister(arg)].name, arg->GetName(), regs[dst].name);
+    } else {
+      Emit("lw %s, %d(%s)\t# pass %s in %s", regs[dst].name,
+           BaseOffset(arg), regs[BaseRegister(arg)].name, arg->GetName(),
+           regs[dst].name);
+    }
+    return;
+  }
   Emit("subu $sp, $sp, 4\t# decrement sp to make space for param");
   Register reg = GetRegister(arg);
   Emit("sw %s, 4($sp)\t# copy param value to stack", regs[reg].name);
@@ -412,9 +568,10 @@ void Mips::EmitPopParams(int bytes) {
  * consistency, see comments at SpillForEndFunction above). We also
  * do the last part of the callee's job in function call protocol,
  * which is to remove our locals/temps from the stack, remove
- * saved registers ($fp and $ra) and restore previous values of
- * $fp and $ra so everything is returned to the state we entered.
- * We then emit jr to jump to the saved $ra.
+ * saved registers ($fp, $ra and any $s registers the allocator used)
+ * and restore previous values so everything is returned to the
+ * state we entered. We then emit jr to jump to the saved $ra. A leaf
+ * saved neither, so it just pops its frame.
  */
 void Mips::EmitReturn(Location *returnVal) {
   if (returnVal != NULL) {
@@ -422,6 +579,18 @@ void Mips::EmitReturn(Location *returnVal) {
        regs[GetRegister(returnVal)].name);
   }
   SpillForEndFunction();
+  for (int i = 0, n = 0; i < NumAllocatableRegs; i++) {
+    if (savedRegs & (1 << i)) {
+      Emit("lw %s, %d(%s)\t# restore saved %s", regs[s0 + i].name,
+           SavedRegisterOffset(n++) + frameBias, regs[frameReg].name,
+           regs[s0 + i].name);
+    }
+  }
+  if (leaf) {
+    Emit("addiu $sp, $sp, %d\t# pop leaf frame off stack", frameBias);
+    Emit("jr $ra\t\t# return from function");
+    return;
+  }
   Emit("move $sp, $fp\t\t# pop callee frame off stack");
   Emit("lw $ra, -4($fp)\t# restore saved ra");
   Emit("lw $fp, 0($fp)\t# restore saved fp");
@@ -434,19 +603,74 @@ void Mips::EmitReturn(Location *returnVal) {
  * upon entering a new function. We decrement the $sp to make space
  * and then save the current values of $fp and $ra (since we are
  * going to change them), then set up the $fp and bump the $sp down
- * to make space for all our locals/temps.
+ * to make space for all our locals/temps. Below those go the $s
+ * registers the allocator gave out (savedRegs is a mask of them).
+ * Parameters passed in argument registers are then stored to their
+ * slots, or moved to their $s registers, and stack parameters that
+ * live in a register are loaded into it. A leaf never changes $ra
+ * and is addressed from $sp, so it skips saving $ra and $fp.
  */
-void Mips::EmitBeginFunction(int stackFrameSize) {
+void Mips::EmitBeginFunction(int stackFrameSize, int saved,
+                             List<Location*> *regParams,
+                             List<Location*> *argParams, bool isLeaf) {
   Assert(stackFrameSize >= 0);
-  Emit("subu $sp, $sp, 8\t# decrement sp to make space to save ra, fp");
-  Emit("sw $fp, 8($sp)\t# save fp");
-  Emit("sw $ra, 4($sp)\t# save ra");
-  Emit("addiu $fp, $sp, 8\t# set up new fp");
-
-  if (stackFrameSize != 0) {
-    Emit("subu $sp, $sp, %d\t# decrement sp to make space for locals/temps",
-       stackFrameSize);
+  frameSize = stackFrameSize;
+  savedRegs = saved;
+  leaf = isLeaf;
+
+  int numSaved = 0;
+  for (int i = 0; i < NumAllocatableRegs; i++) {
+    if (savedRegs & (1 << i)) {
+      numSaved++;
+    }
   }
+  if (leaf) {
+    // Same layout, but $fp and $ra stay put and their slots unused.
+    frameReg = sp;
+    frameBias = 8 + stackFrameSize + 4 * numSaved;
+    Emit("subu $sp, $sp, %d\t# make space for leaf frame", frameBias);
+  } else {
+    frameReg = fp;
+    frameBias = 0;
+    Emit("subu $sp, $sp, 8\t# decrement sp to make space to save ra, fp");
+    Emit("sw $fp, 8($sp)\t# save fp");
+    Emit("sw $ra, 4($sp)\t# save ra");
+    Emit("addiu $fp, $sp, 8\t# set up new fp");
+    if (stackFrameSize + 4 * numSaved != 0) {
+      Emit("subu $sp, $sp, %d\t# decrement sp to make space for locals/temps",
+         stackFrameSize + 4 * numSaved);
+    }
+  }
+  for (int i = 0, n = 0; i < NumAllocatableRegs; i++) {
+    if (savedRegs & (1 << i)) {
+      Emit("sw %s, %d(%s)\t# save %s", regs[s0 + i].name,
+           SavedRegisterOffset(n++) + frameBias, regs[frameReg].name,
+           regs[s0 + i].name);
+    }
+  }
+  for (int i = 0; i < argParams->NumElements(); i++) {
+    Location *param = argParams->Nth(i);
+    if (param->GetRegister() >= 0) {
+      Emit("move %s, %s\t\t# param %s into its register",
+           regs[s0 + param->GetRegister()].name, regs[a0 + i].name,
+           param->GetName());
+    } else {
+      Emit("sw %s, %d(%s)\t# store param %s", regs[a0 + i].name,
+           BaseOffset(param), regs[frameReg].name, param->GetName());
+    }
+  }
+  for (int i = 0; i < regParams->NumElements(); i++) {
+    Location *param = regParams->Nth(i);
+    Emit("lw %s, %d(%s)\t# load param %s into its register",
+         regs[s0 + param->GetRegister()].name, BaseOffset(param),
+         regs[frameReg].name, param->GetName());
+  }
+}
+
+// The save area sits just below the function's locals and temps,
+// which start at $fp-8.
+int Mips::SavedRegisterOffset(int n) {
+  return -8 - frameSize - 4 * n;
 }
 
 /* Method: EmitEndFunction
@@ -491,7 +715,7 @@ void Mips::EmitPreamble() {
 
 /* Method: NameForTac
  * ------------------
- * Returns the appropriate MIPS instruction (add, seq, etc.) for
+ * Returns the appropriate MIPS instruction (addu, seq, etc.) for
  * a given BinaryOp:OpCode (BinaryOp::Add, BinaryOp:Equals, etc.).
  * Asserts if asked for name of an unset/out of bounds code.
  */
@@ -507,19 +731,40 @@ const char *Mips::NameForTac(BinaryOp::OpCode code) {
  * Constructor sets up the mips names and register descriptors to
  * the initial starting state.
  */
-Mips::Mips() {
-  mipsName[BinaryOp::Add] = "add";
-  mipsName[BinaryOp::Sub] = "sub";
+Mips::Mips() : peephole(kOutputFile, kPeepholeWindow) {
+  mipsName[BinaryOp::Add] = "addu";
+  mipsName[BinaryOp::Sub] = "subu";
   mipsName[BinaryOp::Mul] = "mul";
   mipsName[BinaryOp::Div] = "div";
   mipsName[BinaryOp::Mod] = "rem";
   mipsName[BinaryOp::Eq] = "seq";
+  mipsName[BinaryOp::NotEq] = "sne";
   mipsName[BinaryOp::Less] = "slt";
+  mipsName[BinaryOp::LessEq] = "sle";
+  mipsName[BinaryOp::Greater] = "sgt";
+  mipsName[BinaryOp::GreaterEq] = "sge";
   mipsName[BinaryOp::And] = "and";
   mipsName[BinaryOp::Or] = "or";
   mipsName[BinaryOp::Xor] = "xor";
   mipsName[BinaryOp::Shl] = "sllv";
   mipsName[BinaryOp::Shr] = "srlv";
+  mipsName[BinaryOp::LessEqU] = "sleu";
+  mipsName[BinaryOp::GreaterU] = "sgtu";
+  immediateName[BinaryOp::Add] = "addiu";
+  immediateName[BinaryOp::Less] = "slti";
+  immediateName[BinaryOp::And] = "andi";
+  immediateName[BinaryOp::Or] = "ori";
+  immediateName[BinaryOp::Xor] = "xori";
+  immediateName[BinaryOp::Shl] = "sll";
+  immediateName[BinaryOp::Shr] = "srl";
+  branchName[BinaryOp::Eq] = "beq";
+  branchName[BinaryOp::NotEq] = "bne";
+  branchName[BinaryOp::Less] = "blt";
+  branchName[BinaryOp::LessEq] = "ble";
+  branchName[BinaryOp::Greater] = "bgt";
+  branchName[BinaryOp::GreaterEq] = "bge";
+  branchName[BinaryOp::LessEqU] = "bleu";
+  branchName[BinaryOp::GreaterU] = "bgtu";
   regs[zero] = (RegContents){false, NULL, "$zero", false};
   regs[at] = (RegContents){false, NULL, "$at", false};
   regs[v0] = (RegContents){false, NULL, "$v0", false};
@@ -544,17 +789,25 @@ Mips::Mips() {
   regs[t7] = (RegContents){false, NULL, "$t7", true};
   regs[t8] = (RegContents){false, NULL, "$t8", true};
   regs[t9] = (RegContents){false, NULL, "$t9", true};
-  regs[s0] = (RegContents){false, NULL, "$s0", true};
-  regs[s1] = (RegContents){false, NULL, "$s1", true};
-  regs[s2] = (RegContents){false, NULL, "$s2", true};
-  regs[s3] = (RegContents){false, NULL, "$s3", true};
-  regs[s4] = (RegContents){false, NULL, "$s4", true};
-  regs[s5] = (RegContents){false, NULL, "$s5", true};
-  regs[s6] = (RegContents){false, NULL, "$s6", true};
-  regs[s7] = (RegContents){false, NULL, "$s7", true};
+  regs[s0] = (RegContents){false, NULL, "$s0", false};
+  regs[s1] = (RegContents){false, NULL, "$s1", false};
+  regs[s2] = (RegContents){false, NULL, "$s2", false};
+  regs[s3] = (RegContents){false, NULL, "$s3", false};
+  regs[s4] = (RegContents){false, NULL, "$s4", false};
+  regs[s5] = (RegContents){false, NULL, "$s5", false};
+  regs[s6] = (RegContents){false, NULL, "$s6", false};
+  regs[s7] = (RegContents){false, NULL, "$s7", false};
   lastUsed = zero;
+  dying = NULL;
+  numDying = 0;
+  frameSize = savedRegs = 0;
+  leaf = false;
+  frameReg = fp;
+  frameBias = 0;
 }
 
 const char *Mips::mipsName[BinaryOp::NumOps];
+const char *Mips::branchName[BinaryOp::NumOps];
+const char *Mips::immediateName[BinaryOp::NumOps];
 
 /* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -19,15 +19,33 @@
 #define _H_mips
 
 #include "decaf/list.h"
-#include "arch/mips/tac.h"
+#include "arch/mips/peephole.h"
+#include "codegen/emitter.h"
+#include "codegen/tac.h"
 
 class Location;
 
-class Mips {
+class Mips : public TargetEmitter {
  public:
   Mips();
 
-  static void Emit(const char *fmt, ...);
+  // Registers $s0-$s7 are kept out of the per-instruction pool and
+  // handed to the register allocator; a Location with register i
+  // lives in $s<i> for its whole function.
+  static const int NumAllocatableRegs = 8;
+
+  // Under the register calling convention the first arguments of a
+  // call go in $a0-$a3.
+  static const int NumArgRegs = 4;
+
+  int GetNumAllocatableRegs() { return NumAllocatableRegs; }
+  int GetNumArgRegs() { return NumArgRegs; }
+  bool FitsImmediate(BinaryOp::OpCode code, int val);
+
+  void Emit(const char *fmt, ...);
+
+  // Writes out the lines still held back for the peephole rules.
+  void Flush();
 
   void EmitLoadConstant(Location *dst, int val);
   void EmitLoadStringConstant(Location *dst, const char *str);
@@ -39,16 +57,24 @@ class Mips {
 
   void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
         Location *op1, Location *op2);
+  void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+        Location *op1, int imm);
 
   void EmitLabel(const char *label);
   void EmitGoto(const char *label);
   void EmitIfZ(Location *test, const char*label);
+  void EmitIfCompare(BinaryOp::OpCode rel, Location *op1, Location *op2,
+                     const char *label);
+  void EmitJumpTable(Location *index, const char *tableLabel,
+                     List<const char*> *targets);
   void EmitReturn(Location *returnVal);
 
-  void EmitBeginFunction(int frameSize);
+  void EmitBeginFunction(int frameSize, int savedRegs,
+                         List<Location*> *regParams,
+                         List<Location*> *argParams, bool leaf);
   void EmitEndFunction();
 
-  void EmitParam(Location *arg);
+  void EmitParam(Location *arg, int argReg);
   void EmitLCall(Location *result, const char* label);
   void EmitACall(Location *result, Location *fnAddr);
   void EmitPopParams(int bytes);
@@ -57,6 +83,11 @@ class Mips {
 
   void EmitPreamble();
 
+  // Brackets each instruction: vars are operands that are dead once
+  // it has executed, so their registers are dropped, not spilled.
+  void SetDeadOperands(Location **vars, int n);
+  void DiscardDeadOperands();
+
  private:
   typedef enum {
     zero, at, v0, v1, a0, a1, a2, a3,
@@ -74,6 +105,20 @@ class Mips {
 
   Register lastUsed;
 
+  Peephole peephole;
+
+  Location **dying;
+  int numDying;
+
+  // Frame of the function being emitted. Its variables are addressed
+  // from $fp, or in a leaf from $sp, frameBias bytes below where $fp
+  // would be.
+  int frameSize;
+  int savedRegs;
+  bool leaf;
+  Register frameReg;
+  int frameBias;
+
   typedef enum { ForRead, ForWrite } Reason;
 
   Register GetRegister(Location *var, Reason reason, Register avoid1,
@@ -86,10 +131,16 @@ class Mips {
   void SpillRegister(Register reg);
   void SpillAllDirtyRegisters();
   void SpillForEndFunction();
+  bool IsDying(Location *var);
+  int SavedRegisterOffset(int n);
+  Register BaseRegister(Location *var);
+  int BaseOffset(Location *var);
 
   void EmitCallInstr(Location *dst, const char *fn, bool isL);
 
   static const char *mipsName[BinaryOp::NumOps];
+  static const char *branchName[BinaryOp::NumOps];
+  static const char *immediateName[BinaryOp::NumOps];
   static const char *NameForTac(BinaryOp::OpCode code);
 };
 
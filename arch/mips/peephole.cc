@@ -0,0 +1,280 @@
+/* File: peephole.cc
+ * -----------------
+ * Implementation of Peephole.
+ */
+
+#include <string.h>
+
+#include "arch/mips/peephole.h"
+#include "decaf/utility.h"
+
+const char *Peephole::ruleName[NumRules] = {
+  "self move", "branch over nothing", "store then load", "move back",
+  "copy fold"
+};
+
+// Instructions whose first operand is the register they write.
+static const char *kWriteFirst[] = {
+  "li", "la", "lw", "move", "add", "addu", "addiu", "sub", "subu", "mul",
+  "div", "rem", "seq", "sne", "slt", "sle", "sgt", "sge", "sleu", "sgtu",
+  "slti", "and", "andi", "or", "ori", "xor", "xori", "sll", "sllv", "srl",
+  "srlv", NULL
+};
+
+// Instructions after which no $t register holds anything.
+static const char *kControl[] = {
+  "b", "j", "jr", "jal", "jalr", "beqz", "bnez", "beq", "bne", "blt",
+  "ble", "bgt", "bge", "bleu", "bgtu", NULL
+};
+
+static bool IsOneOf(const std::string &op, const char **names) {
+  for (int i = 0; names[i] != NULL; i++) {
+    if (op == names[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static std::string Trim(const std::string &s) {
+  size_t first = s.find_first_not_of(" \t\n");
+  if (first == std::string::npos) {
+    return "";
+  }
+  return s.substr(first, s.find_last_not_of(" \t\n") - first + 1);
+}
+
+Peephole::Peephole(FILE *o, int s) : out(o), size(s) {
+  for (int i = 0; i < NumRules; i++) {
+    numApplied[i] = 0;
+  }
+}
+
+/* Peephole::Parse
+ * ---------------
+ * Sorts a line into an instruction, a label, a directive or a
+ * comment, and splits an instruction into its opcode and operands.
+ * A label with something after it (_string1: .asciiz "...") is data.
+ */
+Peephole::Line Peephole::Parse(const char *text) {
+  Line line;
+  line.text = text;
+  std::string code = Trim(line.text);
+  if (code.empty() || code[0] == '#') {
+    line.kind = Comment;
+    return line;
+  }
+  if (code[0] == '.') {
+    line.kind = Directive;
+    return line;
+  }
+  size_t end = code.find_first_of(" \t");
+  std::string first = code.substr(0, end);
+  if (first[first.size() - 1] == ':') {
+    std::string rest = end == std::string::npos ? "" : Trim(code.substr(end));
+    line.kind = rest.empty() || rest[0] == '#' ? Label : Directive;
+    line.op = first.substr(0, first.size() - 1);
+    return line;
+  }
+
+  line.kind = Instr;
+  line.op = first;
+  std::string operands = end == std::string::npos ? "" : code.substr(end);
+  operands = operands.substr(0, operands.find('#'));
+  size_t start = 0;
+  while (start < operands.size()) {
+    size_t comma = operands.find(',', start);
+    if (comma == std::string::npos) {
+      comma = operands.size();
+    }
+    std::string arg = Trim(operands.substr(start, comma - start));
+    if (!arg.empty()) {
+      line.args.push_back(arg);
+    }
+    start = comma + 1;
+  }
+  return line;
+}
+
+std::string Peephole::Format(const std::string &op,
+                             const std::vector<std::string> &args) {
+  std::string text = op;
+  for (size_t i = 0; i < args.size(); i++) {
+    text += (i == 0 ? " " : ", ") + args[i];
+  }
+  return text;
+}
+
+bool Peephole::IsTemp(const std::string &reg) {
+  return reg.size() == 3 && reg[0] == '$' && reg[1] == 't' &&
+         reg[2] >= '0' && reg[2] <= '9';
+}
+
+bool Peephole::Writes(const Line &line, const std::string &reg) {
+  return line.kind == Instr && IsOneOf(line.op, kWriteFirst) &&
+         !line.args.empty() && line.args[0] == reg;
+}
+
+// Anything not known to write its first operand reads all of them.
+bool Peephole::Reads(const Line &line, const std::string &reg) {
+  if (line.kind != Instr) {
+    return false;
+  }
+  size_t first = IsOneOf(line.op, kWriteFirst) ? 1 : 0;
+  for (size_t i = first; i < line.args.size(); i++) {
+    const std::string &arg = line.args[i];
+    if (arg == reg || arg.find("(" + reg + ")") != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Peephole::EndsStraightLine(const Line &line) {
+  return line.kind == Label ||
+         (line.kind == Instr && IsOneOf(line.op, kControl));
+}
+
+// The index of the first instruction or label after i, -1 if the
+// window ends first.
+int Peephole::Next(int i) {
+  for (int j = i + 1; j < (int) window.size(); j++) {
+    if (window[j].kind == Instr || window[j].kind == Label) {
+      return j;
+    }
+  }
+  return -1;
+}
+
+bool Peephole::IsDeadAfter(const std::string &reg, int i) {
+  for (int j = Next(i); j >= 0; j = Next(j)) {
+    if (Reads(window[j], reg)) {
+      return false;
+    }
+    if (EndsStraightLine(window[j]) || Writes(window[j], reg)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Peephole::Remove(int i) {
+  window.erase(window.begin() + i);
+}
+
+/* Peephole::Rewrite
+ * -----------------
+ * Tries each rule on the oldest line in the window. Returns true if
+ * one fired, in which case the window has changed and the rules are
+ * worth trying again.
+ */
+bool Peephole::Rewrite() {
+  Line &front = window[0];
+  if (front.kind != Instr) {
+    return false;
+  }
+  const std::vector<std::string> &args = front.args;
+
+  if (front.op == "move" && args.size() == 2 && args[0] == args[1]) {
+    Remove(0);
+    numApplied[SelfMove]++;
+    return true;
+  }
+
+  if (front.op == "b" && args.size() == 1) {
+    for (int j = Next(0); j >= 0 && window[j].kind == Label; j = Next(j)) {
+      if (window[j].op == args[0]) {
+        Remove(0);
+        numApplied[BranchToNext]++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  int n = Next(0);
+  if (n < 0 || window[n].kind != Instr) {
+    return false;
+  }
+  Line &next = window[n];
+
+  if (front.op == "sw" && next.op == "lw" && args.size() == 2 &&
+      next.args.size() == 2 && args[1] == next.args[1]) {
+    if (next.args[0] == args[0]) {
+      Remove(n);
+    } else {
+      next.op = "move";
+      next.args[1] = args[0];
+      next.text = Format(next.op, next.args);
+    }
+    numApplied[StoreLoad]++;
+    return true;
+  }
+
+  if (front.op == "move" && next.op == "move" && args.size() == 2 &&
+      next.args.size() == 2 && next.args[0] == args[1] &&
+      next.args[1] == args[0]) {
+    Remove(n);
+    numApplied[MoveBack]++;
+    return true;
+  }
+
+  if (IsOneOf(front.op, kWriteFirst) && !args.empty() && IsTemp(args[0]) &&
+      next.op == "move" && next.args.size() == 2 &&
+      next.args[1] == args[0] && next.args[0] != args[0] &&
+      IsDeadAfter(args[0], n)) {
+    front.args[0] = next.args[0];
+    front.text = Format(front.op, front.args);
+    Remove(n);
+    numApplied[CopyFold]++;
+    return true;
+  }
+  return false;
+}
+
+void Peephole::Append(const char *text) {
+  window.push_back(Parse(text));
+  while (window.size() > size) {
+    while (size > 0 && !window.empty() && Rewrite()) {
+    }
+    if (!window.empty()) {
+      Write(window.front());
+      window.pop_front();
+    }
+  }
+}
+
+void Peephole::Flush() {
+  while (!window.empty()) {
+    while (!window.empty() && Rewrite()) {
+    }
+    if (!window.empty()) {
+      Write(window.front());
+      window.pop_front();
+    }
+  }
+  for (int i = 0; i < NumRules; i++) {
+    PrintDebug("peephole", "%s: %d", ruleName[i], numApplied[i]);
+  }
+}
+
+// Labels go in the margin and comments a little to the left of code.
+void Peephole::Write(const Line &line) {
+  const std::string &text = line.text;
+  if (text.empty()) {
+    fprintf(out, "\n");
+    return;
+  }
+  if (text[text.size() - 1] != ':') {
+    fprintf(out, "\t");
+  }
+  if (text[0] != '#') {
+    fprintf(out, "  ");
+  }
+  fprintf(out, "%s", text.c_str());
+  if (text[text.size() - 1] != '\n') {
+    fprintf(out, "\n");
+  }
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
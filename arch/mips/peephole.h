@@ -0,0 +1,89 @@
+/* File: peephole.h                                      -*- C++ -*-
+ * ----------------
+ * Peephole optimization of the MIPS assembly Mips emits.
+ *
+ * The backend translates one Tac instruction at a time, so the seams
+ * between translations leave sequences like
+ *
+ *     li $t0, 3           b _L4               sw $t0, -8($fp)
+ *     move $s1, $t0       _L4:                lw $t0, -8($fp)
+ *
+ * Rather than go straight to the output file, each line passes
+ * through a window of the last few.  Before the oldest line leaves
+ * the window, the rules are tried on it with the lines behind it as
+ * context:
+ *
+ *   - self move:   move r, r is dropped;
+ *   - branch over nothing:  b L right before L: is dropped;
+ *   - store then load:  lw r2, a right after sw r, a becomes move r2, r
+ *     or goes away when r2 is r;
+ *   - move back:   move b, a right after move a, b is dropped;
+ *   - copy fold:   an instruction writing $tN followed by move r, $tN
+ *     writes r itself, when $tN is not read again.
+ *
+ * $t registers only cache variables within a stretch of straight line
+ * code; the backend writes them back and forgets them at every label,
+ * branch and call.  So one is dead once it is overwritten or one of
+ * those is reached without a read in between.  Where the window ends
+ * before that is known, it is assumed live.  Comment lines are looked
+ * through; data directives are too, as they emit no code.
+ */
+
+#ifndef _H_peephole
+#define _H_peephole
+
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class Peephole {
+ public:
+  // Lines are written to out once size newer ones have followed
+  // them. A size of 0 writes them straight through.
+  Peephole(FILE *out, int size);
+
+  void Append(const char *line);
+
+  // Writes out what is left in the window and reports under the
+  // "peephole" debug key how many times each rule fired.
+  void Flush();
+
+ private:
+  typedef enum { Instr, Label, Directive, Comment } Kind;
+
+  struct Line {
+    std::string text;
+    Kind kind;
+    std::string op;                 // instructions only
+    std::vector<std::string> args;
+  };
+
+  typedef enum {
+    SelfMove, BranchToNext, StoreLoad, MoveBack, CopyFold, NumRules
+  } Rule;
+  static const char *ruleName[NumRules];
+
+  FILE *out;
+  size_t size;
+  std::deque<Line> window;
+  int numApplied[NumRules];
+
+  static Line Parse(const char *text);
+  static std::string Format(const std::string &op,
+                            const std::vector<std::string> &args);
+  static bool IsTemp(const std::string &reg);
+  static bool Writes(const Line &line, const std::string &reg);
+  static bool Reads(const Line &line, const std::string &reg);
+  static bool EndsStraightLine(const Line &line);
+
+  int Next(int i);
+  bool IsDeadAfter(const std::string &reg, int i);
+  bool Rewrite();
+  void Remove(int i);
+  void Write(const Line &line);
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_peephole */
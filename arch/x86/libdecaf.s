@@ -1,78 +1,616 @@
-// File: libdecaf.s
-// ================
-// Linux x86 Decaf standard library
-//
-// Note: this file is written in x86 assembly and specifically for Linux since
-// it uses the Linux system call numbers
-//
+# File: libdecaf.s
+# ================
+# Linux x86 Decaf standard library
+#
+# Note: this file is written in i386 assembly (AT&T syntax) and
+# specifically for Linux since it uses the Linux system call numbers
+# through int $0x80. There is no C library underneath; link with
+#
+#	as --32 -o libdecaf.o libdecaf.s
+#	ld -m elf_i386 -o prog prog.o libdecaf.o
+#
 
 	.text
 
-// Standard startup code.  Invoke the routine "main" with arguments:
-//	main(argc, argv, envp)
-//
-	.globl __start
-__start:
-	// FIXME Invoke main
-
-	//  From here down is the standard library which is linked into all
-	//  programs. It contains the assembly for the built-in library
-	//  functions (Print, Read, Alloc)
-	//  Where possible built-ins are frameless (don't set up fp, etc.)
-	//  Each expects args to be in $sp + 4, +8, etc.
-	//  Return value (if any) assigned to v0
-	//  May trash a0-a3 registers, uses no others
-
-
-	//  Library function ptr = Alloc(int size)
-	//  -----------------------------------------
-	//  Used for New and NewArray.
-	//  Allocates space in heap and returns address in $v0
+# Standard startup code.  Route faults to _Fault, on a stack of its
+# own so a runaway recursion can still be reported, then invoke the
+# routine "main" and exit with status 0 when it returns.
+#
+	.globl _start
+_start:
+	movl $186, %eax			# 186 is code for sigaltstack syscall
+	movl $.LFaultStack, %ebx
+	xorl %ecx, %ecx
+	int $0x80
+	movl $67, %eax			# 67 is code for sigaction syscall
+	movl $11, %ebx			# SIGSEGV
+	movl $.LFaultAction, %ecx
+	xorl %edx, %edx
+	int $0x80
+	movl $67, %eax
+	movl $8, %ebx			# SIGFPE
+	int $0x80
+	call main
+	jmp _Halt
+
+	#  From here down is the standard library which is linked into all
+	#  programs. It contains the assembly for the built-in library
+	#  functions (Print, Read, Alloc)
+	#  Built-ins are frameless (don't set up ebp, etc.)
+	#  Each expects args to be at 4(%esp), 8(%esp), etc.
+	#  Return value (if any) assigned to %eax
+	#  May trash %ecx and %edx, preserves %ebx, %esi, %edi and %ebp
+
+
+	#  Library function ptr = Alloc(int size)
+	#  -----------------------------------------
+	#  Used for New and NewArray.
+	#  Allocates space in heap and returns address in %eax. Requests up
+	#  to 2048 bytes are rounded up to a size class: every word up to
+	#  128 bytes, then 256, 512, 1024 and 2048. Each class hands out
+	#  slots from its own 4096-byte chunk of the heap by bumping a
+	#  pointer; larger requests are carved from the heap directly.
 	.globl _Alloc
 _Alloc:
+	movl 4(%esp), %eax		# get number of bytes
+	addl $3, %eax			# round up to a whole word
+	andl $-4, %eax
+	jnz .LASized
+	movl $4, %eax			# empty requests still get a slot
+.LASized:
+	cmpl $128, %eax
+	ja .LAMid
+	leal _AllocClasses(,%eax,4), %ecx	# entries are 16 bytes
+.LABump:				# %eax slot size, %ecx class
+	movl (%ecx), %edx		# next free slot of the class
+	addl %edx, %eax
+	cmpl 4(%ecx), %eax		# past the end of its chunk?
+	ja .LARefill
+	movl %eax, (%ecx)
+	movl %edx, %eax
+	ret
+.LAMid:
+	cmpl $2048, %eax
+	ja .LALarge
+	leal _AllocClasses+528, %ecx	# class 33 is the 256 byte one
+	movl $256, %edx
+.LAMidNext:
+	cmpl %edx, %eax
+	jbe .LAMidFound
+	addl $16, %ecx
+	addl %edx, %edx
+	jmp .LAMidNext
+.LAMidFound:
+	movl %edx, %eax			# the slot is the whole class size
+	jmp .LABump
+.LALarge:
+	pushl %eax
+	call _ACarve
+	addl $4, %esp
+	ret
+.LARefill:
+	pushl %ecx
+	pushl $4096			# take a new chunk for the class
+	call _ACarve
+	addl $4, %esp
+	popl %ecx
+	movl 12(%ecx), %edx		# the slot after the first is next
+	addl %eax, %edx
+	movl %edx, (%ecx)
+	leal 4096(%eax), %edx
+	movl %edx, 4(%ecx)
+	ret
 
+	#  Takes as many bytes as its argument off the heap and returns
+	#  their address in %eax. The heap is grown with brk, 64K beyond
+	#  the request at a time; memory fresh from the kernel is zeroed.
+_ACarve:
+	movl _heapNext, %eax
+	testl %eax, %eax
+	jnz .LACHaveHeap
+	pushl %ebx
+	movl $45, %eax			# 45 is code for brk syscall
+	xorl %ebx, %ebx			# brk(0) gives the current break
+	int $0x80
+	popl %ebx
+	movl %eax, _heapNext
+	movl %eax, _heapEnd
+.LACHaveHeap:
+	movl 4(%esp), %edx
+	addl %eax, %edx			# new top of heap
+	cmpl _heapEnd, %edx
+	ja .LACGrow
+	movl %edx, _heapNext
+	ret
+.LACGrow:
+	pushl %ebx
+	leal 65536(%edx), %ebx		# grow by the request and then some
+	movl $45, %eax
+	int $0x80
+	cmpl %ebx, %eax			# brk returns the old break on failure
+	jb .LAFail
+	movl %eax, _heapEnd
+	movl _heapNext, %eax
+	movl %edx, _heapNext
+	popl %ebx
+	ret
+.LAFail:
+	pushl $.LMemErrStr		# print error message
+	call _PrintString
+	addl $4, %esp
+	jmp _Halt
 
-	//  Library function PrintInt(int n)
-	//  --------------------------------
-	//  Prints number given as argument to console
+	#  Size classes: next free slot, end of the chunk, a spare word,
+	#  and the slot size. Code the compiler inlines for New indexes
+	#  this table by size / 4 and bumps the first word itself;
+	#  CodeGenerator::MaxInlineAllocSize and the AllocClass constants
+	#  in codegen/codegen.h describe this layout.
+	.data
+	.align 4
+	.globl _AllocClasses
+_AllocClasses:	.long 0, 0, 0, 0
+	.long 0, 0, 0, 4
+	.long 0, 0, 0, 8
+	.long 0, 0, 0, 12
+	.long 0, 0, 0, 16
+	.long 0, 0, 0, 20
+	.long 0, 0, 0, 24
+	.long 0, 0, 0, 28
+	.long 0, 0, 0, 32
+	.long 0, 0, 0, 36
+	.long 0, 0, 0, 40
+	.long 0, 0, 0, 44
+	.long 0, 0, 0, 48
+	.long 0, 0, 0, 52
+	.long 0, 0, 0, 56
+	.long 0, 0, 0, 60
+	.long 0, 0, 0, 64
+	.long 0, 0, 0, 68
+	.long 0, 0, 0, 72
+	.long 0, 0, 0, 76
+	.long 0, 0, 0, 80
+	.long 0, 0, 0, 84
+	.long 0, 0, 0, 88
+	.long 0, 0, 0, 92
+	.long 0, 0, 0, 96
+	.long 0, 0, 0, 100
+	.long 0, 0, 0, 104
+	.long 0, 0, 0, 108
+	.long 0, 0, 0, 112
+	.long 0, 0, 0, 116
+	.long 0, 0, 0, 120
+	.long 0, 0, 0, 124
+	.long 0, 0, 0, 128
+	.long 0, 0, 0, 256
+	.long 0, 0, 0, 512
+	.long 0, 0, 0, 1024
+	.long 0, 0, 0, 2048
+_heapNext:	.long 0			# next free byte, 0 until first Alloc
+_heapEnd:	.long 0			# current break
+.LMemErrStr:	.asciz "Allocate failed: out of memory"
+	.text
+
+
+	#  Output is kept in _outBuf and written out with one write
+	#  when it fills, before the program reads input, and when it
+	#  halts. _outLen bytes of it are in use.
+	.data
+_outLen:	.long 0
+_outBuf:	.space 4096
+_outDigits:	.space 12		# an int in decimal, sign and null
+.LTrueStr:	.asciz "true"		# string constants for true/false
+.LFalseStr:	.asciz "false"
+	.text
+
+	#  Appends the string at %eax to the output. Trashes %eax, %ecx
+	#  and %edx.
+_OutStr:
+	movl _outLen, %edx
+.LOSNext:
+	movb (%eax), %cl
+	testb %cl, %cl
+	jz .LOSDone
+	cmpl $4096, %edx
+	jne .LOSPut
+	movl %edx, _outLen		# full: write it out and start over
+	pushl %eax
+	call _OutFlush
+	popl %eax
+	xorl %edx, %edx
+	movb (%eax), %cl
+.LOSPut:
+	movb %cl, _outBuf(%edx)
+	incl %eax
+	incl %edx
+	jmp .LOSNext
+.LOSDone:
+	movl %edx, _outLen
+	ret
+
+	#  Appends the int in %eax to the output, in decimal. Trashes
+	#  %eax, %ecx and %edx.
+_OutInt:
+	pushl %ebx
+	pushl %esi
+	movl %eax, %esi			# remember the sign
+	testl %eax, %eax
+	jns .LOIPositive
+	negl %eax			# INT_MIN stays put, but divides right
+.LOIPositive:				# as unsigned
+	movl $_outDigits+11, %ecx	# digits are built backwards from
+	movb $0, (%ecx)			# the null
+	movl $10, %ebx
+.LOIDigit:
+	xorl %edx, %edx
+	divl %ebx
+	addl $48, %edx			# '0'
+	decl %ecx
+	movb %dl, (%ecx)
+	testl %eax, %eax
+	jnz .LOIDigit
+	testl %esi, %esi
+	jns .LOIDone
+	decl %ecx
+	movb $45, (%ecx)		# '-'
+.LOIDone:
+	movl %ecx, %eax
+	popl %esi
+	popl %ebx
+	jmp _OutStr
+
+	#  Appends true or false to the output as %eax is. Trashes %eax,
+	#  %ecx and %edx.
+_OutBool:
+	testl %eax, %eax
+	movl $.LTrueStr, %eax
+	jnz _OutStr
+	movl $.LFalseStr, %eax
+	jmp _OutStr
+
+	#  Writes out the output kept so far. Trashes %eax, %ecx and %edx.
+_OutFlush:
+	movl _outLen, %edx
+	testl %edx, %edx
+	jz .LOFDone
+	pushl %ebx
+	movl $4, %eax			# 4 is code for write syscall
+	movl $1, %ebx			# to stdout
+	movl $_outBuf, %ecx
+	int $0x80
+	popl %ebx
+	movl $0, _outLen
+.LOFDone:
+	ret
+
+
+	#  Library function PrintInt(int n)
+	#  --------------------------------
+	#  Prints number given as argument to console
 	.globl _PrintInt
 _PrintInt:
+	movl 4(%esp), %eax
+	jmp _OutInt
 
 
-	//  Library function PrintBool(bool b)
-	//  ----------------------------------
-	//  Prints true/false value given to console
+	#  Library function PrintBool(bool b)
+	#  ----------------------------------
+	#  Prints true/false value given to console
 	.globl _PrintBool
 _PrintBool:
+	movl 4(%esp), %eax
+	jmp _OutBool
+
 
 	#  Library function PrintString(address str)
 	#  -----------------------------------------
 	#  Prints string located at the address to console
 	.globl _PrintString
 _PrintString:
+	movl 4(%esp), %eax
+	jmp _OutStr
+
+
+	#  Library function Print(address kinds, ...)
+	#  ------------------------------------------
+	#  Prints the arguments after kinds, one for each of its letters:
+	#  i for an int, b for a bool and s for a string. The compiler
+	#  calls it for a Print statement of several arguments.
+	.globl _Print
+_Print:
+	pushl %esi
+	pushl %edi
+	movl 12(%esp), %esi		# next kind
+	leal 16(%esp), %edi		# its argument
+.LPNext:
+	movzbl (%esi), %ecx
+	testl %ecx, %ecx
+	jz .LPDone
+	incl %esi
+	movl (%edi), %eax
+	addl $4, %edi
+	cmpl $105, %ecx			# 'i'
+	je .LPInt
+	cmpl $98, %ecx			# 'b'
+	je .LPBool
+	call _OutStr
+	jmp .LPNext
+.LPInt:
+	call _OutInt
+	jmp .LPNext
+.LPBool:
+	call _OutBool
+	jmp .LPNext
+.LPDone:
+	popl %edi
+	popl %esi
+	ret
+
+
+	#  Input is read 4096 bytes at a time into _inBuf, of which
+	#  _inNext up to _inEnd is still to be taken.
+	.data
+_inNext:	.long 0
+_inEnd:		.long 0
+_inBuf:		.space 4096
+	.text
+
+	#  Refills the input with a read syscall, returning in %eax the
+	#  bytes read, none at the end of input. Trashes %ecx and %edx.
+_InFill:
+	pushl %ebx
+	movl $3, %eax			# 3 is code for read syscall
+	xorl %ebx, %ebx			# from stdin
+	movl $_inBuf, %ecx
+	movl $4096, %edx
+	int $0x80
+	popl %ebx
+	movl $0, _inNext
+	movl $0, _inEnd
+	testl %eax, %eax		# stop at end of input or error
+	jle .LIFDone
+	movl %eax, _inEnd
+.LIFDone:
+	ret
+
+	#  Takes the next character of input into %eax, -1 at the end of
+	#  input. Trashes %ecx and %edx.
+_InChar:
+	movl _inNext, %ecx
+	cmpl _inEnd, %ecx
+	jne .LICHave
+	call _InFill
+	testl %eax, %eax
+	jle .LICEnd
+	xorl %ecx, %ecx
+.LICHave:
+	movzbl _inBuf(%ecx), %eax
+	incl %ecx
+	movl %ecx, _inNext
+	ret
+.LICEnd:
+	movl $-1, %eax
+	ret
+
 
 	#  Library function n = ReadInteger()
 	#  ----------------------------------
-	#  Reads a number from the console and returns it in $v0
+	#  Reads a line from the console and returns the number it starts
+	#  with (after any blanks and a sign) in %eax, 0 if none
 	.globl _ReadInteger
 _ReadInteger:
+	call _OutFlush			# show any prompt first
+	pushl %ebx
+	pushl %esi
+	xorl %ebx, %ebx			# 1 if negative
+	xorl %esi, %esi			# the number so far
+.LRIBlank:
+	call _InChar
+	cmpl $32, %eax			# ' '
+	je .LRIBlank
+	cmpl $9, %eax			# '\t'
+	je .LRIBlank
+	cmpl $45, %eax			# '-'
+	jne .LRIPlus
+	incl %ebx
+	jmp .LRINext
+.LRIPlus:
+	cmpl $43, %eax			# '+'
+	jne .LRIDigit
+.LRINext:
+	call _InChar
+.LRIDigit:
+	leal -48(%eax), %edx		# '0'
+	cmpl $9, %edx			# unsigned, so below '0' fails too
+	ja .LRIRest
+	imull $10, %esi
+	addl %edx, %esi
+	jmp .LRINext
+.LRIRest:
+	cmpl $10, %eax			# drop the rest of the line
+	je .LRISigned
+	testl %eax, %eax
+	js .LRISigned
+	call _InChar
+	jmp .LRIRest
+.LRISigned:
+	movl %esi, %eax
+	testl %ebx, %ebx
+	jz .LRIDone
+	negl %eax
+.LRIDone:
+	popl %esi
+	popl %ebx
+	ret
+
 
-  	#  Library function s = ReadLine()
+	#  Library function s = ReadLine()
 	#  -------------------------------
-	#  Reads a line from the console into heap-allocated buffer and
-	#  returns its address in $v0
+	#  Reads a line from the console, however long, and returns its
+	#  address in %eax, without the newline, in a heap string of just
+	#  its size. A line that runs past the input buffer is gathered
+	#  a buffer at a time, each time into a string long enough for
+	#  all of it so far.
 	.globl _ReadLine
 _ReadLine:
+	call _OutFlush			# show any prompt first
+	pushl %ebx
+	pushl %esi
+	pushl %edi
+	pushl %ebp
+	xorl %ebx, %ebx			# the line so far
+	xorl %esi, %esi			# its length
+.LRLChunk:
+	movl _inNext, %eax
+	cmpl _inEnd, %eax
+	jne .LRLScan
+	call _InFill
+	testl %eax, %eax
+	jle .LRLEnd
+	xorl %eax, %eax
+.LRLScan:
+	movl %eax, %ecx
+.LRLFind:
+	cmpl _inEnd, %ecx
+	je .LRLPart
+	cmpb $10, _inBuf(%ecx)		# '\n'
+	je .LRLLine
+	incl %ecx
+	jmp .LRLFind
+.LRLLine:
+	leal 1(%ecx), %edx		# take the piece and the newline
+	movl %edx, _inNext
+	movl $1, %ebp			# 1 if the piece ends the line
+	jmp .LRLTake
+.LRLPart:
+	movl %ecx, _inNext
+	xorl %ebp, %ebp
+.LRLTake:
+	leal _inBuf(%eax), %edi		# the piece, still in the buffer
+	subl %eax, %ecx			# and its length
+	pushl %ecx
+	leal 1(%esi,%ecx), %eax
+	pushl %eax
+	call _Alloc
+	addl $4, %esp
+	popl %ecx
+	movl %eax, %edx
+	pushl %edi
+	pushl %ecx
+	movl %esi, %ecx			# copy the line so far
+	movl %ebx, %esi
+	movl %edx, %edi
+	rep movsb
+	popl %ecx			# then the piece
+	popl %esi
+	rep movsb
+	movb $0, (%edi)
+	movl %edx, %ebx
+	movl %edi, %esi
+	subl %edx, %esi
+	testl %ebp, %ebp
+	jz .LRLChunk
+.LRLEnd:
+	testl %ebx, %ebx
+	jnz .LRLDone
+	pushl $1			# nothing before the end of input
+	call _Alloc
+	addl $4, %esp
+	movl %eax, %ebx
+.LRLDone:
+	movl %ebx, %eax
+	popl %ebp
+	popl %edi
+	popl %esi
+	popl %ebx
+	ret
+
 
 	#  Library function if (StringEqual(addr s, addr t)) ...
 	#  ----------------------------------------------------
 	#  Compares two strings for equality (case-sensitive)
-	#  returns true/false in $v0
+	#  returns true/false in %eax
+	#  The same string, as pooled literals often are, is equal at
+	#  once. Word-aligned strings are compared a word at a time up
+	#  to the word holding the null, or to a word that differs,
+	#  which the byte loop then finishes.
 	.globl _StringEqual
 _StringEqual:
+	movl 4(%esp), %ecx
+	movl 8(%esp), %edx
+	cmpl %ecx, %edx
+	je .LSEMatch
+	movl %ecx, %eax
+	orl %edx, %eax
+	testl $3, %eax
+	jnz .LSENext			# not both aligned: bytes only
+	pushl %ebx
+.LSEWord:
+	movl (%ecx), %eax		# load next 2 words
+	cmpl (%edx), %eax
+	jne .LSEBytes
+	leal -0x01010101(%eax), %ebx	# a null byte sets its top bit in
+	notl %eax			# (w - 0x01010101) & ~w & 0x80808080
+	andl %eax, %ebx
+	testl $0x80808080, %ebx
+	jnz .LSEWordMatch		# return true if the word ends them
+	addl $4, %ecx			# advance both by a word
+	addl $4, %edx
+	jmp .LSEWord
+.LSEWordMatch:
+	popl %ebx
+	jmp .LSEMatch
+.LSEBytes:
+	popl %ebx
+.LSENext:
+	movb (%ecx), %al		# load next 2 chars
+	cmpb (%edx), %al
+	jne .LSENoMatch			# return false if chars don't match
+	testb %al, %al
+	jz .LSEMatch			# return true if at null terminator
+	incl %ecx			# advance both by one
+	incl %edx
+	jmp .LSENext
+.LSENoMatch:
+	xorl %eax, %eax
+	ret
+.LSEMatch:
+	movl $1, %eax
+	ret
+
 
 	#  Library function Halt()
 	#  -----------------------
-	#  Exits process by calling the exit() syscall
+	#  Writes out the output, then exits process by calling the exit()
+	#  syscall
 	.globl _Halt
 _Halt:
+	call _OutFlush
+	movl $1, %eax			# 1 is code for exit syscall
+	xorl %ebx, %ebx
+	int $0x80
+
+
+	#  Fault handler
+	#  -------------
+	#  Runs on SIGSEGV (a null object, or the stack running out) and
+	#  SIGFPE (division by zero or of the least int by -1). Writes
+	#  out what the program printed, then the error, and exits with
+	#  status 1. The signal number is at 4(%esp).
+	.data
+.LFaultAction:	.long _Fault, 0, 0x08000000, 0	# handler, mask, SA_ONSTACK
+.LFaultStack:	.long .LFaultStackBase, 0, 8192	# base, flags, size
+.LFaultStackBase:	.space 8192
+.LSegvStr:	.asciz "Decaf runtime error: Bad memory access\n"
+.LFpeStr:	.asciz "Decaf runtime error: Division by zero or overflow\n"
+	.text
+_Fault:
+	movl $.LSegvStr, %eax
+	cmpl $11, 4(%esp)
+	je .LFReport
+	movl $.LFpeStr, %eax
+.LFReport:
+	call _OutStr
+	call _OutFlush
+	movl $1, %eax			# 1 is code for exit syscall
+	movl $1, %ebx			# with status 1
+	int $0x80
@@ -1,124 +1,55 @@
+/* File: x86.cc
+ * ------------
+ * Implementation of X86 class, which is responsible for TAC->i386
+ * translation.
+ *
+ * Each Tac instruction becomes a short load/compute/store sequence
+ * through %eax, %ecx and %edx, with memory operands used directly
+ * wherever the instruction set allows one. Nothing is cached in those
+ * registers from one instruction to the next, so labels, branches
+ * and calls need no spilling.
+ */
 
 #include <stdarg.h>
 #include <string.h>
-#include "x86.h"
-
-
-/* Method: GetRegister
- * -------------------
- * Given a location for a current var, a reason (ForRead or ForWrite)
- * and up to two registers to avoid, this method will assign
- * to a var to register trying these alternatives in order:
- *  1) if that var is already in a register ("same" is determined
- *     by matching name and same scope), we use that one
- *  2) find an empty register to use for the var
- *  3) find an in-use register that is not dirty.  We don't need
- *     to write value back to memory since it's clean, so we just
- *     replace with the new var
- *  4) spill an in-use, dirty register, by writing its contents to
- *     memory and then replace with the new var
- * For steps 3 & 4, we respect the registers given to avoid (ie the
- * other operands in this operation). The register descriptors are
- * updated to show the new state of the world. If for read, we
- * load the current value from memory into the register. If for
- * write, we mark the register as dirty (since it is getting a
- * new value).
- */
-X86::Register X86::GetRegister(Location *var, Reason reason,
-                               Register avoid1, Register avoid2)
-{
-  Register reg;
-
-    return reg;
-}
-
-// Two covers for the above method to make it slightly more
-// convenient to call it
-X86::Register X86::GetRegister(Location *var, Register avoid1)
-{
-  Register reg;
-
-    return reg;
-}
-
-X86::Register X86::GetRegisterForWrite(Location *var, Register avoid1,
-                                                     Register avoid2)
-{
-  Register reg;
-
-    return reg;
-}
-
-// Helper to check if two variable locations are one and the same
-// (same name, segment, and offset)
-static bool LocationsAreSame(Location *var1, Location *var2)
-{
-  return true;
-}
-
-/* Method: FindRegisterWithContents
- * --------------------------------
- * Searches the descriptors for one with contents var. Assigns
- * register by reference, and returns true/false on whether match found.
- */
-bool X86::FindRegisterWithContents(Location *var, Register& reg)
-{
-  return true;
-}
-
-/* Method: SelectRegisterToSpill
- * -----------------------------
- * Chooses an in-use register to replace with a new variable. We
- * prefer to replace a non-dirty once since we would not have to
- * write its contents back to memory, so the first loop searches
- * for a clean one. If none found, we take a dirty one.  In both
- * loops we deliberately won't choose either of the registers we
- * were asked to avoid.  We track the last dirty register spilled
- * and advance on each subsequent spill as a primitive means of
- * trying to not throw out things we just loaded and thus are likely
- * to need.
- */
-X86::Register X86::SelectRegisterToSpill(Register avoid1, Register avoid2)
-{
-  Register reg;
-
-  return reg;
-}
 
-/* Method: SpillRegister
- * ---------------------
- * "Empties" register.  If variable is currently slaved in this register
- * and its contents are out of synch with memory (isDirty), we write back
- * the current contents to memory. We then clear the descriptor so we
- * realize the register is empty.
- */
-void X86::SpillRegister(Register reg)
-{
-
-}
-
-/* Method: SpillAllDirtyRegisters
- * ------------------------------
- * Used before flow of control change (branch, label, jump, etc.) to
- * save contents of all dirty registers. This synchs the contents of
- * the registers with the memory locations for the variables.
- */
-void X86::SpillAllDirtyRegisters()
-{
+#include "arch/x86/x86.h"
+#include "decaf/utility.h"
 
-}
-
-/* Method: SpillForEndFunction
- * ---------------------------
- * Slight optimization on the above method used when spilling for
- * end of function (return/fall off). In such a case, we do not
- * need to save values for locals, temps, and parameters because the
- * function is about to exit and those variables are going away
- * immediately, so no need to bother with updating contents.
+/* Method: Operand
+ * ---------------
+ * Writes the AT&T operand that names var into buf and returns it: the
+ * register the allocator gave var, its slot off %ebp, or its place in
+ * the globals block.
  */
-void X86::SpillForEndFunction()
-{
-
+const char *X86::Operand(Location *var, char *buf) {
+  if (var->GetRegister() >= 0) {
+    Assert(var->GetRegister() < NumAllocatableRegs);
+    return regName[allocatable[var->GetRegister()]];
+  }
+  Assert(var->GetOffset() % 4 == 0); // all variables are 4 bytes
+  if (var->GetSegment() == fpRelative) {
+    sprintf(buf, "%d(%%ebp)", var->GetOffset() + 4);
+  } else {
+    Assert(var->GetSegment() == gpRelative);
+    sprintf(buf, "_globals+%d", var->GetOffset());
+    if (var->GetOffset() + 4 > globalsSize) {
+      globalsSize = var->GetOffset() + 4;
+    }
+  }
+  return buf;
+}
+
+// The register holding the address in var: its own if it has one,
+// otherwise scratch, loaded with it.
+X86::Register X86::BaseRegister(Location *var, Register scratch) {
+  if (var->GetRegister() >= 0) {
+    return allocatable[var->GetRegister()];
+  }
+  char buf[OperandSize];
+  Emit("movl %s, %s\t# load %s", Operand(var, buf), regName[scratch],
+       var->GetName());
+  return scratch;
 }
 
 /* Method: Emit
@@ -127,210 +58,354 @@ void X86::SpillForEndFunction()
  * a reasonable tidy manner.  Takes printf-style formatting strings
  * and variable arguments.
  */
-void X86::Emit(const char *fmt, ...)
-{
-
+void X86::Emit(const char *fmt, ...) {
+  va_list args;
+  char buf[1024];
+  va_start(args, fmt);
+  vsprintf(buf, fmt, args);
+  va_end(args);
+  if (buf[strlen(buf) - 1] != ':') {
+    fprintf(kOutputFile, "\t"); // don't tab in labels
+  }
+  if (buf[0] != '#') {
+    fprintf(kOutputFile, "  ");   // outdent comments a little
+  }
+  fprintf(kOutputFile, "%s", buf);
+  if (buf[strlen(buf)-1] != '\n') {
+    fprintf(kOutputFile, "\n"); // end with a newline
+  }
+}
+
+/* Method: Flush
+ * -------------
+ * The globals are one block in the bss, as big as the furthest of
+ * them any instruction mentioned.
+ */
+void X86::Flush() {
+  if (globalsSize > 0) {
+    Emit(".lcomm _globals, %d\t# global variables", globalsSize);
+  }
 }
 
 /* Method: EmitLoadConstant
  * ------------------------
- * Used to assign variable an integer constant value.  Slaves dst into
- * a register (using GetRegister above) and then emits an li (load
- * immediate) instruction with the constant value.
+ * Used to assign variable an integer constant value, which movl can
+ * store straight into its slot or register.
  */
-void X86::EmitLoadConstant(Location *dst, int val)
-{
-
+void X86::EmitLoadConstant(Location *dst, int val) {
+  char buf[OperandSize];
+  Emit("movl $%d, %s\t# load constant value %d into %s", val,
+       Operand(dst, buf), val, dst->GetName());
 }
 
 /* Method: EmitLoadStringConstant
  * ------------------------------
- * Used to assign a variable a pointer to string constant. Emits
- * assembly directives to create a new null-terminated string in the
- * data segment and assigns it a unique label. Slaves dst into a register
- * and loads that label address into the register.
+ * Used to assign a variable a pointer to string constant. The first
+ * time a string is seen, emits assembly directives to create it as a
+ * null-terminated, word-aligned string in the data segment under its
+ * label, whose address is then stored in dst.
  */
-void X86::EmitLoadStringConstant(Location *dst, const char *str)
-{
-
+void X86::EmitLoadStringConstant(Location *dst, const char *str) {
+  bool isNew;
+  const char *label = StringLabel(str, &isNew);
+  if (isNew) {
+    Emit(".data\t\t\t# create string constant marked with label");
+    Emit(".align 4");
+    Emit("%s: .asciz %s", label, str);
+    Emit(".text");
+  }
+  EmitLoadLabel(dst, label);
 }
 
 /* Method: EmitLoadLabel
  * ---------------------
- * Used to load a label (ie address in text/data segment) into a variable.
- * Slaves dst into a register and emits an la (load address) instruction
+ * Used to load a label (ie address in text/data segment) into a
+ * variable, as an immediate.
  */
-void X86::EmitLoadLabel(Location *dst, const char *label)
-{
-
+void X86::EmitLoadLabel(Location *dst, const char *label) {
+  char buf[OperandSize];
+  Emit("movl $%s, %s\t# load label", label, Operand(dst, buf));
 }
 
 /* Method: EmitCopy
  * ----------------
- * Used to copy the value of one variable to another.  Slaves both
- * src and dst into registers and then emits a move instruction to
- * copy the contents from src to dst.
+ * Used to copy the value of one variable to another. One movl does it
+ * if either is in a register, otherwise the value goes through %eax.
  */
-void X86::EmitCopy(Location *dst, Location *src)
-{
-
+void X86::EmitCopy(Location *dst, Location *src) {
+  char rDst[OperandSize], rSrc[OperandSize];
+  const char *to = Operand(dst, rDst), *from = Operand(src, rSrc);
+  if (strcmp(to, from) == 0) {
+    return;   // the allocator put both in the same register
+  }
+  if (dst->GetRegister() >= 0 || src->GetRegister() >= 0) {
+    Emit("movl %s, %s\t# copy value", from, to);
+    return;
+  }
+  Emit("movl %s, %%eax\t# copy value", from);
+  Emit("movl %%eax, %s", to);
 }
 
 /* Method: EmitLoad
  * ----------------
  * Used to assign dst the contents of memory at the address in reference,
  * potentially with some positive/negative offset (defaults to 0).
- * Slaves both ref and dst to registers, then emits a lw instruction
- * using constant-offset addressing mode y(rx) which accesses the address
- * at an offset of y bytes from the address currently contained in rx.
  */
-void X86::EmitLoad(Location *dst, Location *reference, int offset)
-{
-
+void X86::EmitLoad(Location *dst, Location *reference, int offset) {
+  char buf[OperandSize];
+  Register base = BaseRegister(reference, eax);
+  Emit("movl %d(%s), %%eax\t# load with offset", offset, regName[base]);
+  Emit("movl %%eax, %s", Operand(dst, buf));
 }
 
 /* Method: EmitStore
  * -----------------
- * Used to write value to  memory at the address in reference,
+ * Used to write value to memory at the address in reference,
  * potentially with some positive/negative offset (defaults to 0).
- * Slaves both ref and dst to registers, then emits a sw instruction
- * using constant-offset addressing mode y(rx) which writes to the address
- * at an offset of y bytes from the address currently contained in rx.
  */
-void X86::EmitStore(Location *reference, Location *value, int offset)
-{
-
+void X86::EmitStore(Location *reference, Location *value, int offset) {
+  Register base = BaseRegister(reference, eax);
+  Register val = BaseRegister(value, ecx);
+  Emit("movl %s, %d(%s)\t# store with offset", regName[val], offset,
+       regName[base]);
 }
 
 /* Method: EmitBinaryOp
  * --------------------
  * Used to perform a binary operation on 2 operands and store result
- * in dst. All binary forms for arithmetic, logical, relational, equality
- * use this method. Slaves both operands and dst to registers, then
- * emits the appropriate instruction by looking up the mips name
- * for the particular op code.
+ * in dst. The first operand goes into %eax, the second is used where
+ * it is (or from %ecx, for division and shifts), and %eax is stored
+ * to dst. Comparisons set %al from the flags and widen it.
  */
 void X86::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
-                                 Location *op1, Location *op2)
-{
+                       Location *op1, const char *op2) {
+  char rLeft[OperandSize], rDst[OperandSize];
+  Emit("movl %s, %%eax", Operand(op1, rLeft));
+  switch (code) {
+    case BinaryOp::Div:
+    case BinaryOp::Mod:
+      Emit("movl %s, %%ecx", op2);
+      Emit("cltd");
+      Emit("idivl %%ecx\t\t# %s", BinaryOp::opName[code]);
+      if (code == BinaryOp::Mod) {
+        Emit("movl %%edx, %%eax");
+      }
+      break;
+    case BinaryOp::Shl:
+    case BinaryOp::Shr:
+      Emit("movl %s, %%ecx", op2);
+      Emit("%s %%cl, %%eax", arithName[code]);
+      break;
+    default:
+      if (BinaryOp::IsRelational(code)) {
+        Emit("cmpl %s, %%eax", op2);
+        Emit("%s %%al", setName[code]);
+        Emit("movzbl %%al, %%eax");
+      } else {
+        Assert(arithName[code] != NULL);
+        Emit("%s %s, %%eax", arithName[code], op2);
+      }
+  }
+  Emit("movl %%eax, %s", Operand(dst, rDst));
+}
 
+void X86::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                       Location *op1, Location *op2) {
+  char buf[OperandSize];
+  EmitBinaryOp(code, dst, op1, Operand(op2, buf));
+}
+
+void X86::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                       Location *op1, int imm) {
+  char buf[OperandSize];
+  sprintf(buf, "$%d", imm);
+  EmitBinaryOp(code, dst, op1, buf);
+}
+
+/* Method: FitsImmediate
+ * ---------------------
+ * Arithmetic, logic and cmpl all take a full 32-bit immediate; shifts
+ * take a count up to 31 and idivl none at all.
+ */
+bool X86::FitsImmediate(BinaryOp::OpCode code, int val) {
+  switch (code) {
+    case BinaryOp::Div:
+    case BinaryOp::Mod:
+      return false;
+    case BinaryOp::Shl:
+    case BinaryOp::Shr:
+      return val >= 0 && val <= 31;
+    default:
+      return true;
+  }
 }
 
 /* Method: EmitLabel
  * -----------------
- * Used to emit label marker. Before a label, we spill all registers since
- * we can't be sure what the situation upon arriving at this label (ie
- * starts new basic block), and rather than try to be clever, we just
- * wipe the slate clean.
+ * Used to emit label marker.
  */
-void X86::EmitLabel(const char *label)
-{
-
+void X86::EmitLabel(const char *label) {
+  Emit("%s:", label);
 }
 
 /* Method: EmitGoto
  * ----------------
- * Used for an unconditional transfer to a named label. Before a goto,
- * we spill all registers, since we don't know what the situation is
- * we are heading to (ie this ends current basic block) and rather than
- * try to be clever, we just wipe slate clean.
+ * Used for an unconditional transfer to a named label.
  */
-void X86::EmitGoto(const char *label)
-{
-
+void X86::EmitGoto(const char *label) {
+  Emit("jmp %s\t\t# unconditional branch", label);
 }
 
 /* Method: EmitIfZ
  * ---------------
- * Used for a conditional branch based on value of test variable.
- * We slave test var to register and use in the emitted test instruction,
- * either beqz. See comments above on Goto for why we spill
- * all registers here.
+ * Used for a conditional branch based on value of test variable, which
+ * is compared against zero where it is.
  */
-void X86::EmitIfZ(Location *test, const char *label)
-{
-
+void X86::EmitIfZ(Location *test, const char *label) {
+  char buf[OperandSize];
+  Emit("cmpl $0, %s", Operand(test, buf));
+  Emit("je %s\t\t# branch if %s is zero", label, test->GetName());
 }
 
-/* Method: EmitParam
- * -----------------
- * Used to push a parameter on the stack in anticipation of upcoming
- * function call. Decrements the stack pointer by 4. Slaves argument into
- * register and then stores contents to location just made at end of
- * stack.
+/* Method: EmitIfCompare
+ * ---------------------
+ * Used for a branch on a comparison of two variables: a cmpl against
+ * the first in %eax and the matching conditional jump.
  */
-void X86::EmitParam(Location *arg)
-{
-
+void X86::EmitIfCompare(BinaryOp::OpCode rel, Location *op1, Location *op2,
+                        const char *label) {
+  char rLeft[OperandSize], rRight[OperandSize];
+  Assert(jumpName[rel] != NULL);
+  Emit("movl %s, %%eax", Operand(op1, rLeft));
+  Emit("cmpl %s, %%eax", Operand(op2, rRight));
+  Emit("%s %s\t\t# branch if %s %s %s", jumpName[rel], label,
+       op1->GetName(), BinaryOp::opName[rel], op2->GetName());
 }
 
-/* Method: EmitCallInstr
+/* Method: EmitJumpTable
  * ---------------------
- * Used to effect a function call. All necessary arguments should have
- * already been pushed on the stack, this is the last step that
- * transfers control from caller to callee.  See comments on Goto method
- * above for why we spill all registers before making the jump. We issue
- * jal for a label, a jalr if address in register. Both will save the
- * return address in $ra. If there is an expected result passed, we slave
- * the var to a register and copy function return value from $v0 into that
- * register.
+ * Lays out the target addresses as a table in the data segment and
+ * jumps through the index'th entry with a scaled indirect jump.
  */
-void X86::EmitCallInstr(Location *result, const char *fn, bool isLabel)
-{
-
+void X86::EmitJumpTable(Location *index, const char *tableLabel,
+                        List<const char*> *targets) {
+  Emit(".data");
+  Emit(".align 4");
+  Emit("%s:\t\t# jump table", tableLabel);
+  for (int i = 0; i < targets->NumElements(); i++) {
+    Emit(".long %s", targets->Nth(i));
+  }
+  Emit(".text");
+  Register rIndex = BaseRegister(index, eax);
+  Emit("jmp *%s(,%s,4)\t# jump to case %s", tableLabel, regName[rIndex],
+       index->GetName());
 }
 
-// Two covers for the above method for specific LCall/ACall variants
-void X86::EmitLCall(Location *dst, const char *label)
-{
-
+/* Method: EmitParam
+ * -----------------
+ * Used to push a parameter on the stack in anticipation of upcoming
+ * function call. There are no argument registers on this target.
+ */
+void X86::EmitParam(Location *arg, int argReg) {
+  char buf[OperandSize];
+  Assert(argReg < 0);
+  Emit("pushl %s\t# push param %s", Operand(arg, buf), arg->GetName());
 }
 
-void X86::EmitACall(Location *dst, Location *fn)
-{
+/* Method: EmitLCall
+ * -----------------
+ * Used to effect a function call to a label. The callee leaves its
+ * result in %eax.
+ */
+void X86::EmitLCall(Location *dst, const char *label) {
+  char buf[OperandSize];
+  Emit("call %-15s\t# jump to function", label);
+  if (dst != NULL) {
+    Emit("movl %%eax, %s\t# copy function return value", Operand(dst, buf));
+  }
+}
 
+void X86::EmitACall(Location *dst, Location *fn) {
+  char buf[OperandSize];
+  Emit("call *%s\t# jump to function", Operand(fn, buf));
+  if (dst != NULL) {
+    Emit("movl %%eax, %s\t# copy function return value", Operand(dst, buf));
+  }
 }
 
 /*
  * We remove all parameters from the stack after a completed call
  * by adjusting the stack pointer upwards.
  */
-void X86::EmitPopParams(int bytes)
-{
-
+void X86::EmitPopParams(int bytes) {
+  if (bytes != 0) {
+    Emit("addl $%d, %%esp\t# pop params off stack", bytes);
+  }
 }
 
 /* Method: EmitReturn
  * ------------------
  * Used to emit code for returning from a function (either from an
  * explicit return or falling off the end of the function body).
- * If there is an expression to return, we slave that variable into
- * a register and move its contents to $v0 (the standard register for
- * function result).  Before exiting, we spill dirty registers (to
- * commit contents of slaved registers to memory, necessary for
- * consistency, see comments at SpillForEndFunction above). We also
- * do the last part of the callee's job in function call protocol,
- * which is to remove our locals/temps from the stack, remove
- * saved registers ($fp and $ra) and restore previous values of
- * $fp and $ra so everything is returned to the state we entered.
- * We then emit jr to jump to the saved $ra.
+ * The value, if any, goes in %eax. The registers saved on entry are
+ * restored, then leave pops the frame and restores %ebp.
  */
-void X86::EmitReturn(Location *returnVal)
-{
-
+void X86::EmitReturn(Location *returnVal) {
+  char buf[OperandSize];
+  if (returnVal != NULL) {
+    Emit("movl %s, %%eax\t# assign return value into %%eax",
+         Operand(returnVal, buf));
+  }
+  for (int i = 0, n = 0; i < NumAllocatableRegs; i++) {
+    if (savedRegs & (1 << i)) {
+      Emit("movl %d(%%ebp), %s\t# restore saved %s", SavedRegisterOffset(n++),
+           regName[allocatable[i]], regName[allocatable[i]]);
+    }
+  }
+  Emit("leave\t\t\t# pop callee frame off stack");
+  Emit("ret\t\t\t# return from function");
 }
 
 /* Method: EmitBeginFunction
  * -------------------------
  * Used to handle the callee's part of the function call protocol
- * upon entering a new function. We decrement the $sp to make space
- * and then save the current values of $fp and $ra (since we are
- * going to change them), then set up the $fp and bump the $sp down
- * to make space for all our locals/temps.
+ * upon entering a new function: save %ebp and point it at the new
+ * frame, make space for the locals/temps, then push the registers
+ * the allocator gave out (savedRegs is a mask of them) and load the
+ * parameters that live in one. Every function has a full frame, and
+ * every parameter came on the stack.
  */
-void X86::EmitBeginFunction(int stackFrameSize)
-{
-
+void X86::EmitBeginFunction(int stackFrameSize, int saved,
+                            List<Location*> *regParams,
+                            List<Location*> *argParams, bool leaf) {
+  Assert(stackFrameSize >= 0);
+  Assert(argParams->NumElements() == 0 && !leaf);
+  frameSize = stackFrameSize;
+  savedRegs = saved;
+
+  Emit("pushl %%ebp\t\t# save ebp");
+  Emit("movl %%esp, %%ebp\t# set up new ebp");
+  if (frameSize != 0) {
+    Emit("subl $%d, %%esp\t# make space for locals/temps", frameSize);
+  }
+  for (int i = 0; i < NumAllocatableRegs; i++) {
+    if (savedRegs & (1 << i)) {
+      Emit("pushl %s\t\t# save %s", regName[allocatable[i]],
+           regName[allocatable[i]]);
+    }
+  }
+  for (int i = 0; i < regParams->NumElements(); i++) {
+    Location *param = regParams->Nth(i);
+    Emit("movl %d(%%ebp), %s\t# load param %s into its register",
+         param->GetOffset() + 4, regName[allocatable[param->GetRegister()]],
+         param->GetName());
+  }
+}
+
+// The save area sits just below the function's locals and temps,
+// which end frameSize bytes below %ebp.
+int X86::SavedRegisterOffset(int n) {
+  return -frameSize - 4 - 4 * n;
 }
 
 /* Method: EmitEndFunction
@@ -339,9 +414,9 @@ void X86::EmitBeginFunction(int stackFrameSize)
  * case to clean up stack frame, return to caller etc. See comments on
  * EmitReturn above.
  */
-void X86::EmitEndFunction()
-{
-
+void X86::EmitEndFunction() {
+  Emit("# (below handles reaching end of fn body with no explicit return)");
+  EmitReturn(NULL);
 }
 
 /* Method: EmitVTable
@@ -350,70 +425,68 @@ void X86::EmitEndFunction()
  * entry in data segment, emits label, and lays out the function
  * labels one after another.
  */
-void X86::EmitVTable(const char *label, List<const char*> *methodLabels)
-{
-
-
+void X86::EmitVTable(const char *label, List<const char*> *methodLabels) {
+  Emit(".data");
+  Emit(".align 4");
+  Emit("%s:\t\t# label for class %s vtable", label, label);
+  for (int i = 0; i < methodLabels->NumElements(); i++) {
+    Emit(".long %s", methodLabels->Nth(i));
+  }
+  Emit(".text");
 }
 
 /* Method: EmitPreamble
  * --------------------
- * Used to emit the starting sequence needed for a program. Not much
- * here, but need to indicate what follows is in text segment and
- * needs to be aligned on word boundary. main is our only global symbol.
+ * Used to emit the starting sequence needed for a program. main is
+ * our only global symbol; _start in libdecaf.s calls it.
  */
-void X86::EmitPreamble()
-{
-
-}
-
-/* Method: NameForTac
- * ------------------
- * Returns the appropriate MIPS instruction (add, seq, etc.) for
- * a given BinaryOp:OpCode (BinaryOp::Add, BinaryOp:Equals, etc.).
- * Asserts if asked for name of an unset/out of bounds code.
- */
-const char *X86::NameForTac(BinaryOp::OpCode code)
-{
-
+void X86::EmitPreamble() {
+  Emit("# standard Decaf preamble ");
+  Emit(".text");
+  Emit(".globl main");
 }
 
 /* Constructor
  * ----------
- * Constructor sets up the mips names and register descriptors to
- * the initial starting state.
+ * Constructor sets up the instruction names for each Tac operator.
  */
-X86::X86()
-{
-  x86Name[BinaryOp::Add]  = "add";
-  x86Name[BinaryOp::Sub]  = "sub";
-  x86Name[BinaryOp::Mul]  = "imul";
-  x86Name[BinaryOp::Div]  = "idiv";
-  x86Name[BinaryOp::Mod]  = "";
-  x86Name[BinaryOp::Eq]   = "";
-  x86Name[BinaryOp::Less] = "";
-  x86Name[BinaryOp::And]  = "";
-  x86Name[BinaryOp::Or]   = "";
-  x86Name[BinaryOp::Xor]  = "";
-  x86Name[BinaryOp::Shl]  = "";
-  x86Name[BinaryOp::Shr]  = "";
-  regs[eax]    = (RegContents) { false, NULL, "%eax",    true };
-  regs[ebx]    = (RegContents) { false, NULL, "%ebx",    true };
-  regs[ecx]    = (RegContents) { false, NULL, "%ecx",    true };
-  regs[edx]    = (RegContents) { false, NULL, "%edx",    true };
-  regs[cs]     = (RegContents) { false, NULL, "%cs",     false };
-  regs[ds]     = (RegContents) { false, NULL, "%ds",     false };
-  regs[ss]     = (RegContents) { false, NULL, "%ss",     false };
-  regs[es]     = (RegContents) { false, NULL, "%es",     false };
-  regs[fs]     = (RegContents) { false, NULL, "%fs",     false };
-  regs[gs]     = (RegContents) { false, NULL, "%gs",     false };
-  regs[ebp]    = (RegContents) { false, NULL, "%ebp",    false };
-  regs[esp]    = (RegContents) { false, NULL, "%esp",    false };
-  regs[esi]    = (RegContents) { false, NULL, "%esi",    false };
-  regs[edi]    = (RegContents) { false, NULL, "%edi",    false };
-  regs[eip]    = (RegContents) { false, NULL, "%eip",    false };
-  regs[eflags] = (RegContents) { false, NULL, "%eflags", false };
-  lastUsed = eax;
-}
-
-const char *X86::x86Name[BinaryOp::NumOps];
+X86::X86() {
+  arithName[BinaryOp::Add] = "addl";
+  arithName[BinaryOp::Sub] = "subl";
+  arithName[BinaryOp::Mul] = "imull";
+  arithName[BinaryOp::And] = "andl";
+  arithName[BinaryOp::Or] = "orl";
+  arithName[BinaryOp::Xor] = "xorl";
+  arithName[BinaryOp::Shl] = "shll";
+  arithName[BinaryOp::Shr] = "shrl";
+  setName[BinaryOp::Eq] = "sete";
+  setName[BinaryOp::NotEq] = "setne";
+  setName[BinaryOp::Less] = "setl";
+  setName[BinaryOp::LessEq] = "setle";
+  setName[BinaryOp::Greater] = "setg";
+  setName[BinaryOp::GreaterEq] = "setge";
+  setName[BinaryOp::LessEqU] = "setbe";
+  setName[BinaryOp::GreaterU] = "seta";
+  jumpName[BinaryOp::Eq] = "je";
+  jumpName[BinaryOp::NotEq] = "jne";
+  jumpName[BinaryOp::Less] = "jl";
+  jumpName[BinaryOp::LessEq] = "jle";
+  jumpName[BinaryOp::Greater] = "jg";
+  jumpName[BinaryOp::GreaterEq] = "jge";
+  jumpName[BinaryOp::LessEqU] = "jbe";
+  jumpName[BinaryOp::GreaterU] = "ja";
+  frameSize = savedRegs = 0;
+  globalsSize = 0;
+}
+
+const char *X86::regName[NumRegs] = {
+  "%eax", "%ecx", "%edx", "%ebx", "%esi", "%edi", "%esp", "%ebp"
+};
+const X86::Register X86::allocatable[NumAllocatableRegs] = {
+  ebx, esi, edi
+};
+const char *X86::arithName[BinaryOp::NumOps];
+const char *X86::setName[BinaryOp::NumOps];
+const char *X86::jumpName[BinaryOp::NumOps];
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
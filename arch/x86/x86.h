@@ -1,85 +1,122 @@
-#ifndef _H_X86
-#define _H_X86
-
-#include <list.h>
-#include "tac.h"
+/* File: x86.h
+ * -----------
+ * The X86 class defines an object capable of emitting i386 assembly
+ * (AT&T syntax, for the GNU assembler) for Linux. It is used by the
+ * Tac instruction classes in place of Mips when the compiler is run
+ * with -target x86, and the result is linked against
+ * arch/x86/libdecaf.s:
+ *
+ *     dcc -target x86 prog.decaf -o prog.s
+ *     as --32 -o prog.o prog.s
+ *     as --32 -o libdecaf.o arch/x86/libdecaf.s
+ *     ld -m elf_i386 -o prog prog.o libdecaf.o
+ *
+ * The code is simple-minded: every Tac operand that the register
+ * allocator left in memory is used straight from its slot, and %eax,
+ * %ecx and %edx are scratch within a single instruction. Arguments
+ * are always pushed on the stack (the stack calling convention) and
+ * results come back in %eax.
+ *
+ * Frame layout is the one the Tac is written against, shifted up a
+ * word because call pushes the return address where Mips keeps $ra
+ * in the callee: the slot at Tac offset n from the frame pointer is
+ * n+4(%ebp), so parameters start at 8(%ebp) and locals at -4(%ebp).
+ * Below the locals go the callee-saved registers the allocator used.
+ * Globals live in one zeroed block at _globals.
+ */
+
+#ifndef _H_x86
+#define _H_x86
+
+#include "decaf/list.h"
+#include "codegen/emitter.h"
+#include "codegen/tac.h"
 
 class Location;
 
-class X86
-{
-  private:
-    typedef enum
-    {
-      eax, ebx, ecx, edx,       // General purpose 32-bit regs
-      cs, ds, ss, es, fs, gs,   // Segment registers
-      ebp, esp,                 // Stack registers
-      esi, edi,                 // Index registers
-      eip, eflags,              // Instruction pointer and flags
-      NumRegs                   // Total number of usable registers
-    } Register;
+class X86 : public TargetEmitter {
+ public:
+  X86();
+
+  // %ebx, %esi and %edi are callee-saved and handed to the register
+  // allocator; a Location with register i lives in the i'th of them
+  // for its whole function.
+  static const int NumAllocatableRegs = 3;
+
+  int GetNumAllocatableRegs() { return NumAllocatableRegs; }
+  int GetNumArgRegs() { return 0; }
+  bool FitsImmediate(BinaryOp::OpCode code, int val);
 
-    struct RegContents
-    {
-        bool isDirty;
-        Location *var;
-        const char *name;
-        bool isGeneralPurpose;
-    } regs[NumRegs];
+  void Emit(const char *fmt, ...);
 
-    Register lastUsed;
+  // Lays out the global variables, once every function has been
+  // emitted and their extent is known.
+  void Flush();
 
-    typedef enum { ForRead, ForWrite } Reason;
+  void EmitLoadConstant(Location *dst, int val);
+  void EmitLoadStringConstant(Location *dst, const char *str);
+  void EmitLoadLabel(Location *dst, const char *label);
 
-    Register GetRegister(Location *var, Reason reason,
-                         Register avoid1, Register avoid2);
-    Register GetRegister(Location *var, Register avoid1);
-    Register GetRegisterForWrite(Location *var, Register avoid1,
-                                 Register avoid2);
-    bool FindRegisterWithContents(Location *var, Register& reg);
-    Register SelectRegisterToSpill(Register avoid1, Register avoid2);
-    void SpillRegister(Register reg);
-    void SpillAllDirtyRegisters();
-    void SpillForEndFunction();
+  void EmitLoad(Location *dst, Location *reference, int offset);
+  void EmitStore(Location *reference, Location *value, int offset);
+  void EmitCopy(Location *dst, Location *src);
 
-    void EmitCallInstr(Location *dst, const char *fn, bool isL);
+  void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+        Location *op1, Location *op2);
+  void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+        Location *op1, int imm);
 
-    static const char *x86Name[BinaryOp::NumOps];
-    static const char *NameForTac(BinaryOp::OpCode code);
+  void EmitLabel(const char *label);
+  void EmitGoto(const char *label);
+  void EmitIfZ(Location *test, const char*label);
+  void EmitIfCompare(BinaryOp::OpCode rel, Location *op1, Location *op2,
+                     const char *label);
+  void EmitJumpTable(Location *index, const char *tableLabel,
+                     List<const char*> *targets);
+  void EmitReturn(Location *returnVal);
 
-  public:
+  void EmitBeginFunction(int frameSize, int savedRegs,
+                         List<Location*> *regParams,
+                         List<Location*> *argParams, bool leaf);
+  void EmitEndFunction();
 
-    X86();
+  void EmitParam(Location *arg, int argReg);
+  void EmitLCall(Location *result, const char* label);
+  void EmitACall(Location *result, Location *fnAddr);
+  void EmitPopParams(int bytes);
 
-    static void Emit(const char *fmt, ...);
+  void EmitVTable(const char *label, List<const char*> *methodLabels);
 
-    void EmitLoadConstant(Location *dst, int val);
-    void EmitLoadStringConstant(Location *dst, const char *str);
-    void EmitLoadLabel(Location *dst, const char *label);
+  void EmitPreamble();
 
-    void EmitLoad(Location *dst, Location *reference, int offset);
-    void EmitStore(Location *reference, Location *value, int offset);
-    void EmitCopy(Location *dst, Location *src);
+ private:
+  typedef enum {
+    eax, ecx, edx, ebx, esi, edi, esp, ebp, NumRegs
+  } Register;
 
-    void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
-                            Location *op1, Location *op2);
+  static const char *regName[NumRegs];
+  static const Register allocatable[NumAllocatableRegs];
 
-    void EmitLabel(const char *label);
-    void EmitGoto(const char *label);
-    void EmitIfZ(Location *test, const char*label);
-    void EmitReturn(Location *returnVal);
+  // Longest operand Operand writes, terminator included.
+  static const int OperandSize = 32;
 
-    void EmitBeginFunction(int frameSize);
-    void EmitEndFunction();
+  // Frame of the function being emitted.
+  int frameSize;
+  int savedRegs;
 
-    void EmitParam(Location *arg);
-    void EmitLCall(Location *result, const char* label);
-    void EmitACall(Location *result, Location *fnAddr);
-    void EmitPopParams(int bytes);
+  // Bytes of globals used so far.
+  int globalsSize;
 
-    void EmitVTable(const char *label, List<const char*> *methodLabels);
+  const char *Operand(Location *var, char *buf);
+  Register BaseRegister(Location *var, Register scratch);
+  void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                    Location *op1, const char *op2);
+  int SavedRegisterOffset(int n);
 
-    void EmitPreamble();
+  static const char *arithName[BinaryOp::NumOps];
+  static const char *setName[BinaryOp::NumOps];
+  static const char *jumpName[BinaryOp::NumOps];
 };
 
+/* vim: set ai ts=2 sts=2 sw=2 et: */
 #endif
@@ -6,7 +6,7 @@
 #include "ast/ast.h"
 
 Node::Node(yyltype loc) {
-  location_ = new yyltype(loc);
+  location_ = new (CompilationArena()) yyltype(loc);
   parent_ = NULL;
 }
 
@@ -36,8 +36,8 @@ void Node::Print(int indentLevel, const char *label) {
   PrintChildren(indentLevel);
 }
 
-Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
-  name_ = strdup(n);
+Identifier::Identifier(yyltype loc, Atom n) : Node(loc) {
+  name_ = n;
 }
 
 void Identifier::PrintChildren(int indentLevel) {
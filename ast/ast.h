@@ -40,13 +40,15 @@
 #include "codegen/symtable.h"
 #include "codegen/codegen.h"
 #include "codegen/framealloc.h"
+#include "decaf/arena.h"
+#include "decaf/atom.h"
 #include "decaf/location.h"
 #include "decaf/errors.h"
 #include "decaf/list.h"
 
 class SymTable;
 
-class Node {
+class Node : public ArenaObject {
  public:
   Node(yyltype loc);
   Node();
@@ -72,18 +74,18 @@ class Node {
 
 class Identifier : public Node {
  public:
-  Identifier(yyltype loc, const char* name);
+  Identifier(yyltype loc, Atom name);
   const char* GetPrintNameForNode() { return "Identifier"; }
   void PrintChildren(int indentLevel);
   friend std::ostream& operator<<(std::ostream& out, Identifier* id) {
     return out << id->name_;
   }
-  char* name() { return name_; }
+  Atom name() { return name_; }
   bool Check(SymTable *env);
   bool Check(SymTable *env, int type);
 
  protected:
-  char* name_;
+  Atom name_;
 };
 
 // This node class is designed to represent a portion of the tree that
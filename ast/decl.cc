@@ -85,6 +85,7 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp,
   class_env_ = NULL;
   v_functions_ = NULL;
   parent_ = NULL;
+  subclasses_ = new List<ClassDecl*>;
   class_falloc_ = NULL;
   v_table_ = NULL;
   fields_ = NULL;
@@ -118,9 +119,9 @@ bool ClassDecl::CheckDecls(SymTable *env) {
   return true;
 }
 
-bool ClassDecl::ImplementsInterface(char *name) {
+bool ClassDecl::ImplementsInterface(Atom name) {
   for (int i = 0; i < implements_->NumElements(); ++i) {
-    if (strcmp(name, implements_->Nth(i)->GetName()) == 0) {
+    if (name == implements_->Nth(i)->GetName()) {
       return true;
     }
   }
@@ -307,6 +308,7 @@ void ClassDecl::EmitSetup(FrameAllocator *falloc, CodeGenerator *codegen,
 
     // Note: parent will ignore falloc and env parameters and use its own
     parent_->EmitSetup(falloc, codegen, env);
+    parent_->subclasses_->Append(this);
     List<FnDecl*> *parentVTable = parent_->GetVTable();
     List<VarDecl*> *parentFields = parent_->GetFields();
     for (int i = 0; i < parentVTable->NumElements(); ++i) {
@@ -372,6 +374,9 @@ void ClassDecl::EmitSetup(FrameAllocator *falloc, CodeGenerator *codegen,
       field->Emit(class_falloc_, codegen, class_env_);
     }
   }
+  // Set before any class emits its methods, which may create objects
+  // of this one.
+  num_fields_ = fields_->NumElements();
 }
 
 void ClassDecl::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
@@ -386,7 +391,6 @@ void ClassDecl::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
       v_table_->NumElements(), fields_->NumElements());
 #endif
 
-  num_fields_ = fields_->NumElements();
   List<const char*> *method_label_s = new List<const char*>;
   for (int i = 0; i < v_table_->NumElements(); ++i) {
     method_label_s->Append(v_table_->Nth(i)->GetMethodLabel());
@@ -394,6 +398,16 @@ void ClassDecl::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
   codegen->GenVTable(class_label_, method_label_s);
 }
 
+FnDecl *ClassDecl::GetUniqueMethod(int offset) {
+  FnDecl *method = v_table_->Nth(offset);
+  for (int i = 0; i < subclasses_->NumElements(); ++i) {
+    if (subclasses_->Nth(i)->GetUniqueMethod(offset) != method) {
+      return NULL;
+    }
+  }
+  return method;
+}
+
 /* Class: InterfaceDecl
  * --------------------
  * Implementation of class InterfaceDecl
@@ -538,7 +552,7 @@ bool FnDecl::PrototypeEqual(FnDecl *fn) {
     return false;
   }
 
-  if (strcmp(id_->name(), fn->GetName()) == 0) {
+  if (id_->name() == fn->GetName()) {
     return true;
   } else {
     return false;
@@ -558,8 +572,15 @@ void FnDecl::Emit(FrameAllocator *falloc, CodeGenerator *codegen, SymTable *env)
   function_label_ = codegen->NewFunctionLabel(id_->name());
   codegen->GenLabel(function_label_);
   begin_fn = codegen->GenBeginFunc();
-  for (int i = 0; i < formals_->NumElements(); ++i) {
-    formals_->Nth(i)->Emit(param_falloc_, codegen, fn_env_);
+  EmitFormals(codegen, begin_fn, 0);
+  // The collector scans the globals for roots, so it is told how far
+  // they reach before main does anything else. Under -d gc the
+  // program also reports what the collector did when it exits.
+  if (kGCFlag && strcmp(id_->name(), "main") == 0) {
+    codegen->GenBuiltInCall(body_falloc_, GCInit,
+        codegen->GenLoadConstant(body_falloc_,
+                                 falloc->GetOff() + CodeGenerator::VarSize),
+        codegen->GenLoadConstant(body_falloc_, IsDebugOn("gc")));
   }
   body_->Emit(body_falloc_, codegen, fn_env_);
   begin_fn->SetFrameSize(body_falloc_->GetSize());
@@ -580,18 +601,38 @@ void FnDecl::EmitMethod(ClassDecl *classDecl, FrameAllocator *falloc,
   begin_fn = codegen->GenBeginFunc();
 
   // Simulate an implicit first "this" parameter
-  char *thisName = strdup("this");
-  Location *thisParam = param_falloc_->Alloc(thisName, 4);
-  fn_env_->add(thisName, NULL, thisParam);
-  for (int i = 0; i < formals_->NumElements(); ++i) {
-    formals_->Nth(i)->Emit(param_falloc_, codegen, fn_env_);
+  Location *thisParam;
+  if (codegen->NumRegisterArgs() > 0) {
+    thisParam = body_falloc_->Alloc(kAtomThis, 4);
+    begin_fn->AddArgParam(thisParam);
+  } else {
+    thisParam = param_falloc_->Alloc(kAtomThis, 4);
   }
+  thisParam->SetNonNull();
+  fn_env_->add(kAtomThis, NULL, thisParam);
+  EmitFormals(codegen, begin_fn, 1);
 
   body_->Emit(body_falloc_, codegen, fn_env_);
   begin_fn->SetFrameSize(body_falloc_->GetSize());
   codegen->GenEndFunc();
 }
 
+// Lays out the formals, the first of which is argument number first.
+// Those passed in registers get a slot in the function's own frame.
+void FnDecl::EmitFormals(CodeGenerator *codegen, BeginFunc *begin_fn,
+                         int first) {
+  for (int i = 0; i < formals_->NumElements(); ++i) {
+    VarDecl *formal = formals_->Nth(i);
+    if (first + i >= codegen->NumRegisterArgs()) {
+      formal->Emit(param_falloc_, codegen, fn_env_);
+      continue;
+    }
+    formal->Emit(body_falloc_, codegen, fn_env_);
+    begin_fn->AddArgParam(
+        fn_env_->find(formal->GetName(), S_VARIABLE)->getLocation());
+  }
+}
+
 void FnDecl::SetMethodLabel(char *class_label_) {
   int len = strlen(class_label_) + strlen(id_->name()) + 2;
   method_label_ = (char *) malloc(len);
@@ -37,7 +37,7 @@ class Decl : public Node {
   virtual void Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                     SymTable *env) { }
   virtual Type* GetType() { return NULL; }
-  char *GetName() { return id_->name(); }
+  Atom GetName() { return id_->name(); }
 
  protected:
   Identifier* id_;
@@ -74,7 +74,7 @@ class ClassDecl : public Decl {
   void PrintChildren(int indent_level);
   bool CheckDecls(SymTable* env);
   bool Inherit(SymTable* env);
-  bool ImplementsInterface(char* name);
+  bool ImplementsInterface(Atom name);
   bool Check(SymTable* env);
 
   void EmitSetup(FrameAllocator* falloc, CodeGenerator* codegen,
@@ -84,6 +84,11 @@ class ClassDecl : public Decl {
   int NumFields() { return num_fields_; }
   char* GetClassLabel() { return class_label_; }
 
+  // The method run for vtable slot offset on any object whose class is
+  // this one or below it, NULL if a subclass overrides it. Valid once
+  // every class has been through EmitSetup.
+  FnDecl* GetUniqueMethod(int offset);
+
  private:
   bool CheckAgainstParents(SymTable* env);
   bool CheckAgainstInterfaces(SymTable* env);
@@ -106,6 +111,8 @@ class ClassDecl : public Decl {
   // Pointer to ClassDecl for parent class, NULL if no parent class
   // Set during semantic checking, used during IR generation
   ClassDecl* parent_;
+  // Classes that extend this one directly, filled in by EmitSetup
+  List<ClassDecl*>* subclasses_;
 
   // Set and used for IR Generation
 
@@ -174,9 +181,11 @@ class FnDecl : public Decl {
   char* method_label_;
   char* function_label_;
   int method_offset_;
+
+  void EmitFormals(CodeGenerator *codegen, BeginFunc *begin_fn, int first);
 };
 
-class VFunction {
+class VFunction : public ArenaObject {
  public:
   VFunction(FnDecl* p, NamedType* type);
   FnDecl* getPrototype() { return prototype_; }
@@ -9,6 +9,42 @@
 #include "ast/type.h"
 #include "ast/decl.h"
 
+/* Class: Expr
+ * -----------
+ * Implementation for Expr class
+ */
+
+// Branches on a op b holding, for the labels given to EmitJump.
+static void EmitCompareJump(CodeGenerator* codegen, const char* op,
+                            Location* a, Location* b,
+                            const char* true_label, const char* false_label) {
+  if (false_label != NULL) {
+    codegen->GenIfCompare(op, true, a, b, false_label);
+    if (true_label != NULL) {
+      codegen->GenGoto(true_label);
+    }
+  } else if (true_label != NULL) {
+    codegen->GenIfCompare(op, false, a, b, true_label);
+  }
+}
+
+// Any other expression is computed and its value tested.
+void Expr::EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                    SymTable* env, const char* true_label,
+                    const char* false_label) {
+  Emit(falloc, codegen, env);
+  if (false_label != NULL) {
+    codegen->GenIfZ(GetFrameLocation(), false_label);
+    if (true_label != NULL) {
+      codegen->GenGoto(true_label);
+    }
+  } else if (true_label != NULL) {
+    Location* zero = codegen->GenLoadConstant(falloc, 0);
+    EmitCompareJump(codegen, "!=", GetFrameLocation(), zero, true_label,
+                    NULL);
+  }
+}
+
 /* Class: IntConstant
  * ------------------
  * Implementation for IntConstant class
@@ -58,7 +94,7 @@ void BoolConstant::PrintChildren(int indent_level) {
 
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
   Assert(val != NULL);
-  value_ = strdup(val);
+  value_ = Intern(val);
   ret_type_ = Type::stringType;
 }
 
@@ -225,6 +261,16 @@ void RelationalExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
   frame_location_ = loc;
 }
 
+void RelationalExpr::EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                              SymTable* env, const char* true_label,
+                              const char* false_label) {
+  left_->Emit(falloc, codegen, env);
+  right_->Emit(falloc, codegen, env);
+  EmitCompareJump(codegen, op_->GetTokenString(), left_->GetFrameLocation(),
+                  right_->GetFrameLocation(), true_label, false_label);
+  frame_location_ = NULL;
+}
+
 /* Class: EqualityExpr
  * ------------------
  * Implementation for EqualityExpr class
@@ -256,6 +302,15 @@ bool EqualityExpr::Check(SymTable *env) {
 void EqualityExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
                         SymTable* env) {
   Location* loc = NULL;
+  // Two literals are equal exactly when they are the same atom.
+  StringConstant *left_str = dynamic_cast<StringConstant*>(left_);
+  StringConstant *right_str = dynamic_cast<StringConstant*>(right_);
+  if (left_str != NULL && right_str != NULL) {
+    bool equal = left_str->GetValue() == right_str->GetValue();
+    bool negated = strcmp(op_->GetTokenString(), "!=") == 0;
+    frame_location_ = codegen->GenLoadConstant(falloc, equal != negated);
+    return;
+  }
   left_->Emit(falloc, codegen, env);
   right_->Emit(falloc, codegen, env);
   if (left_->GetRetType()->IsConvertableTo(Type::stringType) &&
@@ -275,6 +330,22 @@ void EqualityExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
   frame_location_ = loc;
 }
 
+void EqualityExpr::EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                            SymTable* env, const char* true_label,
+                            const char* false_label) {
+  // Strings compare through a call, whose result is then tested.
+  if (left_->GetRetType()->IsConvertableTo(Type::stringType) &&
+      right_->GetRetType()->IsConvertableTo(Type::stringType)) {
+    Expr::EmitJump(falloc, codegen, env, true_label, false_label);
+    return;
+  }
+  left_->Emit(falloc, codegen, env);
+  right_->Emit(falloc, codegen, env);
+  EmitCompareJump(codegen, op_->GetTokenString(), left_->GetFrameLocation(),
+                  right_->GetFrameLocation(), true_label, false_label);
+  frame_location_ = NULL;
+}
+
 /* Class: LogicalExpr
  * ------------------
  * Implementation for LogicalExpr class
@@ -311,25 +382,73 @@ bool LogicalExpr::Check(SymTable* env) {
   return ret;
 }
 
+/* LogicalExpr::Emit
+ * -----------------
+ * && and || short-circuit, so their value is built from the branches:
+ *     IfNot (left && right) Goto false ;
+ *     result = 1 ;
+ *     Goto end ;
+ *   false:
+ *     result = 0 ;
+ *   end:
+ */
 void LogicalExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
                        SymTable* env) {
-  Location* loc = NULL;
-  if (left_) {
-    left_->Emit(falloc, codegen, env);
+  // Logical Negation?
+  if (!left_) {
+    right_->Emit(falloc, codegen, env);
+    frame_location_ = codegen->GenUnaryOp(falloc, op_->GetTokenString(),
+                                          right_->GetFrameLocation());
+    return;
   }
-  right_->Emit(falloc, codegen, env);
 
-  // Logical Negation?
+  char* false_label = codegen->NewLabel();
+  char* end_label = codegen->NewLabel();
+  Location* result = codegen->GenTempVar(falloc);
+  EmitJump(falloc, codegen, env, NULL, false_label);
+  codegen->GenAssign(result, codegen->GenLoadConstant(falloc, 1));
+  codegen->GenGoto(end_label);
+  codegen->GenLabel(false_label);
+  codegen->GenAssign(result, codegen->GenLoadConstant(falloc, 0));
+  codegen->GenLabel(end_label);
+
+  frame_location_ = result;
+}
+
+/* LogicalExpr::EmitJump
+ * ---------------------
+ * The right operand is only reached when the left one does not settle
+ * the outcome: when it is true for &&, false for ||. Negation just
+ * swaps the labels.
+ */
+void LogicalExpr::EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                           SymTable* env, const char* true_label,
+                           const char* false_label) {
   if (!left_) {
-    loc = codegen->GenUnaryOp(falloc, op_->GetTokenString(),
-                              right_->GetFrameLocation());
-  } else {
-    loc = codegen->GenBinaryOp(falloc, op_->GetTokenString(),
-                               left_->GetFrameLocation(),
-                               right_->GetFrameLocation());
+    right_->EmitJump(falloc, codegen, env, false_label, true_label);
+    frame_location_ = NULL;
+    return;
   }
 
-  frame_location_ = loc;
+  char* skip_label = NULL;  // where a settled outcome falls through to
+  if (strcmp(op_->GetTokenString(), "&&") == 0) {
+    const char* left_false = false_label;
+    if (left_false == NULL) {
+      left_false = skip_label = codegen->NewLabel();
+    }
+    left_->EmitJump(falloc, codegen, env, NULL, left_false);
+  } else {
+    const char* left_true = true_label;
+    if (left_true == NULL) {
+      left_true = skip_label = codegen->NewLabel();
+    }
+    left_->EmitJump(falloc, codegen, env, left_true, NULL);
+  }
+  right_->EmitJump(falloc, codegen, env, true_label, false_label);
+  if (skip_label != NULL) {
+    codegen->GenLabel(skip_label);
+  }
+  frame_location_ = NULL;
 }
 
 bool BitwiseExpr::Check(SymTable* env) {
@@ -443,7 +562,8 @@ void AssignExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
   Assert(right_->GetFrameLocation() != NULL);
 
   if (left_->NeedsDereference()) {
-    codegen->GenStore(left_->GetReference(), right_->GetFrameLocation(), 0);
+    codegen->GenStore(left_->GetReference(), right_->GetFrameLocation(),
+                      left_->GetReferenceOffset());
   } else {
     codegen->GenAssign(left_->GetFrameLocation(), right_->GetFrameLocation());
   }
@@ -476,7 +596,7 @@ bool This::Check(SymTable* env) {
 
 void This::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
                 SymTable* env) {
-  Symbol* sym = env->find(strdup("this"));
+  Symbol* sym = env->find(kAtomThis);
   Assert(sym != NULL);
   frame_location_ = sym->getLocation();
 }
@@ -537,19 +657,18 @@ void ArrayAccess::Emit(FrameAllocator* falloc, CodeGenerator * codegen,
   codegen->GenIfZ(bound_test, after_label);
   codegen->GenPrintError(falloc, kErrorArrOutOfBounds);
   codegen->GenLabel(after_label);
-  Location* one = codegen->GenLoadConstant(falloc, 1);
-  Location* four = codegen->GenLoadConstant(falloc, 4);
-  Location* true_off = codegen->GenBinaryOp(falloc, strdup("*"),
-      codegen->GenBinaryOp(falloc, strdup("+"),
-                           subscript_->GetFrameLocation(), one),
-      four);
-
+  // Elements follow the length word: arr[i] is at arr + i * 4 + 4,
+  // with the scale done by a shift and the header in the offset.
+  Location* two = codegen->GenLoadConstant(falloc, 2);
+  Location* scaled = codegen->GenBinaryOp(falloc, strdup("<<"),
+                                          subscript_->GetFrameLocation(), two);
   Location* addr = codegen->GenBinaryOp(falloc, strdup("+"),
-                                        base_->GetFrameLocation(), true_off);
-  Location* loc = codegen->GenLoad(falloc, addr, 0);
+                                        base_->GetFrameLocation(), scaled);
+  Location* loc = codegen->GenLoad(falloc, addr, CodeGenerator::VarSize);
 
   frame_location_ = loc;
   reference_ = addr;
+  reference_offset_ = CodeGenerator::VarSize;
   needs_dereference_ = true;
 }
 
@@ -619,8 +738,7 @@ bool FieldAccess::Check(SymTable* env) {
       FieldAccess *baseFieldAccess = dynamic_cast<FieldAccess*>(base_);
       Assert(baseFieldAccess != 0);
 
-      if (strcmp(class_decl->GetIdent()->name(),
-                 base_->GetRetType()->GetName()) != 0) {
+      if (class_decl->GetIdent()->name() != base_->GetRetType()->GetName()) {
         ReportError::InaccessibleField(field_, base_->GetRetType());
         SetRetType(Type::errorType);
         return false;
@@ -659,7 +777,7 @@ void FieldAccess::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
     }
 
     // We have an implicit "this."
-    Symbol *this_sym = env->find(strdup("this"), S_VARIABLE);
+    Symbol *this_sym = env->find(kAtomThis, S_VARIABLE);
     Assert(this_sym != NULL);
     Location *this_loc = this_sym->getLocation();
 
@@ -777,7 +895,7 @@ bool Call::Check(SymTable *env) {
   } else {
     ret &= base_->Check(env);
     if (strcmp(base_->GetRetType()->GetPrintNameForNode(), "ArrayType") == 0 &&
-        strcmp(field_->name(), "length") == 0) {
+        field_->name() == kAtomLength) {
       SetRetType(Type::intType);
       return ret;
     }
@@ -811,8 +929,10 @@ bool Call::Check(SymTable *env) {
   return ret;
 }
 
+// first is the index of the first actual among the arguments, 1 if
+// there is a receiver to pass ahead of them.
 int Call::EmitActuals(FrameAllocator* falloc, CodeGenerator* codegen,
-                      SymTable* env) {
+                      SymTable* env, int first) {
   int num_params = 0;
   for (int i = 0; i < actuals_->NumElements(); ++i) {
     actuals_->Nth(i)->Emit(falloc, codegen, env);
@@ -821,7 +941,7 @@ int Call::EmitActuals(FrameAllocator* falloc, CodeGenerator* codegen,
 
   // Push params in reverse order
   for (int i = actuals_->NumElements() - 1; i >= 0; --i) {
-    codegen->GenPushParam(actuals_->Nth(i)->GetFrameLocation());
+    codegen->GenPushArg(actuals_->Nth(i)->GetFrameLocation(), first + i);
   }
 
   return num_params;
@@ -837,6 +957,8 @@ void Call::Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env) {
   int method_offset = 0;
   Location* object_location = NULL;
   Location* method_addr = NULL;
+  ClassDecl* class_decl = NULL;
+  FnDecl* target = NULL;
 
   if (!base_) {
 #ifdef __DEBUG_TAC
@@ -853,27 +975,24 @@ void Call::Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env) {
     }
 
     if (!fn_decl->IsMethod()) {
-      num_params += EmitActuals(falloc, codegen, env);
+      num_params += EmitActuals(falloc, codegen, env, 0);
       char* function_label = codegen->NewFunctionLabel(fn_decl->GetName());
       frame_location_ = codegen->GenLCall(falloc, function_label, has_return_val);
-      codegen->GenPopParams(num_params * 4);
+      codegen->GenPopArgs(num_params);
       return;
     }
 
     // Implicit this
     // Get location of this and
 
-    Symbol* this_sym = env->find(strdup("this"), S_VARIABLE);
+    Symbol* this_sym = env->find(kAtomThis, S_VARIABLE);
     Assert(this_sym != NULL);
     object_location = this_sym->getLocation();
-
-    method_offset = fn_decl->GetMethodOffset();
-    method_addr = codegen->GenLoad(falloc,
-        codegen->GenLoad(falloc, this_sym->getLocation(), 0), method_offset * 4);
+    class_decl = dynamic_cast<ClassDecl*>(env->getThisClass());
   } else {
     base_->Emit(falloc, codegen, env);
     if (strcmp(base_->GetRetType()->GetPrintNameForNode(), "ArrayType") == 0 &&
-        strcmp(field_->name(), "length") == 0) {
+        field_->name() == kAtomLength) {
       frame_location_ = codegen->GenLoad(falloc, base_->GetFrameLocation(), 0);
       return;
     }
@@ -890,18 +1009,51 @@ void Call::Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env) {
     }
 
     object_location = base_->GetFrameLocation();
-    method_offset = fn_decl->GetMethodOffset();
+    class_decl = dynamic_cast<ClassDecl*>(class_sym->getNode());
+  }
+
+  // When no class below the receiver's static type overrides the method,
+  // every object it can be runs the same code, so call that directly.
+  method_offset = fn_decl->GetMethodOffset();
+  if (class_decl != 0) {
+    target = class_decl->GetUniqueMethod(method_offset);
+  }
+  ++num_method_calls_;
+  if (target == NULL) {
     method_addr = codegen->GenLoad(falloc,
-        codegen->GenLoad(falloc, base_->GetFrameLocation(), 0),
-                         method_offset * 4);
+        codegen->GenLoad(falloc, object_location, 0), method_offset * 4);
+  } else if (base_ != NULL && dynamic_cast<This*>(base_) == NULL) {
+    // Loading the vtable is what stops a call through null, so a
+    // direct call checks the receiver itself; this is never null.
+    char* not_null = codegen->NewLabel();
+    codegen->GenIfCompare("!=", false, object_location,
+                          codegen->GenLoadConstant(falloc, 0), not_null);
+    codegen->GenPrintError(falloc, kErrorNullObject);
+    codegen->GenLabel(not_null);
   }
 
-  num_params += EmitActuals(falloc, codegen, env);
+  num_params += EmitActuals(falloc, codegen, env, 1);
   ++num_params;
-  codegen->GenPushParam(object_location);
+  codegen->GenPushArg(object_location, 0);
+
+  if (target != NULL) {
+    ++num_direct_calls_;
+    PrintDebug("devirt", "%s: direct call to %s", field_->name(),
+               target->GetMethodLabel());
+    frame_location_ = codegen->GenLCall(falloc, target->GetMethodLabel(),
+                                        has_return_val);
+  } else {
+    frame_location_ = codegen->GenACall(falloc, method_addr, has_return_val);
+  }
+  codegen->GenPopArgs(num_params);
+}
+
+int Call::num_method_calls_ = 0;
+int Call::num_direct_calls_ = 0;
 
-  frame_location_ = codegen->GenACall(falloc, method_addr, has_return_val);
-  codegen->GenPopParams(num_params * 4);
+void Call::ReportDirectCalls() {
+  PrintDebug("devirt", "%d of %d method calls made direct", num_direct_calls_,
+             num_method_calls_);
 }
 
 /* Class: NewExpr
@@ -937,10 +1089,7 @@ void NewExpr::Emit(FrameAllocator* falloc, CodeGenerator* codegen,
   ClassDecl* class_decl = dynamic_cast<ClassDecl*>(class_sym->getNode());
   Assert(class_decl != 0);
 
-  Location* four = codegen->GenLoadConstant(falloc, 4);
-  Location* class_size = codegen->GenBinaryOp(falloc, strdup("*"),
-      codegen->GenLoadConstant(falloc, class_decl->NumFields() + 1), four);
-  loc = codegen->GenBuiltInCall(falloc, Alloc, class_size, NULL);
+  loc = codegen->GenNew(falloc, 4 * (class_decl->NumFields() + 1));
   Location* vtable_label = codegen->GenLoadLabel(falloc, class_decl->GetClassLabel());
   codegen->GenStore(loc, vtable_label, 0);
   frame_location_ = loc;
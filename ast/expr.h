@@ -26,19 +26,28 @@ class Expr : public Stmt {
   Expr(yyltype loc) : Stmt(loc) {
     needs_dereference_ = false;
     reference_ = NULL;
+    reference_offset_ = 0;
   }
   Expr() : Stmt() {}
   void SetRetType(Type* t) { ret_type_ = t; }
   Type* GetRetType() { return ret_type_; }
   virtual bool Check(SymTable* env) { return true; }
+  // Emits the expression as a condition: control reaches true_label
+  // if it holds and false_label if not. Either label may be NULL, in
+  // which case that outcome falls through past the emitted code.
+  virtual void EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                        SymTable* env, const char* true_label,
+                        const char* false_label);
   Location* GetFrameLocation() { return frame_location_; }
   bool NeedsDereference() { return needs_dereference_; }
   Location* GetReference() { return reference_; }
+  int GetReferenceOffset() { return reference_offset_; }
 
  protected:
   Type* ret_type_;
   Location* frame_location_;
   Location* reference_;
+  int reference_offset_;  // bytes from reference_ to the value
   bool needs_dereference_;
 };
 
@@ -61,6 +70,7 @@ class IntConstant : public Expr {
   IntConstant(yyltype loc, int val);
   const char* GetPrintNameForNode() { return "IntConstant"; }
   void PrintChildren(int indent_level);
+  int GetValue() { return value_; }
   bool Check(SymTable* env) { return true; }
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env) {
     frame_location_ = codegen->GenLoadConstant(falloc, value_);
@@ -105,9 +115,11 @@ class StringConstant : public Expr {
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env) {
     frame_location_ = codegen->GenLoadConstant(falloc, value_);
   }
+  // Interned, so equal literals have the same value.
+  Atom GetValue() { return value_; }
 
  protected:
-  char* value_;
+  Atom value_;
 };
 
 class NullConstant: public Expr {
@@ -171,6 +183,9 @@ class RelationalExpr : public CompoundExpr {
   const char* GetPrintNameForNode() { return "RelationalExpr"; }
   bool Check(SymTable* env);
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env);
+  void EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                SymTable* env, const char* true_label,
+                const char* false_label);
 };
 
 class EqualityExpr : public CompoundExpr {
@@ -180,6 +195,9 @@ class EqualityExpr : public CompoundExpr {
   const char* GetPrintNameForNode() { return "EqualityExpr"; }
   bool Check(SymTable* env);
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env);
+  void EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                SymTable* env, const char* true_label,
+                const char* false_label);
 };
 
 class LogicalExpr : public CompoundExpr {
@@ -190,6 +208,9 @@ class LogicalExpr : public CompoundExpr {
   const char* GetPrintNameForNode() { return "LogicalExpr"; }
   bool Check(SymTable* env);
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env);
+  void EmitJump(FrameAllocator* falloc, CodeGenerator* codegen,
+                SymTable* env, const char* true_label,
+                const char* false_label);
 };
 
 class BitwiseExpr : public CompoundExpr {
@@ -280,13 +301,20 @@ class Call : public Expr {
   void PrintChildren(int indent_level);
   bool Check(SymTable* env);
   int EmitActuals(FrameAllocator* falloc, CodeGenerator* codegen,
-                  SymTable* env);
+                  SymTable* env, int first);
   void Emit(FrameAllocator* falloc, CodeGenerator* codegen, SymTable* env);
 
+  // Reports under the "devirt" debug key how many method calls were
+  // emitted as direct calls.
+  static void ReportDirectCalls();
+
  private:
   bool CheckCall(FnDecl* prototype, SymTable* env);
   bool CheckActuals(SymTable* env);
 
+  static int num_method_calls_;
+  static int num_direct_calls_;
+
  protected:
   Expr* base_;  // will be NULL if no explicit base
   Identifier* field_;
@@ -98,6 +98,7 @@ void Program::Emit() {
     }
   }
 
+  Call::ReportDirectCalls();
   codegen_->DoFinalCodeGen();
 }
 
@@ -214,9 +215,9 @@ bool CaseStmt::CheckDecls(SymTable *env) {
     return false;
   }
 
-  case_env_->setBreakNode(this);
+  case_env_->setBreakNode(parent());
   for (int i = 0; i < stmts_->NumElements(); i++) {
-    ret &= stmts_->Nth(i)->CheckDecls(env);
+    ret &= stmts_->Nth(i)->CheckDecls(case_env_);
   }
 
   return ret;
@@ -226,15 +227,22 @@ bool CaseStmt::Check(SymTable *env) {
   bool ret = true;
   ret &= ic_->Check(env);
   for (int i = 0; i < stmts_->NumElements(); i++) {
-    ret &= stmts_->Nth(i)->Check(env);
+    ret &= stmts_->Nth(i)->Check(case_env_);
   }
   return ret;
 }
 
+int CaseStmt::GetValue() {
+  IntConstant *ic = dynamic_cast<IntConstant*>(ic_);
+  Assert(ic != 0);
+  return ic->GetValue();
+}
+
 void CaseStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                          SymTable *env) {
-  // FIXME: Implement CaseStmt IR Generation
-  Failure("Switch not implemented");
+  for (int i = 0; i < stmts_->NumElements(); i++) {
+    stmts_->Nth(i)->Emit(falloc, codegen, case_env_);
+  }
 }
 
 /* Class: DefaultStmt
@@ -257,9 +265,9 @@ bool DefaultStmt::CheckDecls(SymTable *env) {
     return false;
   }
 
-  case_env_->setBreakNode(this);
+  case_env_->setBreakNode(parent());
   for (int i = 0; i < stmts_->NumElements(); i++) {
-    ret &= stmts_->Nth(i)->CheckDecls(env);
+    ret &= stmts_->Nth(i)->CheckDecls(case_env_);
   }
 
   return ret;
@@ -268,7 +276,7 @@ bool DefaultStmt::CheckDecls(SymTable *env) {
 bool DefaultStmt::Check(SymTable *env) {
   bool ret = true;
   for (int i = 0; i < stmts_->NumElements(); i++) {
-    ret &= stmts_->Nth(i)->Check(env);
+    ret &= stmts_->Nth(i)->Check(case_env_);
   }
   return ret;
 }
@@ -276,8 +284,9 @@ bool DefaultStmt::Check(SymTable *env) {
 
 void DefaultStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                        SymTable *env) {
-  // FIXME: Implement DefaultStmt IR Generation
-  Failure("Switch not implemented");
+  for (int i = 0; i < stmts_->NumElements(); i++) {
+    stmts_->Nth(i)->Emit(falloc, codegen, case_env_);
+  }
 }
 
 /* Class: SwitchStmt
@@ -291,6 +300,7 @@ SwitchStmt::SwitchStmt(Expr *testExpr, List<CaseStmt*> *caseStmts,
   (test_ = testExpr)->set_parent(this);
   (cases_ = caseStmts)->SetParentAll(this);
   (default_case_ = defaultStmt)->set_parent(this);
+  after_label_ = NULL;
 }
 
 void SwitchStmt::PrintChildren(int indent_level) {
@@ -323,10 +333,33 @@ bool SwitchStmt::Check(SymTable *env) {
 }
 
 
+/* SwitchStmt::Emit
+ * ----------------
+ * The dispatch comes first, then the cases in order, each falling
+ * through into the next, with the default last.
+ */
 void SwitchStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                       SymTable *env) {
-  // FIXME: Implement SwitchStmt IR Generation
-  Failure("Switch not implemented");
+  after_label_ = codegen->NewLabel();
+  test_->Emit(falloc, codegen, env);
+
+  List<int> values;
+  List<const char*> labels;
+  for (int i = 0; i < cases_->NumElements(); i++) {
+    values.Append(cases_->Nth(i)->GetValue());
+    labels.Append(codegen->NewLabel());
+  }
+  char *defaultLabel = codegen->NewLabel();
+  codegen->GenSwitch(falloc, test_->GetFrameLocation(), &values, &labels,
+                     defaultLabel);
+
+  for (int i = 0; i < cases_->NumElements(); i++) {
+    codegen->GenLabel(labels.Nth(i));
+    cases_->Nth(i)->Emit(falloc, codegen, env);
+  }
+  codegen->GenLabel(defaultLabel);
+  default_case_->Emit(falloc, codegen, env);
+  codegen->GenLabel(after_label_);
 }
 
 /* Class: ForStmt
@@ -375,8 +408,7 @@ void ForStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
   after_label_ = codegen->NewLabel();
   init_->Emit(falloc, codegen, block_env_);
   codegen->GenLabel(loopLabel);
-  test_->Emit(falloc, codegen, block_env_);
-  codegen->GenIfZ(test_->GetFrameLocation(), after_label_);
+  test_->EmitJump(falloc, codegen, block_env_, NULL, after_label_);
   body_->Emit(falloc, codegen, block_env_);
   step_->Emit(falloc, codegen, block_env_);
   codegen->GenGoto(loopLabel);
@@ -418,8 +450,7 @@ void WhileStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
   char *loopLabel = codegen->NewLabel();
   after_label_ = codegen->NewLabel();
   codegen->GenLabel(loopLabel);
-  test_->Emit(falloc, codegen, block_env_);
-  codegen->GenIfZ(test_->GetFrameLocation(), after_label_);
+  test_->EmitJump(falloc, codegen, block_env_, NULL, after_label_);
   body_->Emit(falloc, codegen, block_env_);
   codegen->GenGoto(loopLabel);
   codegen->GenLabel(after_label_);
@@ -474,8 +505,7 @@ void IfStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
   char *ifLabel = codegen->NewLabel();
   char *elseLabel = NULL;
 
-  test_->Emit(falloc, codegen, env);
-  codegen->GenIfZ(test_->GetFrameLocation(), ifLabel);
+  test_->EmitJump(falloc, codegen, env, NULL, ifLabel);
   body_->Emit(falloc, codegen, env);
   if (else_body_) {
     elseLabel = codegen->NewLabel();
@@ -504,8 +534,13 @@ bool BreakStmt::Check(SymTable *env) {
 void BreakStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                      SymTable *env) {
   LoopStmt *loopNode = dynamic_cast<LoopStmt*>(env->getBreakNode());
-  Assert(loopNode != 0);
-  codegen->GenGoto(loopNode->GetAfterLabel());
+  if (loopNode != 0) {
+    codegen->GenGoto(loopNode->GetAfterLabel());
+    return;
+  }
+  SwitchStmt *switchNode = dynamic_cast<SwitchStmt*>(env->getBreakNode());
+  Assert(switchNode != 0);
+  codegen->GenGoto(switchNode->GetAfterLabel());
 }
 
 /* Class: ReturnStmt
@@ -574,25 +609,70 @@ bool PrintStmt::Check(SymTable *env) {
   return ret;
 }
 
+/* PrintStmt::CanJoinCall
+ * -----------------------
+ * An argument may be printed by the same call as the ones before it
+ * only if evaluating it first cannot be told apart: it reads no
+ * input, prints nothing and cannot halt. Constants and plain
+ * variables are the arguments that commonly follow another.
+ */
+bool PrintStmt::CanJoinCall(Expr *arg) {
+  FieldAccess *var = dynamic_cast<FieldAccess*>(arg);
+  if (var != NULL) {
+    return var->GetBase() == NULL;
+  }
+  return (dynamic_cast<IntConstant*>(arg) != NULL
+       || dynamic_cast<BoolConstant*>(arg) != NULL
+       || dynamic_cast<StringConstant*>(arg) != NULL);
+}
+
+/* PrintStmt::KindOf
+ * -----------------
+ * The letter _Print takes in its format for an argument of type t.
+ */
+char PrintStmt::KindOf(Type *t) {
+  if (t->IsConvertableTo(Type::intType)) {
+    return 'i';
+  } else if (t->IsConvertableTo(Type::boolType)) {
+    return 'b';
+  }
+  return 's';
+}
+
+/* PrintStmt::Emit
+ * ---------------
+ * The arguments are printed by as few calls as keep the output in
+ * order with whatever evaluating them does: each run of arguments
+ * that can join the one before it goes to a single _Print.
+ */
 void PrintStmt::Emit(FrameAllocator *falloc, CodeGenerator *codegen,
                      SymTable *env) {
-  Expr *arg = NULL;
-  Location *argloc = NULL;
-  Type *argtype = NULL;
-
-  for (int i = 0; i < args_->NumElements(); i++) {
-    arg = args_->Nth(i);
-    arg->Emit(falloc, codegen, env);
-    argloc = arg->GetFrameLocation();
-    argtype = arg->GetRetType();
-    if (argtype->IsConvertableTo(Type::intType)) {
-      codegen->GenBuiltInCall(falloc, PrintInt, argloc, NULL);
-    } else if (argtype->IsConvertableTo(Type::boolType)) {
-      codegen->GenBuiltInCall(falloc, PrintBool, argloc, NULL);
-    } else if (argtype->IsConvertableTo(Type::stringType)) {
-      codegen->GenBuiltInCall(falloc, PrintString, argloc, NULL);
+  int n = args_->NumElements();
+  char *kinds = new char[n + 1];
+  for (int first = 0; first < n; ) {
+    List<Location*> run;
+    int i = first;
+    do {
+      Expr *arg = args_->Nth(i);
+      arg->Emit(falloc, codegen, env);
+      run.Append(arg->GetFrameLocation());
+      kinds[i - first] = KindOf(arg->GetRetType());
+      i++;
+    } while (i < n && CanJoinCall(args_->Nth(i)));
+    kinds[i - first] = '\0';
+
+    if (run.NumElements() > 1) {
+      codegen->GenPrint(falloc, kinds, &run);
+    } else if (kinds[0] == 'i') {
+      codegen->GenBuiltInCall(falloc, PrintInt, run.Nth(0), NULL);
+    } else if (kinds[0] == 'b') {
+      codegen->GenBuiltInCall(falloc, PrintBool, run.Nth(0), NULL);
+    } else {
+      codegen->GenBuiltInCall(falloc, PrintString, run.Nth(0), NULL);
     }
+    first = i;
   }
+  delete[] kinds;
 }
 
 /* vim: set ai ts=2 sts=2 sw=2 et: */
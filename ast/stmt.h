@@ -80,6 +80,7 @@ class CaseStmt : public Stmt {
   CaseStmt(Expr *intConst, List<Stmt*> *stmtList);
   const char *GetPrintNameForNode() { return "Case"; }
   void PrintChildren(int indent_level);
+  int GetValue();
   bool CheckDecls(SymTable *env);
   bool Check(SymTable *env);
   void Emit(FrameAllocator *falloc, CodeGenerator *codegen, SymTable *env);
@@ -113,11 +114,13 @@ class SwitchStmt : public Stmt {
   bool CheckDecls(SymTable *env);
   bool Check(SymTable *env);
   void Emit(FrameAllocator *falloc, CodeGenerator *codegen, SymTable *env);
+  char *GetAfterLabel() { return after_label_; }
 
  protected:
   Expr *test_;
   List<CaseStmt*> *cases_;
   DefaultStmt *default_case_;
+  char *after_label_;
 };
 
 class LoopStmt : public ConditionalStmt {
@@ -205,6 +208,8 @@ class PrintStmt : public Stmt {
 
  private:
   bool PrintableType(Type *t);
+  bool CanJoinCall(Expr *arg);
+  char KindOf(Type *t);
 
  protected:
   List<Expr*> *args_;
@@ -31,7 +31,7 @@ Type *Type::errorType  = new Type("error");
 
 Type::Type(const char *n) {
   Assert(n);
-  typeName = strdup(n);
+  typeName = Intern(n);
 }
 
 void Type::PrintChildren(int indentLevel) {
@@ -62,7 +62,7 @@ bool NamedType::Check(SymTable *env) {
 bool NamedType::IsConvertableTo(Type *other) {
   Symbol *thisSym = NULL;
   ClassDecl *classDecl = NULL;
-  char *otherName = other->GetName();
+  Atom otherName = other->GetName();
 
   if (other->IsBuiltin()) {
     return false;
@@ -96,7 +96,7 @@ bool NamedType::IsEquivalentTo(Type *other) {
   if (nOther == 0) {
     return false;
   }
-  return (strcmp(id->name(), nOther->GetName()) == 0);
+  return id->name() == nOther->GetName();
 }
 
 /* Class: ArrayType
@@ -22,7 +22,7 @@ class Type : public Node {
   static Type *intType, *doubleType, *boolType, *voidType,
               *nullType, *stringType, *errorType;
 
-  Type(yyltype loc) : Node(loc) {}
+  Type(yyltype loc) : Node(loc) { typeName = NULL; }
   Type(const char *str);
 
   const char *GetPrintNameForNode() { return "Type"; }
@@ -43,12 +43,12 @@ class Type : public Node {
   }
   virtual void PrintToStream(std::ostream& out) { out << typeName; }
   virtual bool Check(SymTable *env) { return true; }
-  virtual char *GetName() { return typeName; }
+  virtual Atom GetName() { return typeName; }
   virtual int GetQualifier() { return 0; }
   virtual Identifier *GetIdent() { return NULL; }
 
  protected:
-  char *typeName;
+  Atom typeName;
 };
 
 class NamedType : public Type {
@@ -58,7 +58,7 @@ class NamedType : public Type {
   const char *GetPrintNameForNode() { return "NamedType"; }
   void PrintChildren(int indentLevel);
   void PrintToStream(std::ostream& out) { out << id; }
-  char *GetName() { return id->name(); }
+  Atom GetName() { return id->name(); }
   Identifier *GetIdent() { return id; }
 
   bool Check(SymTable *env);
@@ -0,0 +1,186 @@
+/* File: hashtable_bench.cc
+ * ------------------------
+ * Microbenchmark for decaf/hashtable.h.  Runs the same workloads
+ * against the open-addressing Hashtable and against the std::multimap
+ * table it replaced (kept here verbatim as MultimapTable), so any
+ * change to the table can be measured against the old baseline.
+ *
+ * Names are interned up front, as the lexer does, so the Hashtable
+ * side sees atoms while the multimap side still compares characters.
+ *
+ * The workloads mirror how SymTable uses a table: lots of small
+ * block scopes that are filled, probed and thrown away, plus a few
+ * big global/class scopes probed with both hits and misses.
+ *
+ * Usage: hashtable_bench [iterations]
+ */
+
+#include <map>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "decaf/atom.h"
+#include "decaf/hashtable.h"
+#include "decaf/utility.h"
+
+/* The bench links arena.cc but not utility.cc, which would drag in the
+ * compiler's flags, so it brings its own Failure. */
+void Failure(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fflush(stdout);
+  fprintf(stderr, "\n*** Failure: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n\n");
+  va_end(args);
+  abort();
+}
+
+struct ltstr {
+  bool operator()(const char* s1, const char* s2) const {
+    return strcmp(s1, s2) < 0;
+  }
+};
+
+/* The previous Hashtable implementation, minus the iterator. */
+template<class Value>
+class MultimapTable {
+ private:
+  std::multimap<const char*, Value, ltstr> mmap;
+
+ public:
+  ~MultimapTable() {
+    typename std::multimap<const char*, Value, ltstr>::iterator itr;
+    for (itr = mmap.begin(); itr != mmap.end(); ++itr) {
+      free((char *) itr->first);
+    }
+  }
+
+  void Enter(const char *key, Value val, bool overwrite = true) {
+    Value prev;
+    if (overwrite && (prev = Lookup(key)))
+      Remove(key, prev);
+    mmap.insert(std::make_pair(strdup(key), val));
+  }
+
+  void Remove(const char *key, Value val) {
+    if (mmap.count(key) == 0) {
+      return;
+    }
+    typename std::multimap<const char *, Value, ltstr>::iterator itr;
+    itr = mmap.find(key);
+    while (itr != mmap.upper_bound(key)) {
+      if (itr->second == val) {
+        free((char *) itr->first);
+        mmap.erase(itr);
+        break;
+      }
+      ++itr;
+    }
+  }
+
+  Value Lookup(const char *key) {
+    Value found = NULL;
+    if (mmap.count(key) > 0) {
+      typename std::multimap<const char *, Value, ltstr>::iterator cur, last, prev;
+      cur = mmap.find(key);
+      last = mmap.upper_bound(key);
+      while (cur != last) {
+        prev = cur;
+        if (++cur == mmap.upper_bound(key)) {
+          found = prev->second;
+          break;
+        }
+      }
+    }
+    return found;
+  }
+};
+
+static const int kNumNames = 2048;
+static char *names[kNumNames];
+static char *misses[kNumNames];
+static int sink;
+
+static void MakeNames() {
+  char buf[32];
+  for (int i = 0; i < kNumNames; i++) {
+    // Mix short loop-variable style names with longer ones.
+    if (i % 4 == 0)
+      sprintf(buf, "%c%d", 'a' + i % 26, i);
+    else
+      sprintf(buf, "identifier_%d_%c", i, 'a' + i % 26);
+    names[i] = (char *) Intern(buf);
+    sprintf(buf, "missing_%d", i);
+    misses[i] = (char *) Intern(buf);
+  }
+}
+
+/* Many small scopes: enter a handful of names, look them and some
+ * outer names up, then drop the table. */
+template <class Table>
+static void BlockScopes(int iterations) {
+  for (int it = 0; it < iterations; it++) {
+    for (int b = 0; b < 64; b++) {
+      Table *t = new Table;
+      int base = (b * 7) % (kNumNames - 8);
+      for (int i = 0; i < 6; i++)
+        t->Enter(names[base + i], names[base + i]);
+      for (int i = 0; i < 24; i++)
+        sink += t->Lookup(names[base + (i % 8)]) != NULL;
+      delete t;
+    }
+  }
+}
+
+/* One big scope probed with hits and misses, with shadowed entries
+ * entered and removed the way class scopes are. */
+template <class Table>
+static void GlobalScope(int iterations) {
+  Table *t = new Table;
+  for (int i = 0; i < kNumNames; i++)
+    t->Enter(names[i], names[i]);
+  for (int it = 0; it < iterations; it++) {
+    for (int i = 0; i < kNumNames; i += 3) {
+      sink += t->Lookup(names[i]) != NULL;
+      sink += t->Lookup(misses[i]) != NULL;
+    }
+    for (int i = 0; i < 32; i++) {
+      t->Enter(names[i], misses[i], false);
+      sink += t->Lookup(names[i]) == misses[i];
+      t->Remove(names[i], misses[i]);
+    }
+  }
+  delete t;
+}
+
+static double Time(void (*fn)(int), int iterations) {
+  clock_t start = clock();
+  fn(iterations);
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void Report(const char *name, double multimap, double hashtable) {
+  printf("%-14s %10.3fs %10.3fs %8.2fx\n", name, multimap, hashtable,
+         hashtable > 0 ? multimap / hashtable : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+  MakeNames();
+
+  printf("%-14s %11s %11s %9s\n", "workload", "multimap", "hashtable",
+         "speedup");
+  Report("block scopes",
+         Time(BlockScopes<MultimapTable<char*> >, iterations),
+         Time(BlockScopes<Hashtable<char*> >, iterations));
+  Report("global scope",
+         Time(GlobalScope<MultimapTable<char*> >, iterations),
+         Time(GlobalScope<Hashtable<char*> >, iterations));
+  return sink == -1;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,483 @@
+/* File: boundscheck.cc
+ * --------------------
+ * Implementation of BoundsCheckElimination.
+ */
+
+#include <limits.h>
+
+#include "codegen/boundscheck.h"
+
+// An array holds fewer than 2^30 elements (each takes 4 bytes), so a
+// value below some array's length plus at most this cannot overflow.
+static const int kMaxStep = 1 << 20;
+
+bool BoundsCheckElimination::Facts::operator==(const Facts &other) const {
+  return reached == other.reached && nonneg == other.nonneg &&
+         below == other.below && lengthOf == other.lengthOf &&
+         constant == other.constant && compares == other.compares;
+}
+
+BoundsCheckElimination::BoundsCheckElimination(FlowGraph *g)
+    : graph(g), vars(g) {
+}
+
+bool BoundsCheckElimination::Run() {
+  Solve();
+  return Rewrite();
+}
+
+template <class Key, class Value>
+static void IntersectMaps(std::map<Key, Value> *a,
+                          const std::map<Key, Value> &b) {
+  typename std::map<Key, Value>::iterator it = a->begin();
+  while (it != a->end()) {
+    typename std::map<Key, Value>::const_iterator other = b.find(it->first);
+    if (other == b.end() || !(other->second == it->second)) {
+      a->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+template <class Key>
+static void IntersectSets(std::set<Key> *a, const std::set<Key> &b) {
+  typename std::set<Key>::iterator it = a->begin();
+  while (it != a->end()) {
+    if (b.count(*it) == 0) {
+      a->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void BoundsCheckElimination::Meet(Facts *facts, const Facts &other) {
+  if (!other.reached) {
+    return;
+  }
+  if (!facts->reached) {
+    *facts = other;
+    return;
+  }
+  IntersectSets(&facts->nonneg, other.nonneg);
+  IntersectSets(&facts->below, other.below);
+  IntersectMaps(&facts->lengthOf, other.lengthOf);
+  IntersectMaps(&facts->constant, other.constant);
+  IntersectMaps(&facts->compares, other.compares);
+}
+
+// Drops every fact that mentions v.
+void BoundsCheckElimination::Kill(Facts *f, int v) {
+  f->nonneg.erase(v);
+  f->constant.erase(v);
+
+  std::set<std::pair<int, int> >::iterator b = f->below.begin();
+  while (b != f->below.end()) {
+    if (b->first == v || b->second == v) {
+      f->below.erase(b++);
+    } else {
+      ++b;
+    }
+  }
+
+  std::map<int, int>::iterator l = f->lengthOf.begin();
+  while (l != f->lengthOf.end()) {
+    if (l->first == v || l->second == v) {
+      f->lengthOf.erase(l++);
+    } else {
+      ++l;
+    }
+  }
+
+  std::map<int, Compare>::iterator c = f->compares.begin();
+  while (c != f->compares.end()) {
+    if (c->first == v || c->second.x == v || c->second.y == v) {
+      f->compares.erase(c++);
+    } else {
+      ++c;
+    }
+  }
+}
+
+bool BoundsCheckElimination::IsConstant(const Facts &f, int v, int *val) {
+  std::map<int, int>::const_iterator it = f.constant.find(v);
+  if (it == f.constant.end()) {
+    return false;
+  }
+  *val = it->second;
+  return true;
+}
+
+// True if v is known to be below the length of some array.
+bool BoundsCheckElimination::IsBounded(const Facts &f, int v) {
+  std::set<std::pair<int, int> >::const_iterator it =
+      f.below.lower_bound(std::make_pair(v, -1));
+  return it != f.below.end() && it->first == v;
+}
+
+// True if x < y is known to hold.
+bool BoundsCheckElimination::LessHolds(const Facts &f, int x, int y) {
+  int cx, cy;
+  std::map<int, int>::const_iterator len = f.lengthOf.find(y);
+  if (len != f.lengthOf.end() && f.below.count(std::make_pair(x, len->second))) {
+    return true;
+  }
+  if (IsConstant(f, x, &cx)) {
+    if (IsConstant(f, y, &cy)) {
+      return cx < cy;
+    }
+    return cx < 0 && f.nonneg.count(y);
+  }
+  return false;
+}
+
+// True if x < y is known not to hold.
+bool BoundsCheckElimination::LessFails(const Facts &f, int x, int y) {
+  int cx, cy;
+  std::map<int, int>::const_iterator len = f.lengthOf.find(x);
+  if (len != f.lengthOf.end() && f.below.count(std::make_pair(y, len->second))) {
+    return true;
+  }
+  if (IsConstant(f, y, &cy)) {
+    if (IsConstant(f, x, &cx)) {
+      return cx >= cy;
+    }
+    return cy <= 0 && f.nonneg.count(x);
+  }
+  return false;
+}
+
+/* BoundsCheckElimination::Decide
+ * ------------------------------
+ * Returns 1 or 0 if the facts settle x rel y, otherwise -1.
+ */
+int BoundsCheckElimination::Decide(const Facts &f, BinaryOp::OpCode rel,
+                                   int x, int y) {
+  if (x < 0 || y < 0) {
+    return -1;
+  }
+  switch (rel) {
+    case BinaryOp::Less:
+      return LessHolds(f, x, y) ? 1 : LessFails(f, x, y) ? 0 : -1;
+    case BinaryOp::GreaterEq:
+      return LessHolds(f, x, y) ? 0 : LessFails(f, x, y) ? 1 : -1;
+    case BinaryOp::Greater:
+      return LessHolds(f, y, x) ? 1 : LessFails(f, y, x) ? 0 : -1;
+    case BinaryOp::LessEq:
+      return LessHolds(f, y, x) ? 0 : LessFails(f, y, x) ? 1 : -1;
+    default: {
+      int cx, cy, result;
+      if (IsConstant(f, x, &cx) && IsConstant(f, y, &cy) &&
+          BinaryOp::Evaluate(rel, cx, cy, &result)) {
+        return result;
+      }
+      return -1;
+    }
+  }
+}
+
+// Records what x < y (or x <= y, if not strict) tells us.
+void BoundsCheckElimination::AssumeLess(Facts *f, int x, int y,
+                                        bool strict) {
+  std::map<int, int>::iterator len = f->lengthOf.find(y);
+  if (strict && len != f->lengthOf.end()) {
+    f->below.insert(std::make_pair(x, len->second));
+  }
+  std::vector<int> arrays;
+  std::set<std::pair<int, int> >::iterator it =
+      f->below.lower_bound(std::make_pair(y, -1));
+  for (; it != f->below.end() && it->first == y; ++it) {
+    arrays.push_back(it->second);
+  }
+  for (size_t i = 0; i < arrays.size(); i++) {
+    f->below.insert(std::make_pair(x, arrays[i]));
+  }
+
+  int cx;
+  if (f->nonneg.count(x) ||
+      (IsConstant(*f, x, &cx) && (cx >= 0 || (strict && cx >= -1)))) {
+    f->nonneg.insert(y);
+  }
+}
+
+void BoundsCheckElimination::Assume(Facts *f, BinaryOp::OpCode rel,
+                                    int x, int y) {
+  if (x < 0 || y < 0) {
+    return;
+  }
+  int c;
+  switch (rel) {
+    case BinaryOp::Less: AssumeLess(f, x, y, true); break;
+    case BinaryOp::LessEq: AssumeLess(f, x, y, false); break;
+    case BinaryOp::Greater: AssumeLess(f, y, x, true); break;
+    case BinaryOp::GreaterEq: AssumeLess(f, y, x, false); break;
+    case BinaryOp::Eq:
+      if (IsConstant(*f, y, &c) && c >= 0) {
+        f->nonneg.insert(x);
+      }
+      if (IsConstant(*f, x, &c) && c >= 0) {
+        f->nonneg.insert(y);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/* BoundsCheckElimination::Transfer
+ * --------------------------------
+ * Works out what holds of the value instr computes while the facts
+ * about its operands are still in place, then replaces the facts
+ * about the destination.
+ */
+void BoundsCheckElimination::Transfer(Instruction *instr, Facts *f) {
+  int d = vars.IndexOf(instr->GetDst());
+  if (d < 0) {
+    return;
+  }
+
+  Facts gen;
+  std::vector<int> arrays;     // d < length of each
+  std::vector<int> indexes;    // each < length of d (d copies an array)
+  std::vector<int> lengths;    // each holds the length of d
+  int lengthOf = -1;
+  int x = instr->NumSrcs() > 0 ? vars.IndexOf(instr->GetSrc(0)) : -1;
+  int y = instr->NumSrcs() > 1 ? vars.IndexOf(instr->GetSrc(1)) : -1;
+  int c;
+
+  LoadConstant *lc = dynamic_cast<LoadConstant*>(instr);
+  BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+  Load *load = dynamic_cast<Load*>(instr);
+  if (lc != 0) {
+    gen.constant[d] = lc->GetValue();
+    if (lc->GetValue() >= 0) {
+      gen.nonneg.insert(d);
+    }
+  } else if (dynamic_cast<Assign*>(instr) != 0 && x >= 0) {
+    if (f->nonneg.count(x)) {
+      gen.nonneg.insert(d);
+    }
+    if (IsConstant(*f, x, &c)) {
+      gen.constant[d] = c;
+    }
+    if (f->compares.count(x)) {
+      gen.compares[d] = f->compares[x];
+    }
+    if (f->lengthOf.count(x)) {
+      lengthOf = f->lengthOf[x];
+    }
+    std::set<std::pair<int, int> >::iterator it;
+    for (it = f->below.begin(); it != f->below.end(); ++it) {
+      if (it->first == x) {
+        arrays.push_back(it->second);
+      }
+      if (it->second == x) {
+        indexes.push_back(it->first);
+      }
+    }
+    std::map<int, int>::iterator len;
+    for (len = f->lengthOf.begin(); len != f->lengthOf.end(); ++len) {
+      if (len->second == x) {
+        lengths.push_back(len->first);
+      }
+    }
+  } else if (load != 0 && load->GetOffset() == 0 && x >= 0) {
+    lengthOf = x;
+  } else if (op != 0) {
+    BinaryOp::OpCode code = op->GetOpCode();
+    int cx, cy, result;
+    if (x >= 0 && y >= 0 && IsConstant(*f, x, &cx) &&
+        IsConstant(*f, y, &cy) && BinaryOp::Evaluate(code, cx, cy, &result)) {
+      gen.constant[d] = result;
+      if (result >= 0) {
+        gen.nonneg.insert(d);
+      }
+    } else if (BinaryOp::IsRelational(code) && x >= 0 && y >= 0) {
+      int decided = Decide(*f, code, x, y);
+      if (decided >= 0) {
+        gen.constant[d] = decided;
+      } else {
+        Compare cmp = { code, x, y };
+        gen.compares[d] = cmp;
+      }
+      gen.nonneg.insert(d);
+    } else if (code == BinaryOp::Add || code == BinaryOp::Sub) {
+      // p + c or p - c, with c a known constant
+      int p = -1;
+      if (x >= 0 && y >= 0 && IsConstant(*f, y, &c)) {
+        p = x;
+      } else if (code == BinaryOp::Add && x >= 0 && y >= 0 &&
+                 IsConstant(*f, x, &c)) {
+        p = y;
+      }
+      if (p >= 0 && code == BinaryOp::Sub) {
+        // p - INT_MIN has no p + c form; learn nothing from it.
+        if (c == INT_MIN) {
+          p = -1;
+        } else {
+          c = -c;
+        }
+      }
+      if (p >= 0 && c <= 0 && c > -kMaxStep) {
+        // Moving down keeps everything p was below, and the length
+        // of an array minus at least one is below that length. Unless
+        // p is known not to be negative (a length never is), moving
+        // down could wrap around to a large index, so nothing carries.
+        bool noWrap = c == 0 || f->nonneg.count(p) || f->lengthOf.count(p);
+        std::set<std::pair<int, int> >::iterator it;
+        for (it = f->below.begin(); noWrap && it != f->below.end(); ++it) {
+          if (it->first == p) {
+            arrays.push_back(it->second);
+          }
+        }
+        if (c < 0 && f->lengthOf.count(p)) {
+          arrays.push_back(f->lengthOf[p]);
+        }
+        if (c == 0 && f->nonneg.count(p)) {
+          gen.nonneg.insert(d);
+        }
+      } else if (p >= 0 && c > 0 && c < kMaxStep && f->nonneg.count(p) &&
+                 IsBounded(*f, p)) {
+        gen.nonneg.insert(d);
+      }
+    }
+  }
+
+  Kill(f, d);
+  f->nonneg.insert(gen.nonneg.begin(), gen.nonneg.end());
+  f->constant.insert(gen.constant.begin(), gen.constant.end());
+  f->compares.insert(gen.compares.begin(), gen.compares.end());
+  if (lengthOf >= 0 && lengthOf != d) {
+    f->lengthOf[d] = lengthOf;
+  }
+  for (size_t i = 0; i < arrays.size(); i++) {
+    if (arrays[i] != d) {
+      f->below.insert(std::make_pair(d, arrays[i]));
+    }
+  }
+  for (size_t i = 0; i < indexes.size(); i++) {
+    if (indexes[i] != d) {
+      f->below.insert(std::make_pair(indexes[i], d));
+    }
+  }
+  for (size_t i = 0; i < lengths.size(); i++) {
+    if (lengths[i] != d) {
+      f->lengthOf[lengths[i]] = d;
+    }
+  }
+}
+
+void BoundsCheckElimination::ComputeIn(BasicBlock *b, Facts *facts) {
+  *facts = Facts();
+  if (b == graph->GetEntry()) {
+    facts->reached = true;
+    return;
+  }
+  List<BasicBlock*> *preds = b->GetPreds();
+  for (int i = 0; i < preds->NumElements(); i++) {
+    BasicBlock *p = preds->Nth(i);
+    for (int k = 0; k < p->GetSuccs()->NumElements(); k++) {
+      if (p->GetSuccs()->Nth(k) == b) {
+        Meet(facts, out[p->GetId()][k]);
+      }
+    }
+  }
+}
+
+/* BoundsCheckElimination::ComputeOut
+ * ----------------------------------
+ * Each edge out of b gets the facts at the end of b, plus what the
+ * branch outcome on that edge implies. The branch target is always
+ * the first successor.
+ */
+void BoundsCheckElimination::ComputeOut(BasicBlock *b, const Facts &facts) {
+  std::vector<Facts> &edges = out[b->GetId()];
+  Instruction *last = b->GetLast();
+  IfCompare *ifc = dynamic_cast<IfCompare*>(last);
+  IfZ *ifz = dynamic_cast<IfZ*>(last);
+
+  for (size_t k = 0; k < edges.size(); k++) {
+    edges[k] = facts;
+    if (ifc != 0) {
+      BinaryOp::OpCode rel = ifc->GetRelation();
+      Assume(&edges[k], k == 0 ? rel : BinaryOp::Negate(rel),
+             vars.IndexOf(ifc->GetSrc(0)), vars.IndexOf(ifc->GetSrc(1)));
+    } else if (ifz != 0) {
+      int t = vars.IndexOf(ifz->GetSrc(0));
+      std::map<int, Compare>::const_iterator cmp = facts.compares.find(t);
+      if (t >= 0 && cmp != facts.compares.end()) {
+        BinaryOp::OpCode rel = cmp->second.rel;
+        Assume(&edges[k], k == 0 ? BinaryOp::Negate(rel) : rel,
+               cmp->second.x, cmp->second.y);
+      }
+    }
+  }
+}
+
+void BoundsCheckElimination::Solve() {
+  int numBlocks = graph->NumBlocks();
+  in.assign(numBlocks, Facts());
+  out.resize(numBlocks);
+  for (int i = 0; i < numBlocks; i++) {
+    out[i].assign(graph->Nth(i)->GetSuccs()->NumElements(), Facts());
+  }
+
+  List<BasicBlock*> *rpo = graph->GetReversePostorder();
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < rpo->NumElements(); i++) {
+      BasicBlock *b = rpo->Nth(i);
+      Facts facts;
+      ComputeIn(b, &facts);
+      if (!facts.reached) {
+        continue;
+      }
+      in[b->GetId()] = facts;
+
+      List<Instruction*> *code = b->GetCode();
+      for (int j = 0; j < code->NumElements(); j++) {
+        Transfer(code->Nth(j), &facts);
+      }
+
+      std::vector<Facts> old = out[b->GetId()];
+      ComputeOut(b, facts);
+      if (!(old == out[b->GetId()])) {
+        changed = true;
+      }
+    }
+  }
+}
+
+bool BoundsCheckElimination::Rewrite() {
+  int numDecided = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    Facts facts = in[b->GetId()];
+    if (!facts.reached) {
+      continue;
+    }
+    List<Instruction*> *code = b->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+      if (op != 0 && BinaryOp::IsRelational(op->GetOpCode())) {
+        int decided = Decide(facts, op->GetOpCode(),
+                             vars.IndexOf(op->GetSrc(0)),
+                             vars.IndexOf(op->GetSrc(1)));
+        if (decided >= 0) {
+          instr = new LoadConstant(op->GetDst(), decided);
+          code->RemoveAt(j);
+          code->InsertAt(instr, j);
+          numDecided++;
+        }
+      }
+      Transfer(instr, &facts);
+    }
+  }
+  PrintDebug("bce", "%d comparisons decided", numDecided);
+  return numDecided > 0;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,99 @@
+/* File: boundscheck.h                                   -*- C++ -*-
+ * -------------------
+ * Array bounds-check elimination over the Tac of one function.
+ *
+ * ArrayAccess::Emit guards every subscript with
+ *
+ *     len = *(arr) ;
+ *     lo = i < 0 ;
+ *     hi = i >= len ;
+ *     bad = lo || hi ;
+ *     IfZ bad Goto ok ;
+ *     ... print error and halt ...
+ *   ok:
+ *
+ * This pass runs a forward "must" dataflow analysis that collects
+ * simple range facts about the function's stack variables at each
+ * point:
+ *   - v >= 0;
+ *   - i < the length of array a;
+ *   - t holds the length of a (t = *(a));
+ *   - v holds a known constant;
+ *   - t holds the outcome of a comparison x rel y.
+ * Facts come from constants, from copies, from adding small
+ * constants to bounded values, and from the branch taken on a
+ * comparison, so the test of a canonical loop such as
+ *
+ *     for (i = 0; i < arr.length(); i = i + 1) ... arr[i] ...
+ *
+ * proves both halves of the check in its body.  A redefinition of
+ * either variable in a fact kills it.  Comparisons the facts decide
+ * are replaced by constants; running ConstantPropagation afterwards
+ * then removes the branch and the error path, and the length load and
+ * comparisons left without a use are dropped before register
+ * allocation.  Checks that cannot be proved stay where they are.
+ */
+
+#ifndef _H_boundscheck
+#define _H_boundscheck
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "codegen/cfg.h"
+#include "codegen/liveness.h"
+
+class BoundsCheckElimination {
+ public:
+  BoundsCheckElimination(FlowGraph *graph);
+
+  // Returns true if any comparison was decided. Reports under the
+  // "bce" debug key.
+  bool Run();
+
+ private:
+  struct Compare {
+    BinaryOp::OpCode rel;
+    int x, y;
+    bool operator==(const Compare &other) const {
+      return rel == other.rel && x == other.x && y == other.y;
+    }
+  };
+
+  struct Facts {
+    bool reached;                         // false is the meet identity
+    std::set<int> nonneg;
+    std::set<std::pair<int, int> > below; // (i, a): i < length of a
+    std::map<int, int> lengthOf;          // t -> a: t holds a's length
+    std::map<int, int> constant;
+    std::map<int, Compare> compares;
+    Facts() : reached(false) {}
+    bool operator==(const Facts &other) const;
+  };
+
+  FlowGraph *graph;
+  FrameVars vars;
+  std::vector<Facts> in;
+  std::vector<std::vector<Facts> > out;   // by block, successor
+
+  static void Meet(Facts *facts, const Facts &other);
+  static void Kill(Facts *facts, int v);
+  static bool IsConstant(const Facts &f, int v, int *val);
+  static bool IsBounded(const Facts &f, int v);
+  static bool LessHolds(const Facts &f, int x, int y);
+  static bool LessFails(const Facts &f, int x, int y);
+  static int Decide(const Facts &f, BinaryOp::OpCode rel, int x, int y);
+  static void AssumeLess(Facts *f, int x, int y, bool strict);
+  static void Assume(Facts *f, BinaryOp::OpCode rel, int x, int y);
+
+  void Transfer(Instruction *instr, Facts *facts);
+  void ComputeIn(BasicBlock *b, Facts *facts);
+  void ComputeOut(BasicBlock *b, const Facts &facts);
+  void Solve();
+  bool Rewrite();
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_boundscheck */
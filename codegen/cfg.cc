@@ -0,0 +1,381 @@
+/* File: cfg.cc
+ * ------------
+ * Implementation of BasicBlock and FlowGraph.
+ */
+
+#include <string>
+#include <vector>
+
+#include "codegen/cfg.h"
+
+/* Class: BasicBlock
+ * -----------------
+ * Implementation for BasicBlock class
+ */
+
+BasicBlock::BasicBlock(int i) {
+  id = i;
+  code = new List<Instruction*>;
+  preds = new List<BasicBlock*>;
+  succs = new List<BasicBlock*>;
+  rpoIndex = -1;
+  idom = NULL;
+  domChildren = new List<BasicBlock*>;
+  domPre = domPost = -1;
+  loopDepth = 0;
+}
+
+BasicBlock::~BasicBlock() {
+  delete code;
+  delete preds;
+  delete succs;
+  delete domChildren;
+}
+
+Instruction *BasicBlock::GetLast() {
+  int n = code->NumElements();
+  return n ? code->Nth(n - 1) : NULL;
+}
+
+/* Class: FlowGraph
+ * ----------------
+ * Implementation for FlowGraph class
+ */
+
+FlowGraph::FlowGraph(List<Instruction*> *code, int begin, int end) {
+  Build(code, begin, end);
+}
+
+FlowGraph::~FlowGraph() {
+  Clear();
+}
+
+/* FlowGraph::Rebuild
+ * ------------------
+ * Recomputes blocks, edges and dominators after a pass has changed
+ * the code. Blocks left empty disappear.
+ */
+void FlowGraph::Rebuild() {
+  List<Instruction*> code;
+  Linearize(&code);
+  Clear();
+  Build(&code, 0, code.NumElements() - 1);
+}
+
+void FlowGraph::Build(List<Instruction*> *code, int begin, int end) {
+  Assert(dynamic_cast<BeginFunc*>(code->Nth(begin)) != 0);
+  Assert(dynamic_cast<EndFunc*>(code->Nth(end)) != 0);
+
+  blocks = new List<BasicBlock*>;
+  rpo = new List<BasicBlock*>;
+
+  Hashtable<BasicBlock*> labels;
+  SplitBlocks(code, begin, end);
+  for (int i = 0; i < blocks->NumElements(); i++) {
+    Label *l = dynamic_cast<Label*>(blocks->Nth(i)->code->Nth(0));
+    if (l != 0) {
+      labels.Enter(l->GetLabel(), blocks->Nth(i));
+    }
+  }
+  AddEdges(&labels);
+  NumberBlocks();
+  ComputeDominators();
+  NumberDominatorTree();
+  ComputeLoopDepths();
+}
+
+void FlowGraph::Clear() {
+  for (int i = 0; i < blocks->NumElements(); i++) {
+    delete blocks->Nth(i);
+  }
+  delete blocks;
+  delete rpo;
+}
+
+// The target of a conditional branch, NULL for anything else.
+static const char *BranchTarget(Instruction *instr) {
+  IfZ *ifz = dynamic_cast<IfZ*>(instr);
+  if (ifz != 0) {
+    return ifz->GetLabel();
+  }
+  IfCompare *ifc = dynamic_cast<IfCompare*>(instr);
+  return ifc != 0 ? ifc->GetLabel() : NULL;
+}
+
+/* FlowGraph::SplitBlocks
+ * ----------------------
+ * A Label always opens a block, and a Goto, a conditional branch, a
+ * jump table or a Return always closes one.
+ */
+void FlowGraph::SplitBlocks(List<Instruction*> *code, int begin, int end) {
+  BasicBlock *cur = NULL;
+  for (int i = begin; i <= end; i++) {
+    Instruction *instr = code->Nth(i);
+    if (cur == NULL || dynamic_cast<Label*>(instr) != 0) {
+      cur = new BasicBlock(blocks->NumElements());
+      blocks->Append(cur);
+    }
+    cur->code->Append(instr);
+    if (dynamic_cast<Goto*>(instr) != 0 || BranchTarget(instr) != NULL ||
+        dynamic_cast<JumpTable*>(instr) != 0 ||
+        dynamic_cast<Return*>(instr) != 0) {
+      cur = NULL;
+    }
+  }
+}
+
+void FlowGraph::AddEdge(BasicBlock *from, BasicBlock *to) {
+  Assert(to != NULL);
+  from->succs->Append(to);
+  to->preds->Append(from);
+}
+
+void FlowGraph::AddEdges(Hashtable<BasicBlock*> *labels) {
+  int n = blocks->NumElements();
+  for (int i = 0; i < n; i++) {
+    BasicBlock *b = blocks->Nth(i);
+    Instruction *last = b->GetLast();
+    Goto *go = dynamic_cast<Goto*>(last);
+    JumpTable *table = dynamic_cast<JumpTable*>(last);
+    const char *target = BranchTarget(last);
+
+    if (go != 0) {
+      AddEdge(b, labels->Lookup(go->GetLabel()));
+      continue;
+    }
+    if (table != 0) {
+      // one edge per distinct target, the table repeats them
+      List<const char*> *targets = table->GetTargets();
+      for (int k = 0; k < targets->NumElements(); k++) {
+        BasicBlock *to = labels->Lookup(targets->Nth(k));
+        bool seen = false;
+        for (int m = 0; !seen && m < b->succs->NumElements(); m++) {
+          seen = b->succs->Nth(m) == to;
+        }
+        if (!seen) {
+          AddEdge(b, to);
+        }
+      }
+      continue;
+    }
+    if (dynamic_cast<Return*>(last) != 0) {
+      continue;
+    }
+    if (target != NULL) {
+      AddEdge(b, labels->Lookup(target));
+    }
+    if (i + 1 < n) {
+      AddEdge(b, blocks->Nth(i + 1));
+    }
+  }
+}
+
+/* FlowGraph::NumberBlocks
+ * -----------------------
+ * Depth-first walk from the entry (with an explicit stack, functions
+ * can be long) recording the postorder; the reverse postorder is what
+ * the dataflow passes iterate over.
+ */
+void FlowGraph::NumberBlocks() {
+  List<BasicBlock*> stack;
+  List<int> next;      // index of the next successor to visit
+  List<BasicBlock*> post;
+
+  GetEntry()->rpoIndex = 0;     // marks visited until renumbered
+  stack.Append(GetEntry());
+  next.Append(0);
+  while (stack.NumElements() > 0) {
+    int top = stack.NumElements() - 1;
+    BasicBlock *b = stack.Nth(top);
+    int k = next.Nth(top);
+    if (k < b->succs->NumElements()) {
+      next.RemoveAt(top);
+      next.Append(k + 1);
+      BasicBlock *s = b->succs->Nth(k);
+      if (s->rpoIndex < 0) {
+        s->rpoIndex = 0;
+        stack.Append(s);
+        next.Append(0);
+      }
+    } else {
+      post.Append(b);
+      stack.RemoveAt(top);
+      next.RemoveAt(top);
+    }
+  }
+
+  int count = post.NumElements();
+  for (int i = count - 1; i >= 0; i--) {
+    BasicBlock *b = post.Nth(i);
+    b->rpoIndex = rpo->NumElements();
+    rpo->Append(b);
+  }
+}
+
+static BasicBlock *Intersect(BasicBlock *b1, BasicBlock *b2) {
+  while (b1 != b2) {
+    while (b1->GetRpoIndex() > b2->GetRpoIndex()) {
+      b1 = b1->GetIdom();
+    }
+    while (b2->GetRpoIndex() > b1->GetRpoIndex()) {
+      b2 = b2->GetIdom();
+    }
+  }
+  return b1;
+}
+
+/* FlowGraph::ComputeDominators
+ * ----------------------------
+ * Cooper, Harvey & Kennedy, "A Simple, Fast Dominance Algorithm".
+ * While iterating, the entry is its own idom so Intersect terminates;
+ * it is reset to NULL once the tree is final.
+ */
+void FlowGraph::ComputeDominators() {
+  BasicBlock *entry = GetEntry();
+  entry->idom = entry;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < rpo->NumElements(); i++) {
+      BasicBlock *b = rpo->Nth(i);
+      BasicBlock *newIdom = NULL;
+      for (int j = 0; j < b->preds->NumElements(); j++) {
+        BasicBlock *p = b->preds->Nth(j);
+        if (p->idom == NULL) {  // unreachable or not yet processed
+          continue;
+        }
+        newIdom = newIdom ? Intersect(p, newIdom) : p;
+      }
+      if (b->idom != newIdom) {
+        b->idom = newIdom;
+        changed = true;
+      }
+    }
+  }
+
+  entry->idom = NULL;
+  for (int i = 1; i < rpo->NumElements(); i++) {
+    BasicBlock *b = rpo->Nth(i);
+    b->idom->domChildren->Append(b);
+  }
+}
+
+/* FlowGraph::NumberDominatorTree
+ * ------------------------------
+ * Gives each reachable block the interval [domPre, domPost] of a
+ * preorder walk over the dominator tree, so Dominates is two
+ * comparisons.
+ */
+void FlowGraph::NumberDominatorTree() {
+  List<BasicBlock*> stack;
+  List<int> next;
+  int counter = 0;
+
+  GetEntry()->domPre = counter++;
+  stack.Append(GetEntry());
+  next.Append(0);
+  while (stack.NumElements() > 0) {
+    int top = stack.NumElements() - 1;
+    BasicBlock *b = stack.Nth(top);
+    int k = next.Nth(top);
+    if (k < b->domChildren->NumElements()) {
+      next.RemoveAt(top);
+      next.Append(k + 1);
+      BasicBlock *c = b->domChildren->Nth(k);
+      c->domPre = counter++;
+      stack.Append(c);
+      next.Append(0);
+    } else {
+      b->domPost = counter++;
+      stack.RemoveAt(top);
+      next.RemoveAt(top);
+    }
+  }
+}
+
+/* FlowGraph::ComputeLoopDepths
+ * -----------------------------
+ * For each loop header (a block with a predecessor it dominates) the
+ * body is everything that reaches one of those back edges without
+ * passing through the header; every block in it goes one level
+ * deeper. Back edges to the same header form a single loop.
+ */
+void FlowGraph::ComputeLoopDepths() {
+  std::vector<BasicBlock*> inLoop(blocks->NumElements(), (BasicBlock*)NULL);
+  List<BasicBlock*> work;
+
+  for (int i = 0; i < rpo->NumElements(); i++) {
+    BasicBlock *h = rpo->Nth(i);
+    for (int j = 0; j < h->preds->NumElements(); j++) {
+      BasicBlock *p = h->preds->Nth(j);
+      if (Dominates(h, p)) {
+        work.Append(p);
+      }
+    }
+    if (work.NumElements() == 0) {
+      continue;
+    }
+
+    inLoop[h->id] = h;
+    h->loopDepth++;
+    while (work.NumElements() > 0) {
+      BasicBlock *b = work.Nth(work.NumElements() - 1);
+      work.RemoveAt(work.NumElements() - 1);
+      if (inLoop[b->id] == h || !b->IsReachable()) {
+        continue;
+      }
+      inLoop[b->id] = h;
+      b->loopDepth++;
+      for (int j = 0; j < b->preds->NumElements(); j++) {
+        work.Append(b->preds->Nth(j));
+      }
+    }
+  }
+}
+
+bool FlowGraph::Dominates(BasicBlock *a, BasicBlock *b) {
+  if (!a->IsReachable() || !b->IsReachable()) {
+    return false;
+  }
+  return a->domPre <= b->domPre && b->domPost <= a->domPost;
+}
+
+void FlowGraph::Linearize(List<Instruction*> *out) {
+  for (int i = 0; i < blocks->NumElements(); i++) {
+    List<Instruction*> *code = blocks->Nth(i)->code;
+    for (int j = 0; j < code->NumElements(); j++) {
+      out->Append(code->Nth(j));
+    }
+  }
+}
+
+static std::string BlockNames(List<BasicBlock*> *list) {
+  std::string names;
+  char buf[16];
+  for (int i = 0; i < list->NumElements(); i++) {
+    sprintf(buf, " B%d", list->Nth(i)->GetId());
+    names += buf;
+  }
+  return names.empty() ? " -" : names;
+}
+
+void FlowGraph::Print() {
+  for (int i = 0; i < blocks->NumElements(); i++) {
+    BasicBlock *b = blocks->Nth(i);
+    Label *l = dynamic_cast<Label*>(b->code->Nth(0));
+    char idom[16] = "-";
+    if (b->idom) {
+      sprintf(idom, "B%d", b->idom->id);
+    }
+    PrintDebug("cfg", "B%d%s%s (%d instrs)%s preds:%s succs:%s idom: %s "
+               "loop depth: %d",
+               b->id, l ? " " : "", l ? l->GetLabel() : "",
+               b->code->NumElements(),
+               b->IsReachable() ? "" : " unreachable",
+               BlockNames(b->preds).c_str(), BlockNames(b->succs).c_str(),
+               idom, b->loopDepth);
+  }
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,115 @@
+/* File: cfg.h                                           -*- C++ -*-
+ * -----------
+ * Control-flow graph over the Tac of a single function.
+ *
+ * A FlowGraph is built from the instructions between a BeginFunc and
+ * its EndFunc (inclusive).  The region is cut into basic blocks: a
+ * block starts at the BeginFunc, at every Label and after every Goto,
+ * conditional branch (IfZ, IfCompare) and Return, and runs up to the
+ * next such boundary.  Edges follow the branch at the end of each
+ * block (Goto to its target, a conditional branch to its target and
+ * the next block, Return nowhere) or fall through to the next block.
+ *
+ * On top of the edges the graph numbers the reachable blocks in
+ * reverse postorder and computes the dominator tree, using the
+ * iterative scheme of Cooper, Harvey and Kennedy.  Natural loops
+ * (an edge back to a block that dominates its source) give each
+ * block its loop nesting depth.  Both the block
+ * split and the edge construction are a single linear pass; the
+ * dominator iteration settles in two passes over the reverse
+ * postorder on the structured (reducible) graphs Decaf produces.
+ *
+ * Passes may rewrite the instruction list of any block and then
+ * Rebuild the graph if they changed its shape.  Linearize writes the
+ * blocks back out in their original order.
+ */
+
+#ifndef _H_cfg
+#define _H_cfg
+
+#include "codegen/tac.h"
+#include "decaf/hashtable.h"
+#include "decaf/list.h"
+
+class FlowGraph;
+
+class BasicBlock {
+  friend class FlowGraph;
+
+ public:
+  BasicBlock(int id);
+  ~BasicBlock();
+
+  int GetId() { return id; }
+  List<Instruction*> *GetCode() { return code; }
+  Instruction *GetLast();
+
+  List<BasicBlock*> *GetPreds() { return preds; }
+  List<BasicBlock*> *GetSuccs() { return succs; }
+
+  // Reverse postorder number, -1 if unreachable from the entry
+  int GetRpoIndex() { return rpoIndex; }
+  bool IsReachable() { return rpoIndex >= 0; }
+
+  // Immediate dominator (NULL for the entry and unreachable blocks)
+  // and the blocks it immediately dominates.
+  BasicBlock *GetIdom() { return idom; }
+  List<BasicBlock*> *GetDomChildren() { return domChildren; }
+
+  // Number of natural loops the block belongs to
+  int GetLoopDepth() { return loopDepth; }
+
+ protected:
+  int id;
+  List<Instruction*> *code;
+  List<BasicBlock*> *preds, *succs;
+  int rpoIndex;
+  BasicBlock *idom;
+  List<BasicBlock*> *domChildren;
+  int domPre, domPost;  // dominator tree DFS interval
+  int loopDepth;
+};
+
+class FlowGraph {
+ public:
+  // Builds the graph for code[begin..end], where code[begin] is a
+  // BeginFunc and code[end] the matching EndFunc.
+  FlowGraph(List<Instruction*> *code, int begin, int end);
+  ~FlowGraph();
+
+  int NumBlocks() { return blocks->NumElements(); }
+  BasicBlock *Nth(int i) { return blocks->Nth(i); }
+  BasicBlock *GetEntry() { return blocks->Nth(0); }
+
+  // Reachable blocks, in reverse postorder
+  List<BasicBlock*> *GetReversePostorder() { return rpo; }
+
+  // True if every path from the entry to b passes through a.
+  bool Dominates(BasicBlock *a, BasicBlock *b);
+
+  // Recomputes the graph from the blocks' current code.
+  void Rebuild();
+
+  // Appends the function's instructions, block by block, to out.
+  void Linearize(List<Instruction*> *out);
+
+  // Dumps blocks, edges and dominators under the "cfg" debug key.
+  void Print();
+
+ private:
+  List<BasicBlock*> *blocks;
+  List<BasicBlock*> *rpo;
+
+  void Build(List<Instruction*> *code, int begin, int end);
+  void Clear();
+  void SplitBlocks(List<Instruction*> *code, int begin, int end);
+  void AddEdge(BasicBlock *from, BasicBlock *to);
+  void AddEdges(Hashtable<BasicBlock*> *labels);
+  void NumberBlocks();
+  void ComputeDominators();
+  void NumberDominatorTree();
+  void ComputeLoopDepths();
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_cfg */
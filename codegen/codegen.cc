@@ -5,17 +5,30 @@
  * classes and append them to the list.
  */
 
+#include <limits.h>
 #include <string.h>
 
+#include <algorithm>
+#include <map>
+
+#include "codegen/boundscheck.h"
+#include "codegen/cfg.h"
+#include "codegen/constprop.h"
+#include "codegen/inline.h"
+#include "codegen/liveness.h"
+#include "codegen/regalloc.h"
+#include "codegen/slots.h"
+#include "codegen/strength.h"
 #include "codegen/codegen.h"
 #include "decaf/errors.h"
 
-#include "arch/mips/tac.h"
-#include "arch/mips/mips.h"
+#include "codegen/tac.h"
+#include "codegen/emitter.h"
 
 CodeGenerator::CodeGenerator() {
   code = new List<Instruction*>();
   mainFound = false;
+  target = TargetEmitter::ForTarget(kTargetFlag);
 }
 
 char *CodeGenerator::NewLabel() {
@@ -25,7 +38,7 @@ char *CodeGenerator::NewLabel() {
   return strdup(temp);
 }
 
-char *CodeGenerator::NewClassLabel(char *className) {
+char *CodeGenerator::NewClassLabel(const char *className) {
   int len = strlen(className) + 3;
   char *label = (char *) malloc(len);
   if (label == NULL) {
@@ -36,11 +49,11 @@ char *CodeGenerator::NewClassLabel(char *className) {
   return label;
 }
 
-char *CodeGenerator::NewFunctionLabel(char *functionName) {
+char *CodeGenerator::NewFunctionLabel(const char *functionName) {
   int len = strlen(functionName) + 3;
   char *label = NULL;
   if (strcmp(functionName, "main") == 0) {
-    return functionName;
+    return strdup(functionName);
   }
 
   label = (char *) malloc(len);
@@ -98,41 +111,18 @@ void CodeGenerator::GenStore(Location *dst, Location *src, int offset) {
 
 Location *CodeGenerator::GenBinaryOp(FrameAllocator *falloc,
     const char *opName, Location *op1, Location *op2) {
-  Location *result = NULL;
-  if (strcmp(opName, "!=") == 0) {
-    // !(op1 == op2)
-    Location *eq = GenBinaryOp(falloc, "==", op1, op2);
-    result = GenUnaryOp(falloc, "!", eq);
-  } else if (strcmp(opName, ">") == 0) {
-    // !(op1 < op2) && !(op1 == op2)
-    Location *eq = GenBinaryOp(falloc, "==", op1, op2);
-    Location *lt = GenBinaryOp(falloc, "<", op1, op2);
-    Location *neq = GenUnaryOp(falloc, "!", eq);
-    Location *nlt = GenUnaryOp(falloc, "!", lt);
-    result = GenBinaryOp(falloc, "&&", neq, nlt);
-  } else if (strcmp(opName, "<=") == 0) {
-    // (op1 == op2) || (op1 < op2)
-    Location *eq = GenBinaryOp(falloc, "==", op1, op2);
-    Location *lt = GenBinaryOp(falloc, "<", op1, op2);
-    result = GenBinaryOp(falloc, "||", eq, lt);
-  } else if (strcmp(opName, ">=") == 0) {
-    // !(op1 < op2)
-    Location *lt = GenBinaryOp(falloc, "<", op1, op2);
-    result = GenUnaryOp(falloc, "!", lt);
+  BinaryOp::OpCode opcode;
+  if (strcmp(opName, "|") == 0) {
+    opcode = BinaryOp::Or;
+  } else if (strcmp(opName, "&") == 0) {
+    opcode = BinaryOp::And;
   } else {
-    BinaryOp::OpCode opcode;
-    if (strcmp(opName, "|") == 0) {
-      opcode = BinaryOp::Or;
-    } else if (strcmp(opName, "&") == 0) {
-      opcode = BinaryOp::And;
-    } else {
-      opcode = BinaryOp::OpCodeForName(opName);
-    }
-
-    result = GenTempVar(falloc);
-    code->Append(new BinaryOp(opcode, result, op1, op2));
-    return result;
+    opcode = BinaryOp::OpCodeForName(opName);
   }
+
+  Location *result = GenTempVar(falloc);
+  code->Append(new BinaryOp(opcode, result, op1, op2));
+  return result;
 }
 
 Location *CodeGenerator::GenUnaryOp(FrameAllocator *falloc,
@@ -188,10 +178,102 @@ void CodeGenerator::GenIfZ(Location *test, const char *label) {
   code->Append(new IfZ(test, label));
 }
 
+void CodeGenerator::GenIfCompare(const char *relOp, bool negated,
+                                 Location *op1, Location *op2,
+                                 const char *label) {
+  BinaryOp::OpCode rel = BinaryOp::OpCodeForName(relOp);
+  Assert(BinaryOp::IsRelational(rel));
+  if (negated) {
+    rel = BinaryOp::Negate(rel);
+  }
+  code->Append(new IfCompare(rel, op1, op2, label));
+}
+
 void CodeGenerator::GenGoto(const char *label) {
   code->Append(new Goto(label));
 }
 
+/* CodeGenerator::GenSwitch
+ * ------------------------
+ * A jump table pays off once there are a few cases and they fill at
+ * least a third of the range between the smallest and largest; the
+ * slots in between go to the default. Otherwise the cases, sorted
+ * by value, are searched as a binary tree of compares.
+ */
+void CodeGenerator::GenSwitch(FrameAllocator *falloc, Location *test,
+                              List<int> *values, List<const char*> *labels,
+                              const char *defaultLabel) {
+  static const int kMinTableCases = 4, kMaxTableSpread = 3;
+
+  // (value, case), the first case with a value wins
+  std::vector<std::pair<int, int> > cases;
+  for (int i = 0; i < values->NumElements(); i++) {
+    cases.push_back(std::make_pair(values->Nth(i), i));
+  }
+  std::sort(cases.begin(), cases.end());
+  size_t kept = 0;
+  for (size_t i = 0; i < cases.size(); i++) {
+    if (kept == 0 || cases[kept - 1].first != cases[i].first) {
+      cases[kept++] = cases[i];
+    }
+  }
+  cases.resize(kept);
+
+  int n = cases.size();
+  if (n == 0) {
+    GenGoto(defaultLabel);
+    return;
+  }
+  int lo = cases.front().first, hi = cases.back().first;
+  double range = (double) hi - lo + 1;
+  if (n < kMinTableCases || range > (double) kMaxTableSpread * n) {
+    PrintDebug("switch", "binary search over %d cases", n);
+    GenSearch(falloc, test, cases, 0, n - 1, labels, defaultLabel);
+    return;
+  }
+
+  PrintDebug("switch", "jump table of %d for %d cases", (int) range, n);
+  Location *min = GenLoadConstant(falloc, lo);
+  GenIfCompare("<", false, test, min, defaultLabel);
+  Location *max = GenLoadConstant(falloc, hi);
+  GenIfCompare(">", false, test, max, defaultLabel);
+  Location *index = lo == 0 ? test : GenBinaryOp(falloc, "-", test, min);
+  List<const char*> *targets = new List<const char*>;
+  for (int i = 0; i < n; i++) {
+    while (lo + targets->NumElements() < cases[i].first) {
+      targets->Append(defaultLabel);
+    }
+    targets->Append(labels->Nth(cases[i].second));
+  }
+  code->Append(new JumpTable(index, NewLabel(), targets));
+}
+
+// Dispatches on cases[lo..hi], a handful of them by testing each in
+// turn.
+void CodeGenerator::GenSearch(FrameAllocator *falloc, Location *test,
+                              const std::vector<std::pair<int, int> > &cases,
+                              int lo, int hi, List<const char*> *labels,
+                              const char *defaultLabel) {
+  static const int kMaxLinearCases = 3;
+
+  if (hi - lo + 1 <= kMaxLinearCases) {
+    for (int i = lo; i <= hi; i++) {
+      Location *value = GenLoadConstant(falloc, cases[i].first);
+      GenIfCompare("==", false, test, value, labels->Nth(cases[i].second));
+    }
+    GenGoto(defaultLabel);
+    return;
+  }
+  int mid = lo + (hi - lo) / 2;
+  char *upper = NewLabel();
+  Location *value = GenLoadConstant(falloc, cases[mid].first);
+  GenIfCompare("==", false, test, value, labels->Nth(cases[mid].second));
+  GenIfCompare(">", false, test, value, upper);
+  GenSearch(falloc, test, cases, lo, mid - 1, labels, defaultLabel);
+  GenLabel(upper);
+  GenSearch(falloc, test, cases, mid + 1, hi, labels, defaultLabel);
+}
+
 void CodeGenerator::GenReturn(Location *val) {
   code->Append(new Return(val));
 }
@@ -217,6 +299,18 @@ void CodeGenerator::GenPopParams(int numBytesOfParams) {
   }
 }
 
+void CodeGenerator::GenPushArg(Location *arg, int index) {
+  code->Append(new PushParam(arg, index < NumRegisterArgs() ? index : -1));
+}
+
+void CodeGenerator::GenPopArgs(int numArgs) {
+  GenPopParams(VarSize * std::max(numArgs - NumRegisterArgs(), 0));
+}
+
+int CodeGenerator::NumRegisterArgs() {
+  return kCallFlag == CALL_REGISTER ? target->GetNumArgRegs() : 0;
+}
+
 Location *CodeGenerator::GenLCall(FrameAllocator *falloc, const char *label,
     bool fnHasReturnValue) {
   Location *result = fnHasReturnValue ? GenTempVar(falloc) : NULL;
@@ -243,7 +337,9 @@ static struct _builtin {
     { "_PrintInt",    1, false },
     { "_PrintString", 1, false },
     { "_PrintBool",   1, false },
-    { "_Halt",        0, false }
+    { "_Halt",        0, false },
+    { "_GCInit",      2, false },
+    { "_Print",       1, false }
 };
 
 Location *CodeGenerator::GenBuiltInCall(FrameAllocator *falloc, BuiltIn bn,
@@ -275,6 +371,56 @@ Location *CodeGenerator::GenBuiltInCall(FrameAllocator *falloc, BuiltIn bn,
   return result;
 }
 
+/* CodeGenerator::GenPrint
+ * -----------------------
+ * _Print takes the kinds as a string constant, followed by the
+ * arguments they describe, so it can walk both together.
+ */
+void CodeGenerator::GenPrint(FrameAllocator *falloc, const char *kinds,
+    List<Location*> *args) {
+  int n = args->NumElements();
+  Assert(n > 0 && (int)strlen(kinds) == n);
+  Location *format = GenLoadConstant(falloc, kinds);
+  for (int i = n - 1; i >= 0; i--) {
+    code->Append(new PushParam(args->Nth(i)));
+  }
+  code->Append(new PushParam(format));
+  code->Append(new LCall(builtins[Print].label, NULL));
+  GenPopParams(VarSize * (n + 1));
+}
+
+/* CodeGenerator::GenNew
+ * ---------------------
+ * The runtime serves objects up to MaxInlineAllocSize bytes from a
+ * chunk per size class, in steps of a word. _AllocClasses has an
+ * entry per class, indexed by size / 4, holding the next free byte of
+ * the chunk and its end. An object of known size takes the next slot
+ * of its class straight from there, and Alloc is only called to start
+ * a new chunk.
+ */
+Location *CodeGenerator::GenNew(FrameAllocator *falloc, int numBytes) {
+  Assert(numBytes > 0 && numBytes % VarSize == 0);
+  if (numBytes > MaxInlineAllocSize) {
+    return GenBuiltInCall(falloc, Alloc, GenLoadConstant(falloc, numBytes));
+  }
+
+  int entry = AllocClassEntrySize * (numBytes / VarSize);
+  char *slow = NewLabel(), *done = NewLabel();
+  Location *classes = GenLoadLabel(falloc, "_AllocClasses");
+  Location *result = GenLoad(falloc, classes, entry + AllocClassNextOffset);
+  Location *end = GenBinaryOp(falloc, "+", result,
+                              GenLoadConstant(falloc, numBytes));
+  Location *limit = GenLoad(falloc, classes, entry + AllocClassLimitOffset);
+  GenIfCompare("u>", false, end, limit, slow);
+  GenStore(classes, end, entry + AllocClassNextOffset);
+  GenGoto(done);
+  GenLabel(slow);
+  GenAssign(result, GenBuiltInCall(falloc, Alloc,
+                                   GenLoadConstant(falloc, numBytes)));
+  GenLabel(done);
+  return result;
+}
+
 void CodeGenerator::GenPrintError(FrameAllocator *falloc,
     const char * const message) {
   Location *errString = GenLoadConstant(falloc, message);
@@ -289,22 +435,264 @@ void CodeGenerator::GenVTable(const char *className,
 }
 
 
+void CodeGenerator::OptimizeFunctions() {
+  List<Instruction*> *inlined = Inliner(this).Run(code);
+  delete code;
+  code = inlined;
+
+  List<Instruction*> *result = new List<Instruction*>;
+  int n = code->NumElements();
+
+  for (int i = 0; i < n; i++) {
+    if (dynamic_cast<BeginFunc*>(code->Nth(i)) == 0) {
+      result->Append(code->Nth(i));
+      continue;
+    }
+
+    int end = i;
+    while (dynamic_cast<EndFunc*>(code->Nth(end)) == 0) {
+      end++;
+    }
+    FlowGraph graph(code, i, end);
+    OptimizeFunction(&graph);
+    graph.Linearize(result);
+    i = end;
+  }
+
+  delete code;
+  code = result;
+}
+
+void CodeGenerator::OptimizeFunction(FlowGraph *graph) {
+  if (IsDebugOn("cfg")) {
+    graph->Print();
+  }
+
+  ConstantPropagation(graph).Run();
+  if (BoundsCheckElimination(graph).Run()) {
+    ConstantPropagation(graph).Run();
+  }
+  StrengthReduction(graph).Run();
+
+  Liveness *liveness = new Liveness(graph);
+  if (FuseCompareBranches(graph, liveness)) {
+    delete liveness;
+    liveness = new Liveness(graph);
+  }
+  if (SelectImmediates(graph)) {
+    delete liveness;
+    liveness = new Liveness(graph);
+  }
+  // A value removed in one block may have been all that kept values
+  // in the blocks before it alive.
+  while (RemoveDeadValues(graph, liveness)) {
+    delete liveness;
+    liveness = new Liveness(graph);
+  }
+
+  RegisterAllocator allocator(graph, liveness,
+                              target->GetNumAllocatableRegs());
+  allocator.Allocate();
+  liveness->MarkDeadOperands();
+  SlotPacking(graph, liveness).Run();
+  delete liveness;
+
+  BasicBlock *exit = graph->Nth(graph->NumBlocks() - 1);
+  dynamic_cast<EndFunc*>(exit->GetLast())->SetReachable(exit->IsReachable());
+
+  if (kCallFlag == CALL_REGISTER) {
+    BeginFunc *begin =
+        dynamic_cast<BeginFunc*>(graph->GetEntry()->GetCode()->Nth(0));
+    begin->SetLeaf(IsLeaf(graph));
+  }
+}
+
+// True if nothing in graph makes a call, built-ins included.
+bool CodeGenerator::IsLeaf(FlowGraph *graph) {
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      if (dynamic_cast<LCall*>(code->Nth(j)) != 0 ||
+          dynamic_cast<ACall*>(code->Nth(j)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* CodeGenerator::RemoveDeadValues
+ * -------------------------------
+ * Drops constants, loads, copies and arithmetic whose result is never
+ * read: temps the front end made for values nobody used, the length
+ * load and comparisons of a bounds check that has been decided, the
+ * address arithmetic a walked pointer replaced and stores to locals
+ * that are not read again. Division is kept since it may trap, and so
+ * is a load through a pointer that may be null or wild, whose fault is
+ * how the program would have stopped. Only a load through a method's
+ * own this (see Location::IsNonNull) cannot fault: its object was
+ * reached to make the call, and its fields lie within it. Walking each
+ * block backwards lets a removal free the operands that fed it.
+ * Returns true if anything was removed.
+ */
+bool CodeGenerator::RemoveDeadValues(FlowGraph *graph, Liveness *liveness) {
+  int numRemoved = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *block = b->GetCode();
+    BitVector live = liveness->LiveOut(b);
+    for (int j = block->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = block->Nth(j);
+      BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+      Load *load = dynamic_cast<Load*>(instr);
+      bool pure = dynamic_cast<LoadConstant*>(instr) != 0 ||
+                  dynamic_cast<LoadStringConstant*>(instr) != 0 ||
+                  dynamic_cast<LoadLabel*>(instr) != 0 ||
+                  dynamic_cast<Assign*>(instr) != 0 ||
+                  (load != 0 && load->GetSrc(0)->IsNonNull()) ||
+                  (op != 0 && op->GetOpCode() != BinaryOp::Div &&
+                   op->GetOpCode() != BinaryOp::Mod);
+      int d = liveness->IndexOf(instr->GetDst());
+      if (pure && d >= 0 && !live.Test(d)) {
+        block->RemoveAt(j);
+        numRemoved++;
+      } else {
+        liveness->Transfer(instr, &live);
+      }
+    }
+  }
+  PrintDebug("dead", "%d dead values removed", numRemoved);
+  return numRemoved > 0;
+}
+
+/* CodeGenerator::SelectImmediates
+ * -------------------------------
+ * Gives a BinaryOp whose second operand (or first, when the operation
+ * commutes) holds a constant loaded earlier in the block the target's
+ * immediate form, so the constant needs no register:
+ *     x + c, c + x, x - c      =>  x + c'   (addiu)
+ *     x * 2^k, 2^k * x         =>  x << k   (sll)
+ *     x < c, x <= c            =>  x < c'   (slti)
+ *     x & c, x | c, x ^ c      =>  andi, ori, xori
+ *     x << c, x >> c           =>  sll, srl
+ * when c' fits. Comparisons fused into a branch were taken care of
+ * before this runs. Returns true if anything changed; the constant
+ * loads left unread are then removed as dead.
+ */
+bool CodeGenerator::SelectImmediates(FlowGraph *graph) {
+  FrameVars vars(graph);
+  int numSelected = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *block = graph->Nth(i)->GetCode();
+    std::map<int, int> constants;
+    for (int j = 0; j < block->NumElements(); j++) {
+      Instruction *instr = block->Nth(j);
+      BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+      if (op != 0 && !op->HasImmediate()) {
+        BinaryOp::OpCode code = op->GetOpCode();
+        Location *x = op->GetSrc(0), *y = op->GetSrc(1);
+        int c, k;
+        bool known = constants.count(vars.IndexOf(y)) > 0;
+        if (!known && (code == BinaryOp::Add || code == BinaryOp::Mul ||
+                       code == BinaryOp::And || code == BinaryOp::Or ||
+                       code == BinaryOp::Xor) &&
+            constants.count(vars.IndexOf(x)) > 0) {
+          std::swap(x, y);
+          known = true;
+        }
+        if (known) {
+          c = constants[vars.IndexOf(y)];
+          if (code == BinaryOp::Sub && c != INT_MIN) {
+            code = BinaryOp::Add;
+            c = -c;
+          } else if (code == BinaryOp::LessEq && c != INT_MAX) {
+            code = BinaryOp::Less;
+            c = c + 1;
+          } else if (code == BinaryOp::Mul && c > 0 && (c & (c - 1)) == 0) {
+            for (k = 0; (1 << k) != c; k++) {
+            }
+            code = BinaryOp::Shl;
+            c = k;
+          }
+          if (target->FitsImmediate(code, c)) {
+            instr = new BinaryOp(code, op->GetDst(), x, c);
+            block->RemoveAt(j);
+            block->InsertAt(instr, j);
+            numSelected++;
+          }
+        }
+      }
+
+      int d = vars.IndexOf(instr->GetDst());
+      if (d >= 0) {
+        constants.erase(d);
+        LoadConstant *lc = dynamic_cast<LoadConstant*>(instr);
+        if (lc != 0) {
+          constants[d] = lc->GetValue();
+        }
+      }
+    }
+  }
+  PrintDebug("immediate", "%d immediate operands selected", numSelected);
+  return numSelected > 0;
+}
+
+/* CodeGenerator::FuseCompareBranches
+ * ----------------------------------
+ *     t = a < b ;
+ *     IfZ t Goto L ;       =>      If a >= b Goto L ;
+ * when t is not live afterwards. Returns true if anything changed.
+ */
+bool CodeGenerator::FuseCompareBranches(FlowGraph *graph,
+                                        Liveness *liveness) {
+  int numFused = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *block = b->GetCode();
+    int n = block->NumElements();
+    if (n < 2) {
+      continue;
+    }
+    IfZ *ifz = dynamic_cast<IfZ*>(block->Nth(n - 1));
+    BinaryOp *cmp = dynamic_cast<BinaryOp*>(block->Nth(n - 2));
+    if (ifz == 0 || cmp == 0 || !BinaryOp::IsRelational(cmp->GetOpCode())) {
+      continue;
+    }
+    int t = liveness->IndexOf(cmp->GetDst());
+    if (t < 0 || liveness->IndexOf(ifz->GetSrc(0)) != t ||
+        liveness->LiveOut(b).Test(t)) {
+      continue;
+    }
+
+    block->RemoveAt(n - 1);
+    block->RemoveAt(n - 2);
+    block->Append(new IfCompare(BinaryOp::Negate(cmp->GetOpCode()),
+                                cmp->GetSrc(0), cmp->GetSrc(1),
+                                ifz->GetLabel()));
+    numFused++;
+  }
+  PrintDebug("fuse", "%d compare-branches fused", numFused);
+  return numFused > 0;
+}
+
 void CodeGenerator::DoFinalCodeGen() {
   if (!mainFound) {
     ReportError::NoMainFound();
   }
 
-  // if debug don't translate to mips, just print Tac
+  OptimizeFunctions();
+
+  // if debug don't translate to assembly, just print Tac
   if (IsDebugOn("tac")) {
     for (int i = 0; i < code->NumElements(); i++) {
       code->Nth(i)->Print();
     }
   } else {
-    Mips mips;
-    mips.EmitPreamble();
+    target->EmitPreamble();
     for (int i = 0; i < code->NumElements(); i++) {
-      code->Nth(i)->Emit(&mips);
+      code->Nth(i)->Emit(target);
     }
+    target->Flush();
   }
 }
 
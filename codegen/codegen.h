@@ -15,8 +15,10 @@
 #define _H_codegen
 
 #include <stdlib.h>
+#include <utility>
+#include <vector>
 
-#include "arch/mips/tac.h"
+#include "codegen/tac.h"
 #include "decaf/list.h"
 #include "codegen/framealloc.h"
 
@@ -30,13 +32,35 @@ typedef enum {
   PrintString,
   PrintBool,
   Halt,
+  GCInit,
+  Print,
   NumBuiltIns
 } BuiltIn;
 
+class FlowGraph;
+class Liveness;
+class TargetEmitter;
+
 class CodeGenerator {
  private:
   List<Instruction*> *code;
   bool mainFound;
+  // Backend chosen with -target. The optimizer asks it about the
+  // machine, and DoFinalCodeGen lowers the Tac through it.
+  TargetEmitter *target;
+
+  // Builds the flow graph of each function in code, runs the
+  // function-level passes over it and rebuilds code from the result.
+  void OptimizeFunctions();
+  void OptimizeFunction(FlowGraph *graph);
+  bool RemoveDeadValues(FlowGraph *graph, Liveness *liveness);
+  bool SelectImmediates(FlowGraph *graph);
+  bool FuseCompareBranches(FlowGraph *graph, Liveness *liveness);
+  bool IsLeaf(FlowGraph *graph);
+  void GenSearch(FrameAllocator *falloc, Location *test,
+                 const std::vector<std::pair<int, int> > &cases,
+                 int lo, int hi, List<const char*> *labels,
+                 const char *defaultLabel);
 
  public:
   // Here are some class constants to remind you of the offsets
@@ -54,6 +78,16 @@ class CodeGenerator {
   static const int OffsetToFirstGlobal = 0;
   static const int VarSize = 4;
 
+  // Layout of the runtime's _AllocClasses table, which New bumps
+  // inline (defined in etc/exceptions.s and arch/x86/libdecaf.s; keep
+  // these in step with both). Classes go up by a word to
+  // MaxInlineAllocSize, and each entry starts with the class's next
+  // free byte and the end of its chunk.
+  static const int MaxInlineAllocSize = 128;
+  static const int AllocClassEntrySize = 16;
+  static const int AllocClassNextOffset = 0;
+  static const int AllocClassLimitOffset = 4;
+
   CodeGenerator();
   
   // Assigns a new unique label name and returns it. Does not
@@ -61,8 +95,8 @@ class CodeGenerator {
   char *NewLabel();
 
   // Creates a class label for a class name in the format C_classname
-  char *NewClassLabel(char *className);
-  char *NewFunctionLabel(char *functionName);
+  char *NewClassLabel(const char *className);
+  char *NewFunctionLabel(const char *functionName);
   
   // Creates and returns a Location for a new uniquely named
   // temp variable. Does not generate any Tac instructions
@@ -125,6 +159,16 @@ class CodeGenerator {
   // are removed with one adjustment of the stack pointer.
   void GenPopParams(int numBytesOfParams);
 
+  // Covers for the above two for calls to Decaf functions, which
+  // follow the calling convention chosen with -c. index counts the
+  // arguments from 0, with the receiver of a method call first.
+  void GenPushArg(Location *arg, int index);
+  void GenPopArgs(int numArgs);
+
+  // How many leading parameters of a Decaf function arrive in
+  // registers. The callee keeps those in its own frame.
+  int NumRegisterArgs();
+
   // Generates the Tac instructions for a LCall, a jump to
   // a compile-time label. The params to the target routine
   // should already have been pushed. If hasReturnValue is
@@ -154,6 +198,18 @@ class CodeGenerator {
   Location* GenBuiltInCall(FrameAllocator *falloc, BuiltIn b,
       Location *arg1 = NULL, Location *arg2 = NULL);
 
+  // Generates one call to the Print built-in for all of args. kinds
+  // has a letter for each, in order: i for int, b for bool and s for
+  // string.
+  void GenPrint(FrameAllocator *falloc, const char *kinds,
+                List<Location*> *args);
+
+  // Generates the allocation of numBytes, known at compile time, and
+  // returns the Location holding the address. Small objects are
+  // bump-allocated inline, calling Alloc only when their size class
+  // needs a new chunk.
+  Location *GenNew(FrameAllocator *falloc, int numBytes);
+
   void GenPrintError(FrameAllocator *falloc, const char * const message);
   
   // These methods generate the Tac instructions for various
@@ -162,10 +218,21 @@ class CodeGenerator {
   // (or omit arg) to GenReturn for a return that does not
   // return a value
   void GenIfZ(Location *test, const char *label);
+  // Branches to label if op1 relOp op2 holds, or if it does not when
+  // negated is set. relOp names a relational or equality operator.
+  void GenIfCompare(const char *relOp, bool negated, Location *op1,
+                    Location *op2, const char *label);
   void GenGoto(const char *label);
   void GenReturn(Location *val = NULL);
   void GenLabel(const char *label);
 
+  // Generates the dispatch of a switch: branches to the label of the
+  // first case whose value equals test, or to defaultLabel if none
+  // does. values and labels are in case order. Dense values get a
+  // bounds check and a jump table, sparse ones a binary search.
+  void GenSwitch(FrameAllocator *falloc, Location *test, List<int> *values,
+                 List<const char*> *labels, const char *defaultLabel);
+
   // These methods generate the Tac instructions that mark the start
   // and end of a function/method definition.
   BeginFunc* GenBeginFunc();
@@ -179,9 +246,9 @@ class CodeGenerator {
   void GenVTable(const char *className, List<const char*> *methodLabels);
 
   // Emits the final "object code" for the program by
-  // translating the sequence of Tac instructions into their mips
-  // equivalent and printing them out to stdout. If the debug
-  // flag tac is on (-d tac), it will not translate to MIPS,
+  // translating the sequence of Tac instructions into their
+  // equivalent for the target and printing them out to stdout. If the
+  // debug flag tac is on (-d tac), it will not translate to assembly,
   // but instead just print the untranslated Tac. It may be
   // useful in debugging to first make sure your Tac is correct.
   void DoFinalCodeGen();
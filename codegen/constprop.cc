@@ -0,0 +1,287 @@
+/* File: constprop.cc
+ * ------------------
+ * Implementation of ConstantPropagation.
+ */
+
+#include "codegen/constprop.h"
+
+ConstantPropagation::ConstantPropagation(FlowGraph *g)
+    : graph(g), vars(g) {
+}
+
+static const char *BranchLabel(Instruction *instr) {
+  IfZ *ifz = dynamic_cast<IfZ*>(instr);
+  if (ifz != 0) {
+    return ifz->GetLabel();
+  }
+  return dynamic_cast<IfCompare*>(instr)->GetLabel();
+}
+
+bool ConstantPropagation::Run() {
+  Solve();
+  return Rewrite();
+}
+
+ConstantPropagation::Value
+ConstantPropagation::ValueOf(Location *var, const State &state) {
+  int v = vars.IndexOf(var);
+  if (v < 0) {
+    Value varying = { Varying, 0 };
+    return varying;
+  }
+  return state[v];
+}
+
+void ConstantPropagation::Meet(State *state, const State &other) {
+  for (size_t v = 0; v < state->size(); v++) {
+    Value &a = (*state)[v];
+    const Value &b = other[v];
+    if (b.kind == Unknown || a.kind == Varying) {
+      continue;
+    }
+    if (a.kind == Unknown) {
+      a = b;
+    } else if (b.kind == Varying || a.val != b.val) {
+      a.kind = Varying;
+    }
+  }
+}
+
+/* ConstantPropagation::Evaluate
+ * -----------------------------
+ * Returns true, with the value in result, if instr computes a value
+ * known from state.
+ */
+bool ConstantPropagation::Evaluate(Instruction *instr, const State &state,
+                                   int *result) {
+  LoadConstant *lc = dynamic_cast<LoadConstant*>(instr);
+  if (lc != 0) {
+    *result = lc->GetValue();
+    return true;
+  }
+  if (dynamic_cast<Assign*>(instr) != 0) {
+    Value src = ValueOf(instr->GetSrc(0), state);
+    *result = src.val;
+    return src.kind == Constant;
+  }
+  BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+  if (op != 0) {
+    Value a = ValueOf(op->GetSrc(0), state);
+    Value b = { Constant, op->GetImmediate() };
+    if (!op->HasImmediate()) {
+      b = ValueOf(op->GetSrc(1), state);
+    }
+    return a.kind == Constant && b.kind == Constant &&
+           BinaryOp::Evaluate(op->GetOpCode(), a.val, b.val, result);
+  }
+  return false;
+}
+
+void ConstantPropagation::Transfer(Instruction *instr, State *state) {
+  int d = vars.IndexOf(instr->GetDst());
+  if (d < 0) {
+    return;
+  }
+
+  Value result = { Varying, 0 };
+  if (Evaluate(instr, *state, &result.val)) {
+    result.kind = Constant;
+  } else if (dynamic_cast<Assign*>(instr) != 0 ||
+             dynamic_cast<BinaryOp*>(instr) != 0) {
+    // Stays unknown while an operand is, unless another already varies.
+    bool unknown = false, varying = false;
+    for (int k = 0; k < instr->NumSrcs(); k++) {
+      Kind kind = ValueOf(instr->GetSrc(k), *state).kind;
+      unknown = unknown || kind == Unknown;
+      varying = varying || kind == Varying;
+    }
+    if (unknown && !varying) {
+      result.kind = Unknown;
+    }
+  }
+  (*state)[d] = result;
+}
+
+/* ConstantPropagation::BranchTest
+ * -------------------------------
+ * Returns false if instr is not a conditional branch. Otherwise test
+ * says whether the branch is taken: unknown, varying, or a constant
+ * that is nonzero if it is.
+ */
+bool ConstantPropagation::BranchTest(Instruction *instr, const State &state,
+                                     Value *test) {
+  IfZ *ifz = dynamic_cast<IfZ*>(instr);
+  if (ifz != 0) {
+    *test = ValueOf(ifz->GetSrc(0), state);
+    test->val = test->val == 0;
+    return true;
+  }
+  IfCompare *ifc = dynamic_cast<IfCompare*>(instr);
+  if (ifc == 0) {
+    return false;
+  }
+  Value a = ValueOf(ifc->GetSrc(0), state), b = ValueOf(ifc->GetSrc(1), state);
+  test->val = 0;
+  if (a.kind == Varying || b.kind == Varying) {
+    test->kind = Varying;
+  } else if (a.kind == Unknown || b.kind == Unknown) {
+    test->kind = Unknown;
+  } else {
+    test->kind = Constant;
+    BinaryOp::Evaluate(ifc->GetRelation(), a.val, b.val, &test->val);
+  }
+  return true;
+}
+
+/* ConstantPropagation::ComputeIn
+ * ------------------------------
+ * Meets the states flowing along the executable edges into b. Returns
+ * false if there are none yet. On entry every variable varies.
+ */
+bool ConstantPropagation::ComputeIn(BasicBlock *b, State *state) {
+  Value unknown = { Unknown, 0 }, varying = { Varying, 0 };
+  if (b == graph->GetEntry()) {
+    state->assign(vars.NumVars(), varying);
+    return true;
+  }
+
+  bool any = false;
+  state->assign(vars.NumVars(), unknown);
+  List<BasicBlock*> *preds = b->GetPreds();
+  for (int i = 0; i < preds->NumElements(); i++) {
+    BasicBlock *p = preds->Nth(i);
+    for (int k = 0; k < p->GetSuccs()->NumElements(); k++) {
+      if (p->GetSuccs()->Nth(k) == b && executable[p->GetId()][k]) {
+        Meet(state, out[p->GetId()]);
+        any = true;
+      }
+    }
+  }
+  return any;
+}
+
+/* ConstantPropagation::Solve
+ * --------------------------
+ * Iterates over the reverse postorder until neither the block states
+ * nor the set of executable edges change. Values only ever move from
+ * unknown to constant to varying, so this terminates.
+ */
+void ConstantPropagation::Solve() {
+  int numBlocks = graph->NumBlocks();
+  in.assign(numBlocks, State());
+  out.assign(numBlocks, State());
+  reached.assign(numBlocks, false);
+  executable.resize(numBlocks);
+  for (int i = 0; i < numBlocks; i++) {
+    executable[i].assign(graph->Nth(i)->GetSuccs()->NumElements(), false);
+  }
+
+  List<BasicBlock*> *rpo = graph->GetReversePostorder();
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < rpo->NumElements(); i++) {
+      BasicBlock *b = rpo->Nth(i);
+      int id = b->GetId();
+      State state;
+      if (!ComputeIn(b, &state)) {
+        continue;
+      }
+      reached[id] = true;
+      in[id] = state;
+
+      List<Instruction*> *code = b->GetCode();
+      for (int j = 0; j < code->NumElements(); j++) {
+        Transfer(code->Nth(j), &state);
+      }
+
+      // Which way can the block leave?
+      int taken = -1;   // successor index, -1 for all of them
+      Value test;
+      if (BranchTest(b->GetLast(), state, &test)) {
+        if (test.kind == Unknown) {
+          taken = executable[id].size();    // none yet
+        } else if (test.kind == Constant) {
+          taken = test.val ? 0 : 1;         // branch target comes first
+        }
+      }
+      for (int k = 0; k < (int) executable[id].size(); k++) {
+        if ((taken < 0 || k == taken) && !executable[id][k]) {
+          executable[id][k] = true;
+          changed = true;
+        }
+      }
+
+      bool same = out[id].size() == state.size();
+      for (size_t v = 0; same && v < state.size(); v++) {
+        same = out[id][v].kind == state[v].kind &&
+               out[id][v].val == state[v].val;
+      }
+      if (!same) {
+        out[id] = state;
+        changed = true;
+      }
+    }
+  }
+}
+
+/* ConstantPropagation::Rewrite
+ * ----------------------------
+ * Replays each reached block from its entry state, replacing what the
+ * solution proved constant, and empties the blocks never reached
+ * (keeping the EndFunc, which closes the function).
+ */
+bool ConstantPropagation::Rewrite() {
+  int numFolded = 0, numBranches = 0, numRemoved = 0;
+
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *code = b->GetCode();
+
+    if (!reached[b->GetId()]) {
+      bool removed = false;
+      for (int j = code->NumElements() - 1; j >= 0; j--) {
+        if (dynamic_cast<EndFunc*>(code->Nth(j)) == 0) {
+          code->RemoveAt(j);
+          removed = true;
+        }
+      }
+      numRemoved += removed;
+      continue;
+    }
+
+    State state = in[b->GetId()];
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      int val;
+      if ((dynamic_cast<BinaryOp*>(instr) != 0 ||
+           dynamic_cast<Assign*>(instr) != 0) &&
+          Evaluate(instr, state, &val)) {
+        instr = new LoadConstant(instr->GetDst(), val);
+        code->RemoveAt(j);
+        code->InsertAt(instr, j);
+        numFolded++;
+      } else {
+        Value test;
+        if (BranchTest(instr, state, &test) && test.kind == Constant) {
+          code->RemoveAt(j);
+          if (test.val) {
+            code->InsertAt(new Goto(BranchLabel(instr)), j);
+          }
+          numBranches++;
+          break;    // the branch ends the block
+        }
+      }
+      Transfer(instr, &state);
+    }
+  }
+
+  PrintDebug("constprop", "%d values folded, %d branches resolved, "
+             "%d blocks removed", numFolded, numBranches, numRemoved);
+  if (numBranches > 0 || numRemoved > 0) {
+    graph->Rebuild();
+  }
+  return numFolded > 0 || numBranches > 0 || numRemoved > 0;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,64 @@
+/* File: constprop.h                                     -*- C++ -*-
+ * -----------------
+ * Conditional constant propagation over the Tac of one function.
+ *
+ * Every constant in the source goes through a temp, so expressions
+ * over constants reach the Tac as BinaryOps on temps that each hold a
+ * LoadConstant.  This pass tracks, for every stack variable at every
+ * point, whether it is still unknown (no definition has reached it),
+ * a known constant or varying, and only follows the branches that
+ * can be taken given what is known.  This is Wegman and Zadeck's
+ * conditional constant propagation, run as a dataflow problem over
+ * the blocks rather than over SSA edges, since Tac variables have
+ * many definitions.
+ *
+ * With the fixed point reached:
+ *   - a BinaryOp or Assign whose result is constant becomes a
+ *     LoadConstant, so its operands may die earlier;
+ *   - an IfZ or IfCompare on constants becomes a Goto or disappears;
+ *   - blocks no executable edge reaches are removed.
+ * The graph is rebuilt if any of this changed its shape.
+ */
+
+#ifndef _H_constprop
+#define _H_constprop
+
+#include <vector>
+
+#include "codegen/cfg.h"
+#include "codegen/liveness.h"
+
+class ConstantPropagation {
+ public:
+  ConstantPropagation(FlowGraph *graph);
+
+  // Returns true if the code changed. Reports under the "constprop"
+  // debug key.
+  bool Run();
+
+ private:
+  typedef enum { Unknown, Constant, Varying } Kind;
+  struct Value {
+    Kind kind;
+    int val;
+  };
+  typedef std::vector<Value> State;
+
+  FlowGraph *graph;
+  FrameVars vars;
+  std::vector<State> in, out;
+  std::vector<bool> reached;
+  std::vector<std::vector<bool> > executable;   // by block, successor
+
+  Value ValueOf(Location *var, const State &state);
+  void Meet(State *state, const State &other);
+  void Transfer(Instruction *instr, State *state);
+  bool Evaluate(Instruction *instr, const State &state, int *result);
+  bool BranchTest(Instruction *instr, const State &state, Value *test);
+  bool ComputeIn(BasicBlock *b, State *state);
+  void Solve();
+  bool Rewrite();
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_constprop */
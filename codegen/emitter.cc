@@ -0,0 +1,39 @@
+/* File: emitter.cc
+ * ----------------
+ * Choice of backend for TargetEmitter, and the string constant pool
+ * the backends share.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "codegen/emitter.h"
+#include "arch/mips/mips.h"
+#include "arch/x86/x86.h"
+#include "decaf/utility.h"
+
+TargetEmitter *TargetEmitter::ForTarget(int target) {
+  switch (target) {
+    case TARGET_X86:
+      return new X86;
+    default:
+      Assert(target == TARGET_MIPS);
+      return new Mips;
+  }
+}
+
+const char *TargetEmitter::StringLabel(const char *str, bool *isNew) {
+  static int strNum = 1;
+  Atom key = Intern(str);
+  const char *label = stringLabels.Lookup(key);
+  *isNew = (label == NULL);
+  if (*isNew) {
+    char buf[16];
+    sprintf(buf, "_string%d", strNum++);
+    label = strdup(buf);
+    stringLabels.Enter(key, label);
+  }
+  return label;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,104 @@
+/* File: emitter.h                                       -*- C++ -*-
+ * ---------------
+ * The TargetEmitter class is the interface between the Tac and a
+ * backend. Each Tac instruction lowers itself by calling the hook
+ * for its kind (see Instruction::EmitSpecific), so one optimized
+ * instruction list feeds whichever target the compiler was asked
+ * for: Mips (arch/mips) or X86 (arch/x86).
+ *
+ * The optimizer also asks the target what it can do: how many
+ * registers it has for the register allocator, how many arguments
+ * travel in registers, and which constants an instruction can carry
+ * as an immediate.
+ *
+ * String constants are pooled here for every target: each distinct
+ * literal gets one label, so equal literals are also equal pointers.
+ */
+
+#ifndef _H_emitter
+#define _H_emitter
+
+#include "codegen/tac.h"
+#include "decaf/hashtable.h"
+#include "decaf/list.h"
+
+class TargetEmitter {
+ public:
+  virtual ~TargetEmitter() {}
+
+  // Makes the emitter for the target chosen with -target.
+  static TargetEmitter *ForTarget(int target);
+
+  // Callee-saved registers the register allocator may hand out, and
+  // argument registers under the register calling convention.
+  virtual int GetNumAllocatableRegs() = 0;
+  virtual int GetNumArgRegs() = 0;
+
+  // True if code has an immediate form that can encode val as its
+  // second operand.
+  virtual bool FitsImmediate(BinaryOp::OpCode code, int val) = 0;
+
+  // Writes one line of assembly, printf-style. Lines starting with
+  // '#' are comments.
+  virtual void Emit(const char *fmt, ...) = 0;
+
+  virtual void EmitPreamble() = 0;
+
+  // Writes out whatever the target held back until every
+  // instruction was emitted.
+  virtual void Flush() = 0;
+
+  virtual void EmitLoadConstant(Location *dst, int val) = 0;
+  virtual void EmitLoadStringConstant(Location *dst, const char *str) = 0;
+  virtual void EmitLoadLabel(Location *dst, const char *label) = 0;
+
+  virtual void EmitLoad(Location *dst, Location *reference, int offset) = 0;
+  virtual void EmitStore(Location *reference, Location *value,
+                         int offset) = 0;
+  virtual void EmitCopy(Location *dst, Location *src) = 0;
+
+  virtual void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                            Location *op1, Location *op2) = 0;
+  virtual void EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
+                            Location *op1, int imm) = 0;
+
+  virtual void EmitLabel(const char *label) = 0;
+  virtual void EmitGoto(const char *label) = 0;
+  virtual void EmitIfZ(Location *test, const char *label) = 0;
+  virtual void EmitIfCompare(BinaryOp::OpCode rel, Location *op1,
+                             Location *op2, const char *label) = 0;
+  virtual void EmitJumpTable(Location *index, const char *tableLabel,
+                             List<const char*> *targets) = 0;
+  virtual void EmitReturn(Location *returnVal) = 0;
+
+  virtual void EmitBeginFunction(int frameSize, int savedRegs,
+                                 List<Location*> *regParams,
+                                 List<Location*> *argParams,
+                                 bool leaf) = 0;
+  virtual void EmitEndFunction() = 0;
+
+  virtual void EmitParam(Location *arg, int argReg) = 0;
+  virtual void EmitLCall(Location *result, const char *label) = 0;
+  virtual void EmitACall(Location *result, Location *fnAddr) = 0;
+  virtual void EmitPopParams(int bytes) = 0;
+
+  virtual void EmitVTable(const char *label,
+                          List<const char*> *methodLabels) = 0;
+
+  // Brackets each instruction: vars are operands that are dead once
+  // it has executed. A target that keeps values in registers across
+  // instructions can drop them rather than store them back.
+  virtual void SetDeadOperands(Location **vars, int n) {}
+  virtual void DiscardDeadOperands() {}
+
+ protected:
+  // Returns the label of the string constant str, setting isNew the
+  // first time str is asked for, when the caller must emit its data.
+  const char *StringLabel(const char *str, bool *isNew);
+
+ private:
+  Hashtable<const char*> stringLabels;
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_emitter */
@@ -16,7 +16,7 @@ FrameAllocator::FrameAllocator(FrameAllocator *src) {
   segment = src->GetSegment();
 }
 
-Location *FrameAllocator::Alloc(char *name, int size) {
+Location *FrameAllocator::Alloc(const char *name, int size) {
   if (growth == FRAME_UP) {
     off += size;
   } else {
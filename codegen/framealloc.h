@@ -1,7 +1,7 @@
 #ifndef _H_FRAMEALLOC
 #define _H_FRAMEALLOC
 
-#include "arch/mips/tac.h"
+#include "codegen/tac.h"
 
 typedef enum {
   FRAME_UP,
@@ -18,7 +18,7 @@ class FrameAllocator {
  public:
   FrameAllocator(Segment s, FrameDirection d);
   FrameAllocator(FrameAllocator *src);
-  Location *Alloc(char *name, int size);
+  Location *Alloc(const char *name, int size);
   int GetSize();
 
   // Getters
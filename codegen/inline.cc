@@ -0,0 +1,239 @@
+/* File: inline.cc
+ * ---------------
+ * Implementation of Inliner.
+ */
+
+#include "codegen/inline.h"
+#include "codegen/codegen.h"
+
+// Gives the frame variables of an inlined body slots at the bottom of
+// the caller's frame, one per callee slot, and its labels new names.
+class FrameRenaming : public Renaming {
+ public:
+  FrameRenaming(BeginFunc *b) : begin(b) {}
+
+  Location *Rename(Location *var) {
+    if (var == NULL || var->GetSegment() != fpRelative) {
+      return var;
+    }
+    std::map<int, Location*>::iterator it = slots.find(var->GetOffset());
+    if (it != slots.end()) {
+      return it->second;
+    }
+    int size = begin->GetFrameSize();
+    begin->SetFrameSize(size + CodeGenerator::VarSize);
+    Location *copy = new Location(fpRelative,
+        CodeGenerator::OffsetToFirstLocal - size, var->GetName());
+    slots[var->GetOffset()] = copy;
+    return copy;
+  }
+
+  // The copy of the callee slot at offset, NULL if the body never
+  // mentions it.
+  Location *Find(int offset) {
+    std::map<int, Location*>::iterator it = slots.find(offset);
+    return it == slots.end() ? NULL : it->second;
+  }
+
+  void AddLabel(const char *label, const char *copy) {
+    labels[Intern(label)] = copy;
+  }
+
+  const char *Relabel(const char *label) {
+    std::map<Atom, const char*>::iterator it = labels.find(Intern(label));
+    return it == labels.end() ? label : it->second;
+  }
+
+ private:
+  BeginFunc *begin;
+  std::map<int, Location*> slots;
+  std::map<Atom, const char*> labels;
+};
+
+Inliner::Inliner(CodeGenerator *cg) : codegen(cg) {}
+
+List<Instruction*> *Inliner::Run(List<Instruction*> *code) {
+  // The label in front of each BeginFunc names the function.
+  List<Function*> order;
+  for (int i = 1; i < code->NumElements(); i++) {
+    if (dynamic_cast<BeginFunc*>(code->Nth(i)) == 0) {
+      continue;
+    }
+    Label *label = dynamic_cast<Label*>(code->Nth(i - 1));
+    Assert(label != 0);
+    Function *fn = new Function;
+    fn->label = label->GetLabel();
+    fn->code = new List<Instruction*>;
+    fn->state = Function::Unvisited;
+    while (dynamic_cast<EndFunc*>(code->Nth(i)) == 0) {
+      fn->code->Append(code->Nth(i++));
+    }
+    fn->code->Append(code->Nth(i));
+    functions.Enter(Intern(fn->label), fn);
+    order.Append(fn);
+  }
+  for (int i = 0; i < order.NumElements(); i++) {
+    Expand(order.Nth(i));
+  }
+
+  List<Instruction*> *result = new List<Instruction*>;
+  for (int i = 0, f = 0; i < code->NumElements(); i++) {
+    if (dynamic_cast<BeginFunc*>(code->Nth(i)) == 0) {
+      result->Append(code->Nth(i));
+      continue;
+    }
+    List<Instruction*> *body = order.Nth(f++)->code;
+    for (int j = 0; j < body->NumElements(); j++) {
+      result->Append(body->Nth(j));
+    }
+    while (dynamic_cast<EndFunc*>(code->Nth(i)) == 0) {
+      i++;
+    }
+  }
+  return result;
+}
+
+// Inlines what it can into fn, after doing the same for its callees.
+void Inliner::Expand(Function *fn) {
+  if (fn->state != Function::Unvisited) {
+    return;
+  }
+  fn->state = Function::Active;
+  for (int j = 0; j < fn->code->NumElements(); j++) {
+    LCall *call = dynamic_cast<LCall*>(fn->code->Nth(j));
+    if (call == 0) {
+      continue;
+    }
+    Function *callee = functions.Lookup(Intern(call->GetLabel()));
+    if (callee == NULL) {
+      continue;     // a built-in
+    }
+    Expand(callee);
+    if (callee->state == Function::Active) {
+      PrintDebug("inline", "%s not into %s: recursive", callee->label,
+                 fn->label);
+    } else if (Size(callee) > kMaxCalleeSize) {
+      PrintDebug("inline", "%s not into %s: %d instructions", callee->label,
+                 fn->label, Size(callee));
+    } else if (Size(fn) + Size(callee) > kMaxCallerSize) {
+      PrintDebug("inline", "%s not into %s: caller too big", callee->label,
+                 fn->label);
+    } else {
+      int next = InlineCall(fn, j, callee);
+      if (next >= 0) {
+        // what the copy calls is not for inlining again
+        PrintDebug("inline", "%s into %s, %d instructions", callee->label,
+                   fn->label, Size(callee));
+        j = next - 1;
+      }
+    }
+  }
+  fn->state = Function::Done;
+}
+
+/* Inliner::InlineCall
+ * -------------------
+ * The arguments of the call at index at are the PushParams right in
+ * front of it, the last pushed being the first argument, and the
+ * first few may be in argument registers. Those the callee keeps in
+ * its frame are its arg params, the rest are on the stack above its
+ * frame pointer. Either way they become copies into the slots the
+ * body uses. Returns the index of what follows the copy, or -1 if
+ * the call is not in the expected shape.
+ */
+int Inliner::InlineCall(Function *caller, int at, Function *callee) {
+  List<Instruction*> *code = caller->code;
+  LCall *call = dynamic_cast<LCall*>(code->Nth(at));
+  int first = at;
+  while (first > 0 && dynamic_cast<PushParam*>(code->Nth(first - 1)) != 0) {
+    first--;
+  }
+  int numArgs = at - first;
+  int last = at;
+  PopParams *pop = at + 1 < code->NumElements()
+      ? dynamic_cast<PopParams*>(code->Nth(at + 1)) : NULL;
+  if (pop != NULL) {
+    last = at + 1;
+  }
+
+  BeginFunc *begin = dynamic_cast<BeginFunc*>(callee->code->Nth(0));
+  List<Location*> *argParams = begin->GetArgParams();
+  int numStack = numArgs - argParams->NumElements();
+  if (numStack < 0 || (pop ? pop->GetNumBytes() : 0) != 4 * numStack) {
+    return -1;
+  }
+
+  FrameRenaming renaming(dynamic_cast<BeginFunc*>(caller->code->Nth(0)));
+  char *exit = codegen->NewLabel();
+  List<Instruction*> *calleeCode = callee->code;
+  int end = calleeCode->NumElements() - 1;     // the EndFunc
+  for (int j = 1; j < end; j++) {
+    Instruction *instr = calleeCode->Nth(j);
+    Label *label = dynamic_cast<Label*>(instr);
+    JumpTable *table = dynamic_cast<JumpTable*>(instr);
+    if (label != 0) {
+      renaming.AddLabel(label->GetLabel(), codegen->NewLabel());
+    } else if (table != 0) {
+      renaming.AddLabel(table->GetTableLabel(), codegen->NewLabel());
+    }
+  }
+
+  List<Instruction*> body;
+  bool exits = false;
+  for (int j = 1; j < end; j++) {
+    Instruction *instr = calleeCode->Nth(j);
+    if (dynamic_cast<Return*>(instr) == 0) {
+      body.Append(instr->Clone(&renaming));
+      continue;
+    }
+    if (instr->NumSrcs() > 0 && call->GetDst() != NULL) {
+      body.Append(new Assign(call->GetDst(),
+                             renaming.Rename(instr->GetSrc(0))));
+    }
+    if (j + 1 < end) {
+      body.Append(new Goto(exit));
+      exits = true;
+    }
+  }
+
+  List<Instruction*> *result = new List<Instruction*>;
+  for (int j = 0; j < first; j++) {
+    result->Append(code->Nth(j));
+  }
+  for (int i = 0; i < numArgs; i++) {
+    int param = i < argParams->NumElements()
+        ? argParams->Nth(i)->GetOffset()
+        : CodeGenerator::OffsetToFirstParam +
+          CodeGenerator::VarSize * (i - argParams->NumElements());
+    Location *slot = renaming.Find(param);
+    if (slot != NULL) {
+      result->Append(new Assign(slot, code->Nth(at - 1 - i)->GetSrc(0)));
+    }
+  }
+  for (int j = 0; j < body.NumElements(); j++) {
+    result->Append(body.Nth(j));
+  }
+  if (exits) {
+    result->Append(new Label(exit));
+  }
+  int next = result->NumElements();
+  for (int j = last + 1; j < code->NumElements(); j++) {
+    result->Append(code->Nth(j));
+  }
+  delete code;
+  caller->code = result;
+  return next;
+}
+
+// Instructions that will turn into code, so not counting labels.
+int Inliner::Size(Function *fn) {
+  int size = 0;
+  for (int j = 0; j < fn->code->NumElements(); j++) {
+    if (dynamic_cast<Label*>(fn->code->Nth(j)) == 0) {
+      size++;
+    }
+  }
+  return size;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
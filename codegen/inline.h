@@ -0,0 +1,62 @@
+/* File: inline.h                                        -*- C++ -*-
+ * --------------
+ * Inlining of small functions over the Tac of the whole program.
+ *
+ * A call to a Decaf function
+ *
+ *     PushParam b ; PushParam a ; t = LCall F_f ; PopParams 8 ;
+ *
+ * whose body is small enough becomes a copy of that body, with every
+ * frame variable of the callee given a fresh slot in the caller's
+ * frame and every label a fresh name:
+ *
+ *     a' = a ; b' = b ; <body> ; _L9:
+ *
+ * where each Return v in the body is now t = v' ; Goto _L9.
+ * Callees are expanded before their callers, so a small function
+ * that calls others can still be inlined once it has been flattened.
+ * A function is never inlined into itself, directly or through
+ * others.  Calls through a vtable are left alone.
+ */
+
+#ifndef _H_inline
+#define _H_inline
+
+#include <map>
+
+#include "codegen/tac.h"
+#include "decaf/hashtable.h"
+#include "decaf/list.h"
+
+class CodeGenerator;
+
+class Inliner {
+ public:
+  Inliner(CodeGenerator *codegen);
+
+  // Returns code with the calls inlined. Reports each under the
+  // "inline" debug key.
+  List<Instruction*> *Run(List<Instruction*> *code);
+
+ private:
+  // Bodies no bigger than this are copied, and callers stop growing
+  // once they reach the second limit.
+  static const int kMaxCalleeSize = 24;
+  static const int kMaxCallerSize = 800;
+
+  struct Function {
+    const char *label;
+    List<Instruction*> *code;     // BeginFunc to EndFunc
+    enum { Unvisited, Active, Done } state;
+  };
+
+  CodeGenerator *codegen;
+  Hashtable<Function*> functions;
+
+  void Expand(Function *fn);
+  int InlineCall(Function *caller, int at, Function *callee);
+  static int Size(Function *fn);
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_inline */
@@ -0,0 +1,196 @@
+/* File: liveness.cc
+ * -----------------
+ * Implementation of BitVector, FrameVars and Liveness.
+ */
+
+#include "codegen/liveness.h"
+
+bool BitVector::UnionWith(const BitVector &other) {
+  bool changed = false;
+  for (size_t i = 0; i < words.size(); i++) {
+    unsigned int w = words[i] | other.words[i];
+    if (w != words[i]) {
+      words[i] = w;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void BitVector::Transfer(const BitVector &use, const BitVector &def) {
+  for (size_t i = 0; i < words.size(); i++) {
+    words[i] = use.words[i] | (words[i] & ~def.words[i]);
+  }
+}
+
+/* Class: FrameVars
+ * ----------------
+ * Implementation for FrameVars class
+ */
+
+static bool IsTracked(Location *var) {
+  return var != NULL && var->GetSegment() == fpRelative;
+}
+
+/* FrameVars::FrameVars
+ * --------------------
+ * One pass to find the range of offsets in use, a second to number
+ * the slots in order of first appearance.
+ */
+FrameVars::FrameVars(FlowGraph *graph) : minOffset(0) {
+  int maxOffset = 0;
+  bool any = false;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        Location *var = k < 0 ? instr->GetDst() : instr->GetSrc(k);
+        if (!IsTracked(var)) {
+          continue;
+        }
+        if (!any || var->GetOffset() < minOffset) {
+          minOffset = var->GetOffset();
+        }
+        if (!any || var->GetOffset() > maxOffset) {
+          maxOffset = var->GetOffset();
+        }
+        any = true;
+      }
+    }
+  }
+  if (!any) {
+    return;
+  }
+
+  varAtSlot.assign((maxOffset - minOffset) / 4 + 1, -1);
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        Location *var = k < 0 ? instr->GetDst() : instr->GetSrc(k);
+        if (!IsTracked(var)) {
+          continue;
+        }
+        int &slot = varAtSlot[(var->GetOffset() - minOffset) / 4];
+        if (slot < 0) {
+          slot = vars.size();
+          vars.push_back(var);
+        }
+      }
+    }
+  }
+}
+
+int FrameVars::IndexOf(Location *var) {
+  if (!IsTracked(var) || varAtSlot.empty()) {
+    return -1;
+  }
+  int slot = (var->GetOffset() - minOffset) / 4;
+  if (slot < 0 || slot >= (int) varAtSlot.size()) {
+    return -1;
+  }
+  return varAtSlot[slot];
+}
+
+/* Class: Liveness
+ * ---------------
+ * Implementation for Liveness class
+ */
+
+Liveness::Liveness(FlowGraph *g) : graph(g), vars(g) {
+  Solve();
+}
+
+void Liveness::Transfer(Instruction *instr, BitVector *live) {
+  int d = IndexOf(instr->GetDst());
+  if (d >= 0) {
+    live->Reset(d);
+  }
+  for (int k = 0; k < instr->NumSrcs(); k++) {
+    int s = IndexOf(instr->GetSrc(k));
+    if (s >= 0) {
+      live->Set(s);
+    }
+  }
+}
+
+/* Liveness::Solve
+ * ---------------
+ * Blocks are visited last to first, which for a backward problem on
+ * code laid out in source order settles in a couple of rounds.
+ * Unreachable blocks are solved too; they are still emitted.
+ */
+void Liveness::Solve() {
+  int numBlocks = graph->NumBlocks();
+  int n = vars.NumVars();
+  use.assign(numBlocks, BitVector(n));
+  def.assign(numBlocks, BitVector(n));
+  liveIn.assign(numBlocks, BitVector(n));
+  liveOut.assign(numBlocks, BitVector(n));
+
+  for (int i = 0; i < numBlocks; i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = code->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = code->Nth(j);
+      int d = IndexOf(instr->GetDst());
+      if (d >= 0) {
+        def[i].Set(d);
+        use[i].Reset(d);
+      }
+      for (int k = 0; k < instr->NumSrcs(); k++) {
+        int s = IndexOf(instr->GetSrc(k));
+        if (s >= 0) {
+          use[i].Set(s);
+        }
+      }
+    }
+  }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = numBlocks - 1; i >= 0; i--) {
+      BasicBlock *b = graph->Nth(i);
+      List<BasicBlock*> *succs = b->GetSuccs();
+      for (int j = 0; j < succs->NumElements(); j++) {
+        liveOut[i].UnionWith(liveIn[succs->Nth(j)->GetId()]);
+      }
+      BitVector in = liveOut[i];
+      in.Transfer(use[i], def[i]);
+      if (liveIn[i].UnionWith(in)) {
+        changed = true;
+      }
+    }
+  }
+}
+
+void Liveness::MarkDeadOperands() {
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *code = b->GetCode();
+    BitVector live = LiveOut(b);
+    for (int j = code->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = code->Nth(j);
+      instr->ClearDead();
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        Location *var = k < 0 ? instr->GetDst() : instr->GetSrc(k);
+        int v = IndexOf(var);
+        if (v < 0 || live.Test(v) || var->GetRegister() >= 0) {
+          continue;
+        }
+        bool seen = false;   // an operand may appear twice
+        for (int m = 0; m < instr->NumDead(); m++) {
+          seen = seen || IndexOf(instr->GetDead(m)) == v;
+        }
+        if (!seen) {
+          instr->AddDead(var);
+        }
+      }
+      Transfer(instr, &live);
+    }
+  }
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
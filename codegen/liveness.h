@@ -0,0 +1,90 @@
+/* File: liveness.h                                      -*- C++ -*-
+ * ----------------
+ * Live variable analysis over the FlowGraph of one function.
+ *
+ * The variables tracked are the function's own stack slots: its
+ * locals, temps and parameters (fp-relative Locations).  Globals are
+ * left out; any call may read or write them, so they always stay in
+ * memory.  Code generation never hands out two slots at the same
+ * offset within a function, so a variable is identified by its
+ * offset and several Location objects for the same slot count as one
+ * variable.
+ *
+ * The analysis is the usual backward iteration to a fixed point over
+ * per-block use/def sets, kept as bit vectors indexed by variable
+ * number.  Passes that need liveness inside a block start from
+ * LiveOut and step backwards with Transfer.
+ */
+
+#ifndef _H_liveness
+#define _H_liveness
+
+#include <vector>
+
+#include "codegen/tac.h"
+#include "codegen/cfg.h"
+
+class BitVector {
+ public:
+  BitVector(int size = 0) : words((size + 31) / 32, 0u) {}
+
+  bool Test(int i) const { return (words[i >> 5] >> (i & 31)) & 1; }
+  void Set(int i) { words[i >> 5] |= 1u << (i & 31); }
+  void Reset(int i) { words[i >> 5] &= ~(1u << (i & 31)); }
+
+  // this |= other, returning true if any bit was added.
+  bool UnionWith(const BitVector &other);
+  // this = use | (this & ~def), the backward transfer of a block.
+  void Transfer(const BitVector &use, const BitVector &def);
+
+ private:
+  std::vector<unsigned int> words;
+};
+
+// Numbers the stack slots a function's Tac refers to, in order of
+// first appearance.
+class FrameVars {
+ public:
+  FrameVars(FlowGraph *graph);
+
+  int NumVars() { return vars.size(); }
+  Location *GetVar(int i) { return vars[i]; }
+
+  // Variable number of var, or -1 if it is not tracked.
+  int IndexOf(Location *var);
+
+ private:
+  std::vector<Location*> vars;
+  int minOffset;
+  std::vector<int> varAtSlot;   // by (offset - minOffset) / 4
+};
+
+class Liveness {
+ public:
+  Liveness(FlowGraph *graph);
+
+  int NumVars() { return vars.NumVars(); }
+  Location *GetVar(int i) { return vars.GetVar(i); }
+  int IndexOf(Location *var) { return vars.IndexOf(var); }
+
+  const BitVector &LiveIn(BasicBlock *b) { return liveIn[b->GetId()]; }
+  const BitVector &LiveOut(BasicBlock *b) { return liveOut[b->GetId()]; }
+
+  // Turns the set live after instr into the set live before it.
+  void Transfer(Instruction *instr, BitVector *live);
+
+  // Records on every instruction which of its operands die there
+  // (Instruction::AddDead). Register-allocated variables are left
+  // out; they never go through the backend's register cache.
+  void MarkDeadOperands();
+
+ private:
+  FlowGraph *graph;
+  FrameVars vars;
+  std::vector<BitVector> use, def, liveIn, liveOut;
+
+  void Solve();
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_liveness */
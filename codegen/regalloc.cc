@@ -0,0 +1,259 @@
+/* File: regalloc.cc
+ * -----------------
+ * Implementation of RegisterAllocator.
+ */
+
+#include "codegen/regalloc.h"
+
+RegisterAllocator::RegisterAllocator(FlowGraph *g, Liveness *l, int k)
+    : graph(g), liveness(l), numRegs(k) {
+  int n = liveness->NumVars();
+  candidate.assign(n, false);
+  cost.assign(n, 0.0);
+  interferes.assign(n, BitVector(n));
+  neighbors.resize(n);
+  partner.assign(n, -1);
+  color.assign(n, -1);
+}
+
+void RegisterAllocator::Allocate() {
+  FindCandidates();
+  BuildGraph();
+  Color();
+  Rewrite();
+}
+
+static bool IsCall(Instruction *instr) {
+  return dynamic_cast<LCall*>(instr) != 0 || dynamic_cast<ACall*>(instr) != 0;
+}
+
+/* RegisterAllocator::FindCandidates
+ * ---------------------------------
+ * A variable is a candidate if it is live into some block or live
+ * across some call. Spill costs are gathered on the same walk.
+ */
+void RegisterAllocator::FindCandidates() {
+  int n = liveness->NumVars();
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    const BitVector &in = liveness->LiveIn(b);
+    for (int v = 0; v < n; v++) {
+      if (in.Test(v)) {
+        candidate[v] = true;
+      }
+    }
+
+    double weight = 1;
+    for (int d = 0; d < b->GetLoopDepth() && d < 6; d++) {
+      weight *= 10;
+    }
+
+    List<Instruction*> *code = b->GetCode();
+    BitVector live = liveness->LiveOut(b);
+    for (int j = code->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = code->Nth(j);
+      if (IsCall(instr)) {
+        int d = liveness->IndexOf(instr->GetDst());
+        for (int v = 0; v < n; v++) {
+          if (live.Test(v) && v != d) {
+            candidate[v] = true;
+          }
+        }
+      }
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        int v = liveness->IndexOf(k < 0 ? instr->GetDst() : instr->GetSrc(k));
+        if (v >= 0) {
+          cost[v] += weight;
+        }
+      }
+      liveness->Transfer(instr, &live);
+    }
+  }
+}
+
+void RegisterAllocator::AddEdge(int a, int b) {
+  if (a == b || interferes[a].Test(b)) {
+    return;
+  }
+  interferes[a].Set(b);
+  interferes[b].Set(a);
+  neighbors[a].push_back(b);
+  neighbors[b].push_back(a);
+}
+
+/* RegisterAllocator::BuildGraph
+ * -----------------------------
+ * A def interferes with everything live after it, except the source
+ * of a copy, which holds the same value. Whatever is live on entry
+ * (the parameters) is defined together there.
+ */
+void RegisterAllocator::BuildGraph() {
+  int n = liveness->NumVars();
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *code = b->GetCode();
+    BitVector live = liveness->LiveOut(b);
+    for (int j = code->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = code->Nth(j);
+      int d = liveness->IndexOf(instr->GetDst());
+      if (d >= 0 && candidate[d]) {
+        int copied = -1;
+        if (dynamic_cast<Assign*>(instr) != 0) {
+          copied = liveness->IndexOf(instr->GetSrc(0));
+          if (copied >= 0 && candidate[copied]) {
+            if (partner[d] < 0) {
+              partner[d] = copied;
+            }
+            if (partner[copied] < 0) {
+              partner[copied] = d;
+            }
+          }
+        }
+        for (int v = 0; v < n; v++) {
+          if (candidate[v] && live.Test(v) && v != copied) {
+            AddEdge(d, v);
+          }
+        }
+      }
+      liveness->Transfer(instr, &live);
+    }
+  }
+
+  const BitVector &in = liveness->LiveIn(graph->GetEntry());
+  for (int a = 0; a < n; a++) {
+    for (int b = a + 1; b < n; b++) {
+      if (candidate[a] && candidate[b] && in.Test(a) && in.Test(b)) {
+        AddEdge(a, b);
+      }
+    }
+  }
+}
+
+/* RegisterAllocator::Color
+ * ------------------------
+ * Simplify, pushing nodes of degree < numRegs first and otherwise
+ * the cheapest to spill, then select colors popping the stack.
+ */
+void RegisterAllocator::Color() {
+  int n = liveness->NumVars();
+  std::vector<int> degree(n, 0);
+  std::vector<bool> removed(n, true);
+  std::vector<int> low, stack;
+  int remaining = 0;
+
+  for (int v = 0; v < n; v++) {
+    if (candidate[v]) {
+      removed[v] = false;
+      remaining++;
+      degree[v] = neighbors[v].size();
+      if (degree[v] < numRegs) {
+        low.push_back(v);
+      }
+    }
+  }
+
+  while (remaining > 0) {
+    int pick = -1;
+    while (!low.empty() && pick < 0) {
+      pick = low.back();
+      low.pop_back();
+      if (removed[pick]) {
+        pick = -1;
+      }
+    }
+    if (pick < 0) {
+      for (int v = 0; v < n; v++) {
+        if (!removed[v] && (pick < 0 || cost[v] * degree[pick] <
+                                        cost[pick] * degree[v])) {
+          pick = v;
+        }
+      }
+    }
+
+    stack.push_back(pick);
+    removed[pick] = true;
+    remaining--;
+    for (size_t i = 0; i < neighbors[pick].size(); i++) {
+      int u = neighbors[pick][i];
+      if (!removed[u] && --degree[u] == numRegs - 1) {
+        low.push_back(u);
+      }
+    }
+  }
+
+  while (!stack.empty()) {
+    int v = stack.back();
+    stack.pop_back();
+    int used = 0;
+    for (size_t i = 0; i < neighbors[v].size(); i++) {
+      int c = color[neighbors[v][i]];
+      if (c >= 0) {
+        used |= 1 << c;
+      }
+    }
+    int p = partner[v];
+    if (p >= 0 && color[p] >= 0 && !(used & (1 << color[p]))) {
+      color[v] = color[p];
+      continue;
+    }
+    for (int c = 0; c < numRegs; c++) {
+      if (!(used & (1 << c))) {
+        color[v] = c;
+        break;
+      }
+    }
+  }
+}
+
+/* RegisterAllocator::Rewrite
+ * --------------------------
+ * Stamps the color on every Location naming a colored slot and tells
+ * the BeginFunc which registers to save and which parameters to load.
+ */
+void RegisterAllocator::Rewrite() {
+  int mask = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        Location *var = k < 0 ? instr->GetDst() : instr->GetSrc(k);
+        int v = liveness->IndexOf(var);
+        if (v >= 0 && color[v] >= 0) {
+          var->SetRegister(color[v]);
+          mask |= 1 << color[v];
+        }
+      }
+    }
+  }
+
+  List<Instruction*> *entry = graph->GetEntry()->GetCode();
+  BeginFunc *begin = dynamic_cast<BeginFunc*>(entry->Nth(0));
+  Assert(begin != NULL);
+  begin->SetSavedRegisters(mask);
+
+  const BitVector &in = liveness->LiveIn(graph->GetEntry());
+  int numCandidates = 0, numColored = 0;
+  for (int v = 0; v < liveness->NumVars(); v++) {
+    Location *var = liveness->GetVar(v);
+    if (!candidate[v]) {
+      continue;
+    }
+    numCandidates++;
+    if (color[v] < 0) {
+      PrintDebug("regalloc", "%s (fp%+d) stays on the stack, cost %g",
+                 var->GetName(), var->GetOffset(), cost[v]);
+      continue;
+    }
+    numColored++;
+    if (var->GetOffset() > 0 && in.Test(v)) {
+      begin->AddRegisterParam(var);
+    }
+    PrintDebug("regalloc", "%s (fp%+d) -> register %d, cost %g",
+               var->GetName(), var->GetOffset(), color[v], cost[v]);
+  }
+  PrintDebug("regalloc", "%d of %d candidates in registers",
+             numColored, numCandidates);
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
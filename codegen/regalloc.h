@@ -0,0 +1,64 @@
+/* File: regalloc.h                                      -*- C++ -*-
+ * ----------------
+ * Global register allocation for one function, by graph coloring.
+ *
+ * The backend already keeps values in scratch registers within a
+ * basic block, but it writes every dirty register back to the stack
+ * before each label, branch and call.  The variables that pay for
+ * that are the ones live across a block boundary or across a call,
+ * so those are the allocator's candidates; everything else is left
+ * to the backend.
+ *
+ * Candidates that are live at the same point interfere.  The
+ * interference graph is colored Chaitin style with Briggs'
+ * optimistic spilling: nodes of low degree are removed first, and
+ * when none is left the one with the lowest spill cost per
+ * interference is pushed anyway and may still find a color on the
+ * way back.  Spill cost counts each use and def of the variable,
+ * weighted by 10 per level of loop nesting.  A copy prefers the
+ * color of its source, so the move can be dropped.
+ *
+ * Colors are callee-saved registers, so a colored variable stays in
+ * its register across calls and the function saves only the
+ * registers it actually uses.  Uncolored candidates simply stay in
+ * their stack slots.
+ */
+
+#ifndef _H_regalloc
+#define _H_regalloc
+
+#include <vector>
+
+#include "codegen/cfg.h"
+#include "codegen/liveness.h"
+
+class RegisterAllocator {
+ public:
+  RegisterAllocator(FlowGraph *graph, Liveness *liveness, int numRegs);
+
+  // Colors the function's candidates and records the result on its
+  // Locations and its BeginFunc. Dumps the assignment under the
+  // "regalloc" debug key.
+  void Allocate();
+
+ private:
+  FlowGraph *graph;
+  Liveness *liveness;
+  int numRegs;
+
+  std::vector<bool> candidate;
+  std::vector<double> cost;
+  std::vector<BitVector> interferes;
+  std::vector<std::vector<int> > neighbors;
+  std::vector<int> partner;     // copy source/target, or -1
+  std::vector<int> color;
+
+  void FindCandidates();
+  void AddEdge(int a, int b);
+  void BuildGraph();
+  void Color();
+  void Rewrite();
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_regalloc */
@@ -0,0 +1,174 @@
+/* File: slots.cc
+ * --------------
+ * Implementation of SlotPacking.
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "codegen/slots.h"
+#include "codegen/codegen.h"
+
+SlotPacking::SlotPacking(FlowGraph *g, Liveness *l)
+    : graph(g), liveness(l) {
+  begin = dynamic_cast<BeginFunc*>(graph->GetEntry()->GetCode()->Nth(0));
+  Assert(begin != NULL);
+}
+
+// Locals and temps left on the stack, stored parameters aside.
+bool SlotPacking::IsPacked(int v) {
+  Location *var = liveness->GetVar(v);
+  if (var->GetOffset() > 0 || var->GetRegister() >= 0) {
+    return false;
+  }
+  List<Location*> *argParams = begin->GetArgParams();
+  for (int i = 0; i < argParams->NumElements(); i++) {
+    if (argParams->Nth(i)->GetOffset() == var->GetOffset()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SlotPacking::Extend(int v, int pos) {
+  if (start[v] < 0 || pos < start[v]) {
+    start[v] = pos;
+  }
+  if (pos > end[v]) {
+    end[v] = pos;
+  }
+}
+
+/* SlotPacking::FindRanges
+ * -----------------------
+ * Numbers the instructions in layout order and steps each block
+ * backwards from its live-out set. A variable occupies an instruction
+ * if it is live before or after it, or is written by it, so a value
+ * written and never read still gets a slot no live value shares.
+ */
+void SlotPacking::FindRanges() {
+  int n = liveness->NumVars();
+  start.assign(n, -1);
+  end.assign(n, -1);
+
+  int pos = 0;
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    BasicBlock *b = graph->Nth(i);
+    List<Instruction*> *code = b->GetCode();
+    BitVector live = liveness->LiveOut(b);
+    for (int j = code->NumElements() - 1; j >= 0; j--) {
+      Instruction *instr = code->Nth(j);
+      int p = pos + j;
+      int d = liveness->IndexOf(instr->GetDst());
+      if (d >= 0) {
+        Extend(d, p);
+      }
+      for (int v = 0; v < n; v++) {
+        if (live.Test(v)) {
+          Extend(v, p);
+        }
+      }
+      liveness->Transfer(instr, &live);
+      for (int v = 0; v < n; v++) {
+        if (live.Test(v)) {
+          Extend(v, p);
+        }
+      }
+    }
+    pos += code->NumElements();
+  }
+}
+
+// Orders variables by the start of their range.
+struct ByStart {
+  const std::vector<int> *start;
+  bool operator()(int a, int b) const {
+    return (*start)[a] < (*start)[b] || ((*start)[a] == (*start)[b] && a < b);
+  }
+};
+
+bool SlotPacking::Run() {
+  FindRanges();
+
+  // Parameters the prologue stores take the top slots for the whole
+  // function; those moved to an $s register need none.
+  std::vector<int> slot(liveness->NumVars(), -1);
+  std::map<Location*, int> offsets;
+  int numSlots = 0;
+  List<Location*> *argParams = begin->GetArgParams();
+  for (int i = 0; i < argParams->NumElements(); i++) {
+    Location *param = argParams->Nth(i);
+    if (param->GetRegister() >= 0) {
+      continue;
+    }
+    int v = liveness->IndexOf(param);
+    if (v >= 0) {
+      slot[v] = numSlots;
+    }
+    offsets[param] = CodeGenerator::OffsetToFirstLocal -
+                     CodeGenerator::VarSize * numSlots++;
+  }
+
+  std::vector<int> order;
+  for (int v = 0; v < liveness->NumVars(); v++) {
+    if (IsPacked(v) && start[v] >= 0) {
+      order.push_back(v);
+    }
+  }
+  ByStart byStart;
+  byStart.start = &start;
+  std::sort(order.begin(), order.end(), byStart);
+
+  // Active ranges by the slot they hold, and the slots given back
+  std::multimap<int, int> active;    // end -> slot
+  std::set<int> freeSlots;
+  for (size_t i = 0; i < order.size(); i++) {
+    int v = order[i];
+    while (!active.empty() && active.begin()->first < start[v]) {
+      freeSlots.insert(active.begin()->second);
+      active.erase(active.begin());
+    }
+    if (freeSlots.empty()) {
+      slot[v] = numSlots++;
+    } else {
+      slot[v] = *freeSlots.begin();
+      freeSlots.erase(freeSlots.begin());
+    }
+    active.insert(std::make_pair(end[v], slot[v]));
+  }
+
+  int oldSize = begin->GetFrameSize();
+  int newSize = CodeGenerator::VarSize * numSlots;
+  PrintDebug("slots", "%d variables in %d slots, frame %d -> %d bytes",
+             (int) order.size(), numSlots, oldSize, newSize);
+  if (newSize >= oldSize) {
+    return false;
+  }
+
+  // Several Locations may stand for one variable, and one Location
+  // may appear in many instructions, so decide all the new offsets
+  // before changing any.
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    List<Instruction*> *code = graph->Nth(i)->GetCode();
+    for (int j = 0; j < code->NumElements(); j++) {
+      Instruction *instr = code->Nth(j);
+      for (int k = -1; k < instr->NumSrcs(); k++) {
+        Location *var = k < 0 ? instr->GetDst() : instr->GetSrc(k);
+        int v = liveness->IndexOf(var);
+        if (v >= 0 && slot[v] >= 0) {
+          offsets[var] = CodeGenerator::OffsetToFirstLocal -
+                         CodeGenerator::VarSize * slot[v];
+        }
+      }
+    }
+  }
+  for (std::map<Location*, int>::iterator it = offsets.begin();
+       it != offsets.end(); ++it) {
+    it->first->SetOffset(it->second);
+  }
+  begin->SetFrameSize(newSize);
+  return true;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
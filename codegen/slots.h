@@ -0,0 +1,56 @@
+/* File: slots.h                                         -*- C++ -*-
+ * -------------
+ * Stack slot sharing for one function.
+ *
+ * The FrameAllocator hands every local and temp a slot of its own,
+ * so the frame of a long function grows with every subexpression
+ * even though most temps live for an instruction or two.  Once the
+ * register allocator has run, this pass lays the variables that
+ * still live on the stack out again, letting any two whose live
+ * ranges do not overlap share a slot.
+ *
+ * A variable's range runs, in the order the code is laid out, from
+ * the first point it is live (or written) to the last.  Ranges are
+ * packed greedily in order of their start, each taking the lowest
+ * slot free at that point, which is the usual interval coloring and
+ * needs no more slots than the most ranges open at once.  The
+ * backend only ever writes a cached value back while the variable is
+ * live (dead operands are dropped from its registers), so sharing a
+ * slot outside the range is safe.
+ *
+ * Variables given a register need no slot at all, parameters passed
+ * in $a registers included.  The other $a parameters take the top
+ * slots for the whole function, since the prologue stores them there
+ * before any Tac runs.
+ */
+
+#ifndef _H_slots
+#define _H_slots
+
+#include <vector>
+
+#include "codegen/cfg.h"
+#include "codegen/liveness.h"
+
+class SlotPacking {
+ public:
+  SlotPacking(FlowGraph *graph, Liveness *liveness);
+
+  // Rewrites the offsets of the packed variables and shrinks the frame
+  // size on the BeginFunc. Returns true if the frame got smaller.
+  // Reports under the "slots" debug key.
+  bool Run();
+
+ private:
+  FlowGraph *graph;
+  Liveness *liveness;
+  BeginFunc *begin;
+  std::vector<int> start, end;  // range by variable, -1 if none
+
+  bool IsPacked(int v);
+  void FindRanges();
+  void Extend(int v, int pos);
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_slots */
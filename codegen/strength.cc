@@ -0,0 +1,312 @@
+/* File: strength.cc
+ * -----------------
+ * Implementation of StrengthReduction.
+ */
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+#include "codegen/strength.h"
+#include "codegen/codegen.h"
+
+StrengthReduction::StrengthReduction(FlowGraph *g) : graph(g) {
+  begin = dynamic_cast<BeginFunc*>(graph->GetEntry()->GetCode()->Nth(0));
+  Assert(begin != NULL);
+}
+
+/* StrengthReduction::Run
+ * ----------------------
+ * Loop headers come after the headers of the loops enclosing them in
+ * reverse postorder, so walking it backwards handles inner loops
+ * first.  The blocks themselves never change, only their code.
+ */
+bool StrengthReduction::Run() {
+  List<BasicBlock*> *rpo = graph->GetReversePostorder();
+  int numLoops = 0;
+  for (int i = rpo->NumElements() - 1; i >= 0; i--) {
+    numLoops += ReduceLoop(rpo->Nth(i));
+  }
+  PrintDebug("strength", "%d loops reduced", numLoops);
+  return numLoops > 0;
+}
+
+// Marks the natural loop headed by header in inLoop. Returns false
+// if header heads no loop.
+bool StrengthReduction::FindLoop(BasicBlock *header) {
+  List<BasicBlock*> work;
+  List<BasicBlock*> *preds = header->GetPreds();
+  for (int i = 0; i < preds->NumElements(); i++) {
+    if (graph->Dominates(header, preds->Nth(i))) {
+      work.Append(preds->Nth(i));
+    }
+  }
+  if (work.NumElements() == 0) {
+    return false;
+  }
+
+  inLoop.assign(graph->NumBlocks(), false);
+  inLoop[header->GetId()] = true;
+  while (work.NumElements() > 0) {
+    BasicBlock *b = work.Nth(work.NumElements() - 1);
+    work.RemoveAt(work.NumElements() - 1);
+    if (inLoop[b->GetId()] || !b->IsReachable()) {
+      continue;
+    }
+    inLoop[b->GetId()] = true;
+    for (int i = 0; i < b->GetPreds()->NumElements(); i++) {
+      work.Append(b->GetPreds()->Nth(i));
+    }
+  }
+  return true;
+}
+
+/* StrengthReduction::Scan
+ * -----------------------
+ * Counts the definitions in b and collects its accesses and steps.
+ * The patterns are matched within the block, which is where the code
+ * generator puts the constants and temps they are made of.
+ */
+void StrengthReduction::Scan(BasicBlock *b, FrameVars *vars) {
+  std::map<int, int> constants;
+  std::map<int, BinaryOp*> shifts;        // s -> s = iv << k
+  std::map<int, int> shiftBy;             // s -> k
+  std::map<int, std::pair<int, int> > sums;   // t -> (v, c): t = v + c
+
+  List<Instruction*> *code = b->GetCode();
+  for (int j = 0; j < code->NumElements(); j++) {
+    Instruction *instr = code->Nth(j);
+    int d = vars->IndexOf(instr->GetDst());
+    if (d < 0) {
+      continue;
+    }
+    int x = instr->NumSrcs() > 0 ? vars->IndexOf(instr->GetSrc(0)) : -1;
+    int y = instr->NumSrcs() > 1 ? vars->IndexOf(instr->GetSrc(1)) : -1;
+
+    // What the new value is, worked out before d's old entries go.
+    LoadConstant *lc = dynamic_cast<LoadConstant*>(instr);
+    BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+    BinaryOp *shift = NULL;
+    bool isSum = false;
+    std::pair<int, int> sum;
+    int step = 0;
+    bool isStep = false;
+
+    if (op != 0 && op->GetOpCode() == BinaryOp::Shl && x >= 0 &&
+        constants.count(y) && constants[y] >= 0 && constants[y] < 32) {
+      shift = op;
+    } else if (op != 0 && op->GetOpCode() == BinaryOp::Add) {
+      Access access = { b, instr, NULL, NULL, 0 };
+      if (x >= 0 && shifts.count(y)) {
+        access.base = op->GetSrc(0);
+        access.iv = shifts[y]->GetSrc(0);
+        access.shift = shiftBy[y];
+        accesses.push_back(access);
+      } else if (y >= 0 && shifts.count(x)) {
+        access.base = op->GetSrc(1);
+        access.iv = shifts[x]->GetSrc(0);
+        access.shift = shiftBy[x];
+        accesses.push_back(access);
+      }
+      if (x >= 0 && constants.count(y)) {
+        isSum = true;
+        sum = std::make_pair(x, constants[y]);
+      } else if (y >= 0 && constants.count(x)) {
+        isSum = true;
+        sum = std::make_pair(y, constants[x]);
+      }
+    } else if (op != 0 && op->GetOpCode() == BinaryOp::Sub && x >= 0 &&
+               constants.count(y)) {
+      isSum = true;
+      sum = std::make_pair(x, (int) (0u - (unsigned int) constants[y]));
+    } else if (dynamic_cast<Assign*>(instr) != 0 && sums.count(x) &&
+               sums[x].first == d) {
+      isStep = true;
+      step = sums[x].second;
+    }
+    if (isSum && sum.first == d) {
+      isStep = true;
+      step = sum.second;
+    }
+
+    numDefs[d]++;
+    if (isStep) {
+      Step s = { b, instr, d, step };
+      steps.push_back(s);
+      numSteps[d]++;
+    }
+
+    constants.erase(d);
+    shifts.erase(d);
+    shiftBy.erase(d);
+    sums.erase(d);
+    std::map<int, BinaryOp*>::iterator s = shifts.begin();
+    while (s != shifts.end()) {
+      if (vars->IndexOf(s->second->GetSrc(0)) == d) {
+        shiftBy.erase(s->first);
+        shifts.erase(s++);
+      } else {
+        ++s;
+      }
+    }
+    std::map<int, std::pair<int, int> >::iterator t = sums.begin();
+    while (t != sums.end()) {
+      if (t->second.first == d) {
+        sums.erase(t++);
+      } else {
+        ++t;
+      }
+    }
+
+    if (lc != 0) {
+      constants[d] = lc->GetValue();
+    }
+    if (shift != NULL) {
+      shifts[d] = shift;
+      shiftBy[d] = constants[y];
+    }
+    if (isSum && sum.first != d) {
+      sums[d] = sum;
+    }
+  }
+}
+
+/* StrengthReduction::ReduceLoop
+ * -----------------------------
+ * Returns true if the loop headed by header was changed.
+ * Accesses with the same base, variable and scale share one pointer.
+ */
+bool StrengthReduction::ReduceLoop(BasicBlock *header) {
+  if (!FindLoop(header)) {
+    return false;
+  }
+
+  FrameVars vars(graph);    // includes what inner loops added
+  accesses.clear();
+  steps.clear();
+  numDefs.assign(vars.NumVars(), 0);
+  numSteps.assign(vars.NumVars(), 0);
+  for (int i = 0; i < graph->NumBlocks(); i++) {
+    if (inLoop[i]) {
+      Scan(graph->Nth(i), &vars);
+    }
+  }
+
+  std::vector<bool> done(accesses.size(), false);
+  bool changed = false;
+  for (size_t i = 0; i < accesses.size(); i++) {
+    int base = vars.IndexOf(accesses[i].base);
+    int iv = vars.IndexOf(accesses[i].iv);
+    if (done[i] || numDefs[base] > 0 || numDefs[iv] != numSteps[iv]) {
+      continue;
+    }
+    std::vector<Access> group;
+    for (size_t j = i; j < accesses.size(); j++) {
+      if (vars.IndexOf(accesses[j].base) == base &&
+          vars.IndexOf(accesses[j].iv) == iv &&
+          accesses[j].shift == accesses[i].shift) {
+        group.push_back(accesses[j]);
+        done[j] = true;
+      }
+    }
+    Reduce(header, &vars, group);
+    changed = true;
+  }
+  return changed;
+}
+
+void StrengthReduction::Reduce(BasicBlock *header, FrameVars *vars,
+                               const std::vector<Access> &group) {
+  const Access &first = group[0];
+  int iv = vars->IndexOf(first.iv);
+  Location *ptr = NewVar(), *scale = NewVar(), *offset = NewVar();
+
+  List<BasicBlock*> *preds = header->GetPreds();
+  for (int i = 0; i < preds->NumElements(); i++) {
+    BasicBlock *p = preds->Nth(i);
+    if (inLoop[p->GetId()] || !p->IsReachable()) {
+      continue;
+    }
+    InsertAtExit(p, new LoadConstant(scale, first.shift));
+    InsertAtExit(p, new BinaryOp(BinaryOp::Shl, offset, first.iv, scale));
+    InsertAtExit(p, new BinaryOp(BinaryOp::Add, ptr, first.base, offset));
+  }
+
+  for (size_t i = 0; i < steps.size(); i++) {
+    if (steps[i].iv != iv) {
+      continue;
+    }
+    List<Instruction*> *code = steps[i].block->GetCode();
+    int j = IndexIn(code, steps[i].def);
+    unsigned int stride = (unsigned int) steps[i].step << first.shift;
+    code->InsertAt(new LoadConstant(offset, (int) stride), j + 1);
+    code->InsertAt(new BinaryOp(BinaryOp::Add, ptr, ptr, offset), j + 2);
+  }
+
+  for (size_t i = 0; i < group.size(); i++) {
+    List<Instruction*> *code = group[i].block->GetCode();
+    Location *addr = group[i].add->GetDst();
+    int j = IndexIn(code, group[i].add);
+    code->RemoveAt(j);
+    code->InsertAt(new Assign(addr, ptr), j);
+
+    // The loads and stores through addr that follow can use ptr
+    // itself, up to the next step of either.
+    int a = vars->IndexOf(addr);
+    for (int k = j + 1; k < code->NumElements(); k++) {
+      Instruction *use = code->Nth(k);
+      Load *load = dynamic_cast<Load*>(use);
+      Store *store = dynamic_cast<Store*>(use);
+      if (load != 0 && vars->IndexOf(load->GetSrc(0)) == a) {
+        code->RemoveAt(k);
+        code->InsertAt(new Load(load->GetDst(), ptr, load->GetOffset()), k);
+      } else if (store != 0 && vars->IndexOf(store->GetSrc(0)) == a) {
+        code->RemoveAt(k);
+        code->InsertAt(new Store(ptr, store->GetSrc(1), store->GetOffset()),
+                       k);
+      }
+      if (use->GetDst() == ptr || vars->IndexOf(use->GetDst()) == a) {
+        break;
+      }
+    }
+  }
+  PrintDebug("strength", "%s[%s] walked by %s from B%d", first.base->GetName(),
+             first.iv->GetName(), ptr->GetName(), header->GetId());
+}
+
+// A new slot at the bottom of the frame.
+Location *StrengthReduction::NewVar() {
+  static int nextVarNum;
+  char name[16];
+  sprintf(name, "_sr%d", nextVarNum++);
+  int size = begin->GetFrameSize();
+  begin->SetFrameSize(size + CodeGenerator::VarSize);
+  return new Location(fpRelative, CodeGenerator::OffsetToFirstLocal - size,
+                      strdup(name));
+}
+
+int StrengthReduction::IndexIn(List<Instruction*> *code,
+                               Instruction *instr) {
+  for (int j = 0; j < code->NumElements(); j++) {
+    if (code->Nth(j) == instr) {
+      return j;
+    }
+  }
+  Failure("instruction not in its block");
+  return -1;
+}
+
+// Adds instr to the end of b, ahead of the branch that leaves it.
+void StrengthReduction::InsertAtExit(BasicBlock *b, Instruction *instr) {
+  List<Instruction*> *code = b->GetCode();
+  Instruction *last = b->GetLast();
+  if (dynamic_cast<Goto*>(last) != 0 || dynamic_cast<IfZ*>(last) != 0 ||
+      dynamic_cast<IfCompare*>(last) != 0 ||
+      dynamic_cast<JumpTable*>(last) != 0) {
+    code->InsertAt(instr, code->NumElements() - 1);
+  } else {
+    code->Append(instr);
+  }
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,79 @@
+/* File: strength.h                                      -*- C++ -*-
+ * ----------------
+ * Induction-variable strength reduction over the Tac of one function.
+ *
+ * An array access inside a loop computes its element address as
+ *
+ *     s = i << 2 ;
+ *     addr = arr + s ;
+ *
+ * on every iteration.  When arr does not change in the loop and every
+ * assignment to i in the loop adds a constant to it (i = i + c, as
+ * emitted, through a temp), the address can be carried instead:
+ *
+ *     p = arr + (i << 2)       on each edge into the loop
+ *     p = p + (c << 2)         after each step of i
+ *     addr = p                 in place of the add
+ *
+ * so the loop walks a pointer.  An i that does not change in the loop
+ * at all is a special case, where p is simply hoisted out of it.
+ * Loops are handled innermost first, and the code a loop gets on its
+ * entry edges has the same shape, so a pointer set up inside an
+ * enclosing loop is in turn reduced there.
+ *
+ * The shift and add the access no longer reads are left for dead
+ * code removal.
+ */
+
+#ifndef _H_strength
+#define _H_strength
+
+#include <vector>
+
+#include "codegen/cfg.h"
+#include "codegen/liveness.h"
+
+class StrengthReduction {
+ public:
+  StrengthReduction(FlowGraph *graph);
+
+  // Returns true if any loop was changed. Reports under the
+  // "strength" debug key.
+  bool Run();
+
+ private:
+  // addr = base + (iv << shift)
+  struct Access {
+    BasicBlock *block;
+    Instruction *add;
+    Location *base, *iv;
+    int shift;
+  };
+
+  // iv = iv + step, possibly through a temp
+  struct Step {
+    BasicBlock *block;
+    Instruction *def;
+    int iv, step;
+  };
+
+  FlowGraph *graph;
+  BeginFunc *begin;
+  std::vector<bool> inLoop;               // by block
+  std::vector<Access> accesses;
+  std::vector<Step> steps;
+  std::vector<int> numDefs, numSteps;
+
+  bool FindLoop(BasicBlock *header);
+  void Scan(BasicBlock *b, FrameVars *vars);
+  bool ReduceLoop(BasicBlock *header);
+  void Reduce(BasicBlock *header, FrameVars *vars,
+              const std::vector<Access> &group);
+  Location *NewVar();
+
+  static int IndexIn(List<Instruction*> *code, Instruction *instr);
+  static void InsertAtExit(BasicBlock *b, Instruction *instr);
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* _H_strength */
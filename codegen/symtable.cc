@@ -62,8 +62,12 @@ SymTable::SymTable() {
   _prev = NULL;
   _super = NULL;
   _this = NULL;
-  _table = new Hashtable<Symbol*>;
-  _blocks = new List<SymTable*>;
+  // Scopes live in the arena, which never runs their destructors, so
+  // the table's storage has to come from there too.
+  _table = new (CompilationArena()) Hashtable<Symbol*>(CompilationArena());
+  _firstBlock = NULL;
+  _lastBlock = NULL;
+  _nextBlock = NULL;
   _refnode = NULL;
   _breaknode = NULL;
 }
@@ -77,13 +81,13 @@ Node *SymTable::getThisClass() {
 
 }
 
-bool SymTable::add(char *key, Node *node) {
+bool SymTable::add(Atom key, Node *node) {
   Symbol *s = new Symbol(S_VARIABLE, node);
   _table->Enter(key, s, false);
   return true;
 }
 
-bool SymTable::add(char *key, Node *node, Location *loc) {
+bool SymTable::add(Atom key, Node *node, Location *loc) {
   Symbol *s = new Symbol(S_VARIABLE, node, loc);
   _table->Enter(key, s, false);
   return true;
@@ -95,7 +99,12 @@ SymTable *SymTable::addScope() {
   if (_this) {
     child->setThis(_this);
   }
-  _blocks->Append(child);
+  if (_lastBlock) {
+    _lastBlock->_nextBlock = child;
+  } else {
+    _firstBlock = child;
+  }
+  _lastBlock = child;
 
   if (_refnode) {
     child->setRefNode(_refnode);
@@ -106,7 +115,7 @@ SymTable *SymTable::addScope() {
   return child;
 }
 
-SymTable *SymTable::addWithScope(char *key, Node *node, int type) {
+SymTable *SymTable::addWithScope(Atom key, Node *node, int type) {
   SymTable *newEnv = new SymTable;
   Symbol *refNode = NULL;
   newEnv->setParent(this);
@@ -121,7 +130,7 @@ SymTable *SymTable::addWithScope(char *key, Node *node, int type) {
   return newEnv;
 }
 
-bool SymTable::subclassOf(char *key) {
+bool SymTable::subclassOf(Atom key) {
   SymTable *current = _super;
   ClassDecl *classDecl = NULL;
 
@@ -135,7 +144,7 @@ bool SymTable::subclassOf(char *key) {
       continue;
     }
 
-    if (strcmp(key, classDecl->GetName()) == 0 ||
+    if (key == classDecl->GetName() ||
         classDecl->ImplementsInterface(key)) {
       return true;
     }
@@ -144,7 +153,7 @@ bool SymTable::subclassOf(char *key) {
   return false;
 }
 
-Symbol *SymTable::findSuper(char *key) {
+Symbol *SymTable::findSuper(Atom key) {
   Symbol *sym = NULL;
   SymTable *current = _super;
 
@@ -161,7 +170,7 @@ Symbol *SymTable::findSuper(char *key) {
   return NULL;
 }
 
-Symbol *SymTable::findInClass(char *key) {
+Symbol *SymTable::findInClass(Atom key) {
   Symbol *sym = NULL;
 
   if ((sym = findLocal(key)) != NULL) {
@@ -175,7 +184,7 @@ Symbol *SymTable::findInClass(char *key) {
   return NULL;
 }
 
-Symbol *SymTable::findLocal(char *key) {
+Symbol *SymTable::findLocal(Atom key) {
   Symbol *sym = NULL;
 
   if ((sym = _table->Lookup(key)) != NULL) {
@@ -192,7 +201,7 @@ Symbol *SymTable::findLocal(char *key) {
 }
 
 
-Symbol *SymTable::find(char *key) {
+Symbol *SymTable::find(Atom key) {
   SymTable *current = this;
   Symbol *sym = NULL;
 
@@ -211,7 +220,7 @@ Symbol *SymTable::find(char *key) {
   return NULL;
 }
 
-Symbol *SymTable::findUp(char *key) {
+Symbol *SymTable::findUp(Atom key) {
   SymTable *current = _prev;
   Symbol *sym = NULL;
 
@@ -224,7 +233,7 @@ Symbol *SymTable::findUp(char *key) {
   return NULL;
 }
 
-Symbol *SymTable::findClassField(char *className, char *fieldName) {
+Symbol *SymTable::findClassField(Atom className, Atom fieldName) {
   Symbol *classSym = find(className);
   if (classSym == NULL) {
     return NULL;
@@ -250,8 +259,8 @@ void SymTable::print(int indentLevel) {
     sym->print(indentLevel);
   }
 
-  for (int i = 0; i < _blocks->NumElements(); i++) {
-    _blocks->Nth(i)->print(indentLevel + 1);
+  for (SymTable *b = _firstBlock; b != NULL; b = b->_nextBlock) {
+    b->print(indentLevel + 1);
   }
 }
 
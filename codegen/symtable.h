@@ -10,8 +10,10 @@
 
 #include <cstdlib>
 
-#include "arch/mips/tac.h"
+#include "codegen/tac.h"
 #include "ast/ast.h"
+#include "decaf/arena.h"
+#include "decaf/atom.h"
 #include "decaf/hashtable.h"
 #include "decaf/list.h"
 
@@ -25,7 +27,7 @@ enum {
 class Node;
 class SymTable;
 
-class Symbol {
+class Symbol : public ArenaObject {
  protected:
   int type;
   Node *node;
@@ -71,7 +73,7 @@ class Symbol {
   void print(int indentLevel);
 };
 
-class SymTable {
+class SymTable : public ArenaObject {
  protected:
   SymTable *_prev;             // Pointer to SymTable of parent scope
   Node *_refnode;              // Pointer to node that scope belongs to
@@ -80,8 +82,10 @@ class SymTable {
   SymTable *_this;             // Scope of current class, NULL if no class
   Hashtable<Symbol*> *_table;  // Pointer to hash table for scope
 
-  /* For printing purposes only */
-  List<SymTable*> *_blocks;
+  /* For printing purposes only: scopes made by addScope */
+  SymTable *_firstBlock;
+  SymTable *_lastBlock;
+  SymTable *_nextBlock;        // next scope made by the parent
 
  public:
   SymTable();
@@ -127,45 +131,45 @@ class SymTable {
   }
 
   Node *getThisClass();
-  bool subclassOf(char *key);
+  bool subclassOf(Atom key);
 
-  bool add(char *key, Node *node);
-  bool add(char *key, Node *node, Location *loc);
+  bool add(Atom key, Node *node);
+  bool add(Atom key, Node *node, Location *loc);
   SymTable *addScope();
-  SymTable *addWithScope(char *key, Node *node, int type);
+  SymTable *addWithScope(Atom key, Node *node, int type);
 
-  Symbol *findSuper(char *key);
-  Symbol *findSuper(char *key, int type) {
+  Symbol *findSuper(Atom key);
+  Symbol *findSuper(Atom key, int type) {
     Symbol *s = findSuper(key);
     return (s && s->getType() == type) ? s : NULL;
   }
 
-  Symbol *findLocal(char *key);
-  Symbol *findLocal(char *key, int type) {
+  Symbol *findLocal(Atom key);
+  Symbol *findLocal(Atom key, int type) {
     Symbol *s = findLocal(key);
     return (s && s->getType() == type) ? s : NULL;
   }
 
-  Symbol *findInClass(char *key);
-  Symbol *findInClass(char *key, int type) {
+  Symbol *findInClass(Atom key);
+  Symbol *findInClass(Atom key, int type) {
     Symbol *s = findInClass(key);
     return (s && s->getType() == type) ? s : NULL;
   }
 
-  Symbol *find(char *key);
-  Symbol *find(char *key, int type) {
+  Symbol *find(Atom key);
+  Symbol *find(Atom key, int type) {
     Symbol *s = find(key);
     return (s && s->getType() == type) ? s : NULL;
   }
 
-  Symbol *findUp(char *key);
-  Symbol *findUp(char *key, int type) {
+  Symbol *findUp(Atom key);
+  Symbol *findUp(Atom key, int type) {
     Symbol *s = findUp(key);
     return (s && s->getType() == type) ? s : NULL;
   }
 
-  Symbol *findClassField(char *className, char *fieldName);
-  Symbol *findClassField(char *className, char *fieldName, int type) {
+  Symbol *findClassField(Atom className, Atom fieldName);
+  Symbol *findClassField(Atom className, Atom fieldName, int type) {
     Symbol *s = findClassField(className, fieldName);
     return (s && s->getType() == type) ? s : NULL;
   }
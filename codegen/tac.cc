@@ -0,0 +1,451 @@
+/* File: tac.cc
+ * ------------
+ * Implementation of Location class and Instruction class/subclasses.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "codegen/emitter.h"
+#include "codegen/tac.h"
+#include "decaf/atom.h"
+
+Location::Location(Segment s, int o, const char *name)
+    : variableName(strdup(name)), segment(s), offset(o), reg(-1),
+      nonNull(false) {
+}
+
+void Instruction::Print() {
+  fprintf(kOutputFile, "\t%s ;\n", printed);
+}
+
+void Instruction::Emit(TargetEmitter *target) {
+  if (*printed) {
+    target->Emit("# %s", printed);   // emit TAC as comment into assembly
+  }
+  target->SetDeadOperands(dead, numDead);
+  EmitSpecific(target);
+  target->DiscardDeadOperands();
+}
+
+void Instruction::AddDead(Location *var) {
+  Assert(numDead < MaxDead);
+  dead[numDead++] = var;
+}
+
+LoadConstant::LoadConstant(Location *d, int v)
+    : dst(d), val(v) {
+  Assert(dst != NULL);
+  sprintf(printed, "%s = %d", dst->GetName(), val);
+}
+
+void LoadConstant::EmitSpecific(TargetEmitter *target) {
+  target->EmitLoadConstant(dst, val);
+}
+
+LoadStringConstant::LoadStringConstant(Location *d, const char *s)
+    : dst(d) {
+  Assert(dst != NULL && s != NULL);
+  const char *quote = (*s == '"') ? "" : "\"";
+  str = new char[strlen(s) + 2*strlen(quote) + 1];
+  sprintf(str, "%s%s%s", quote, s, quote);
+  quote = (strlen(str) > 50) ? "...\"" : "";
+  sprintf(printed, "%s = %.50s%s", dst->GetName(), str, quote);
+}
+
+void LoadStringConstant::EmitSpecific(TargetEmitter *target) {
+  target->EmitLoadStringConstant(dst, str);
+}
+
+LoadLabel::LoadLabel(Location *d, const char *l)
+    : dst(d), label(strdup(l)) {
+  Assert(dst != NULL && label != NULL);
+  sprintf(printed, "%s = %s", dst->GetName(), label);
+}
+
+void LoadLabel::EmitSpecific(TargetEmitter *target) {
+  target->EmitLoadLabel(dst, label);
+}
+
+Assign::Assign(Location *d, Location *s)
+    : dst(d), src(s) {
+  Assert(dst != NULL);
+  Assert(src != NULL);
+  sprintf(printed, "%s = %s", dst->GetName(), src->GetName());
+}
+
+void Assign::EmitSpecific(TargetEmitter *target) {
+  target->EmitCopy(dst, src);
+}
+
+Load::Load(Location *d, Location *s, int off)
+    : dst(d), src(s), offset(off) {
+  Assert(dst != NULL && src != NULL);
+  if (offset) {
+    sprintf(printed, "%s = *(%s + %d)", dst->GetName(), src->GetName(), offset);
+  } else {
+    sprintf(printed, "%s = *(%s)", dst->GetName(), src->GetName());
+  }
+}
+
+void Load::EmitSpecific(TargetEmitter *target) {
+  target->EmitLoad(dst, src, offset);
+}
+
+Store::Store(Location *d, Location *s, int off)
+    : dst(d), src(s), offset(off) {
+  Assert(dst != NULL && src != NULL);
+  if (offset) {
+    sprintf(printed, "*(%s + %d) = %s", dst->GetName(), offset, src->GetName());
+  } else {
+    sprintf(printed, "*(%s) = %s", dst->GetName(), src->GetName());
+  }
+}
+
+void Store::EmitSpecific(TargetEmitter *target) {
+  target->EmitStore(dst, src, offset);
+}
+
+const char* const BinaryOp::opName[BinaryOp::NumOps] = {
+  "+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&&", "||", "^",
+  "<<", ">>", "u<=", "u>"
+};
+
+BinaryOp::OpCode BinaryOp::OpCodeForName(const char *name) {
+  for (int i = 0; i < NumOps; i++) {
+    if (opName[i] && !strcmp(opName[i], name)) {
+      return (OpCode)i;
+    }
+  }
+  Failure("Unrecognized Tac operator: '%s'\n", name);
+  return Add; // can't get here, but compiler doesn't know that
+}
+
+bool BinaryOp::Evaluate(OpCode code, int a, int b, int *result) {
+  unsigned int ua = a, ub = b;
+  switch (code) {
+    case Add: *result = (int) (ua + ub); return true;
+    case Sub: *result = (int) (ua - ub); return true;
+    case Mul: *result = (int) (ua * ub); return true;
+    case Div:
+    case Mod:
+      if (b == 0 || (a == INT_MIN && b == -1)) {
+        return false;
+      }
+      *result = (code == Div) ? a / b : a % b;
+      return true;
+    case Eq: *result = (a == b); return true;
+    case NotEq: *result = (a != b); return true;
+    case Less: *result = (a < b); return true;
+    case LessEq: *result = (a <= b); return true;
+    case Greater: *result = (a > b); return true;
+    case GreaterEq: *result = (a >= b); return true;
+    case And: *result = a & b; return true;
+    case Or: *result = a | b; return true;
+    case Xor: *result = a ^ b; return true;
+    case Shl: *result = (int) (ua << (ub & 31)); return true;
+    case Shr: *result = (int) (ua >> (ub & 31)); return true;
+    case LessEqU: *result = (ua <= ub); return true;
+    case GreaterU: *result = (ua > ub); return true;
+    default: return false;
+  }
+}
+
+bool BinaryOp::IsRelational(OpCode code) {
+  return code == Eq || code == NotEq || code == Less || code == LessEq ||
+         code == Greater || code == GreaterEq || code == LessEqU ||
+         code == GreaterU;
+}
+
+BinaryOp::OpCode BinaryOp::Negate(OpCode code) {
+  switch (code) {
+    case Eq: return NotEq;
+    case NotEq: return Eq;
+    case Less: return GreaterEq;
+    case LessEq: return Greater;
+    case Greater: return LessEq;
+    case GreaterEq: return Less;
+    case LessEqU: return GreaterU;
+    case GreaterU: return LessEqU;
+    default:
+      Failure("Tac operator '%s' is not a comparison", opName[code]);
+      return code;
+  }
+}
+
+BinaryOp::BinaryOp(OpCode c, Location *d, Location *o1, Location *o2)
+    : code(c), dst(d), op1(o1), op2(o2), imm(0) {
+  Assert(dst != NULL && op1 != NULL && op2 != NULL);
+  Assert(code >= 0 && code < NumOps);
+  sprintf(printed, "%s = %s %s %s", dst->GetName(), op1->GetName(),
+          opName[code], op2->GetName());
+}
+
+BinaryOp::BinaryOp(OpCode c, Location *d, Location *o1, int i)
+    : code(c), dst(d), op1(o1), op2(NULL), imm(i) {
+  Assert(dst != NULL && op1 != NULL);
+  Assert(code >= 0 && code < NumOps);
+  sprintf(printed, "%s = %s %s %d", dst->GetName(), op1->GetName(),
+          opName[code], imm);
+}
+
+void BinaryOp::EmitSpecific(TargetEmitter *target) {
+  if (HasImmediate()) {
+    target->EmitBinaryOp(code, dst, op1, imm);
+  } else {
+    target->EmitBinaryOp(code, dst, op1, op2);
+  }
+}
+
+// Branch targets are interned so the flow graph can match a Goto or
+// IfZ to its Label by pointer.
+Label::Label(const char *l) : label(Intern(l)) {
+  Assert(label != NULL);
+  *printed = '\0';
+}
+
+void Label::Print() {
+  fprintf(kOutputFile, "%s:\n", label);
+}
+
+void Label::EmitSpecific(TargetEmitter *target) {
+  target->EmitLabel(label);
+}
+
+Goto::Goto(const char *l) : label(Intern(l)) {
+  Assert(label != NULL);
+  sprintf(printed, "Goto %s", label);
+}
+
+void Goto::EmitSpecific(TargetEmitter *target) {
+  target->EmitGoto(label);
+}
+
+IfZ::IfZ(Location *te, const char *l)
+    : test(te), label(Intern(l)) {
+  Assert(test != NULL && label != NULL);
+  sprintf(printed, "IfZ %s Goto %s", test->GetName(), label);
+}
+
+void IfZ::EmitSpecific(TargetEmitter *target) {
+  target->EmitIfZ(test, label);
+}
+
+IfCompare::IfCompare(BinaryOp::OpCode r, Location *o1, Location *o2,
+                     const char *l)
+    : rel(r), op1(o1), op2(o2), label(Intern(l)) {
+  Assert(op1 != NULL && op2 != NULL && label != NULL);
+  Assert(BinaryOp::IsRelational(rel));
+  sprintf(printed, "If %s %s %s Goto %s", op1->GetName(),
+          BinaryOp::opName[rel], op2->GetName(), label);
+}
+
+void IfCompare::EmitSpecific(TargetEmitter *target) {
+  target->EmitIfCompare(rel, op1, op2, label);
+}
+
+JumpTable::JumpTable(Location *i, const char *l, List<const char*> *t)
+    : index(i), tableLabel(Intern(l)), targets(new List<const char*>) {
+  Assert(index != NULL && tableLabel != NULL && t != NULL);
+  for (int j = 0; j < t->NumElements(); j++) {
+    targets->Append(Intern(t->Nth(j)));
+  }
+  sprintf(printed, "Goto %s[%s]", tableLabel, index->GetName());
+}
+
+void JumpTable::Print() {
+  fprintf(kOutputFile, "\t%s of", printed);
+  for (int i = 0; i < targets->NumElements(); i++) {
+    fprintf(kOutputFile, "%s %s", i ? "," : "", targets->Nth(i));
+  }
+  fprintf(kOutputFile, " ;\n");
+}
+
+void JumpTable::EmitSpecific(TargetEmitter *target) {
+  target->EmitJumpTable(index, tableLabel, targets);
+}
+
+BeginFunc::BeginFunc() {
+  sprintf(printed,"BeginFunc (unassigned)");
+  frameSize = -555; // used as sentinel to recognized unassigned value
+  savedRegs = 0;
+  regParams = new List<Location*>;
+  argParams = new List<Location*>;
+  leaf = false;
+}
+
+void BeginFunc::SetFrameSize(int numBytesForAllLocalsAndTemps) {
+  frameSize = numBytesForAllLocalsAndTemps;
+  sprintf(printed,"BeginFunc %d", frameSize);
+}
+
+void BeginFunc::EmitSpecific(TargetEmitter *target) {
+  target->EmitBeginFunction(frameSize, savedRegs, regParams, argParams, leaf);
+}
+
+EndFunc::EndFunc() : Instruction(), reachable(true) {
+  sprintf(printed, "EndFunc");
+}
+
+void EndFunc::EmitSpecific(TargetEmitter *target) {
+  if (reachable) {
+    target->EmitEndFunction();
+  }
+}
+
+Return::Return(Location *v) : val(v) {
+  sprintf(printed, "Return %s", val? val->GetName() : "");
+}
+
+void Return::EmitSpecific(TargetEmitter *target) {
+  target->EmitReturn(val);
+}
+
+PushParam::PushParam(Location *p, int r)
+    : param(p), argReg(r) {
+  Assert(param != NULL);
+  if (argReg < 0) {
+    sprintf(printed, "PushParam %s", param->GetName());
+  } else {
+    sprintf(printed, "PushParam %s in a%d", param->GetName(), argReg);
+  }
+}
+
+void PushParam::EmitSpecific(TargetEmitter *target) {
+  target->EmitParam(param, argReg);
+}
+
+PopParams::PopParams(int nb)
+  : numBytes(nb) {
+  sprintf(printed, "PopParams %d", numBytes);
+}
+
+void PopParams::EmitSpecific(TargetEmitter *target) {
+  target->EmitPopParams(numBytes);
+}
+
+LCall::LCall(const char *l, Location *d)
+    : label(strdup(l)), dst(d) {
+  sprintf(printed, "%s%sLCall %s", dst? dst->GetName(): "", dst?" = ":"", label);
+}
+
+void LCall::EmitSpecific(TargetEmitter *target) {
+  target->EmitLCall(dst, label);
+}
+
+ACall::ACall(Location *ma, Location *d)
+    : dst(d), methodAddr(ma) {
+  Assert(methodAddr != NULL);
+  sprintf(printed, "%s%sACall %s", dst? dst->GetName(): "", dst?" = ":"",
+	    methodAddr->GetName());
+}
+
+void ACall::EmitSpecific(TargetEmitter *target) {
+  target->EmitACall(dst, methodAddr);
+}
+
+VTable::VTable(const char *l, List<const char *> *m)
+    : methodLabels(m), label(strdup(l)) {
+  Assert(methodLabels != NULL && label != NULL);
+  sprintf(printed, "VTable for class %s", l);
+}
+
+void VTable::Print() {
+  fprintf(kOutputFile, "VTable %s =\n", label);
+  for (int i = 0; i < methodLabels->NumElements(); i++) {
+    fprintf(kOutputFile, "\t%s,\n", methodLabels->Nth(i));
+  }
+  fprintf(kOutputFile, "; \n");
+}
+
+void VTable::EmitSpecific(TargetEmitter *target) {
+  target->EmitVTable(label, methodLabels);
+}
+
+/* Instruction::Clone
+ * ------------------
+ * One per instruction class, each building the same instruction
+ * over renamed operands.
+ */
+Instruction *Instruction::Clone(Renaming *r) {
+  Failure("cannot copy %s", printed);
+  return NULL;
+}
+
+Instruction *LoadConstant::Clone(Renaming *r) {
+  return new LoadConstant(r->Rename(dst), val);
+}
+
+Instruction *LoadStringConstant::Clone(Renaming *r) {
+  return new LoadStringConstant(r->Rename(dst), str);
+}
+
+Instruction *LoadLabel::Clone(Renaming *r) {
+  return new LoadLabel(r->Rename(dst), label);
+}
+
+Instruction *Assign::Clone(Renaming *r) {
+  return new Assign(r->Rename(dst), r->Rename(src));
+}
+
+Instruction *Load::Clone(Renaming *r) {
+  return new Load(r->Rename(dst), r->Rename(src), offset);
+}
+
+Instruction *Store::Clone(Renaming *r) {
+  return new Store(r->Rename(dst), r->Rename(src), offset);
+}
+
+Instruction *BinaryOp::Clone(Renaming *r) {
+  if (HasImmediate()) {
+    return new BinaryOp(code, r->Rename(dst), r->Rename(op1), imm);
+  }
+  return new BinaryOp(code, r->Rename(dst), r->Rename(op1), r->Rename(op2));
+}
+
+Instruction *Label::Clone(Renaming *r) {
+  return new Label(r->Relabel(label));
+}
+
+Instruction *Goto::Clone(Renaming *r) {
+  return new Goto(r->Relabel(label));
+}
+
+Instruction *IfZ::Clone(Renaming *r) {
+  return new IfZ(r->Rename(test), r->Relabel(label));
+}
+
+Instruction *IfCompare::Clone(Renaming *r) {
+  return new IfCompare(rel, r->Rename(op1), r->Rename(op2),
+                       r->Relabel(label));
+}
+
+Instruction *JumpTable::Clone(Renaming *r) {
+  List<const char*> *labels = new List<const char*>;
+  for (int i = 0; i < targets->NumElements(); i++) {
+    labels->Append(r->Relabel(targets->Nth(i)));
+  }
+  return new JumpTable(r->Rename(index), r->Relabel(tableLabel), labels);
+}
+
+Instruction *Return::Clone(Renaming *r) {
+  return new Return(val ? r->Rename(val) : NULL);
+}
+
+Instruction *PushParam::Clone(Renaming *r) {
+  return new PushParam(r->Rename(param), argReg);
+}
+
+Instruction *PopParams::Clone(Renaming *r) {
+  return new PopParams(numBytes);
+}
+
+Instruction *LCall::Clone(Renaming *r) {
+  return new LCall(label, dst ? r->Rename(dst) : NULL);
+}
+
+Instruction *ACall::Clone(Renaming *r) {
+  return new ACall(r->Rename(methodAddr), dst ? r->Rename(dst) : NULL);
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,477 @@
+/* File: tac.h
+ * -----------
+ * This module contains the Instruction class (and its various
+ * subclasses) that represent Tac instructions and the Location
+ * class used for operands to those instructions.
+ *
+ * Each instruction is mostly just a little struct with a
+ * few fields, but each responds polymorphically to the methods
+ * Print and Emit, the first is used to print out the TAC form of
+ * the instruction (helpful when debugging) and the second to
+ * convert to the assembly of the target (see TargetEmitter).
+ *
+ * The operands to each instruction are of Location class.
+ * A Location object is a simple representation of where a variable
+ * exists at runtime, i.e. whether it is on the stack or global
+ * segment and at what offset relative to the current fp or gp.
+ *
+ * You may need to make changes/extensions to these classes
+ * if you are working on IR optimization.
+ */
+
+#ifndef _H_tac
+#define _H_tac
+
+#include "decaf/arena.h"
+#include "decaf/list.h" // for VTable
+
+class TargetEmitter;
+
+// A Location object is used to identify the operands to the
+// various TAC instructions. A Location is either fp or gp
+// relative (depending on whether in stack or global segemnt)
+// and has an offset relative to the base of that segment.
+// For example, a declaration for integer num as the first local
+// variable in a function would be assigned a Location object
+// with name "num", segment fpRelative, and offset -8.
+
+// DZC: I added the classRelative segment to the Segment enum.
+// Even though this is not really a segment, it is useful for my
+// FrameAllocator to keep track of offsets of class fields. The
+// layout of the class is similar to that of an array except the
+// first element is the pointer to the vTable. Fields begin at
+// classRelative + 4.
+
+typedef enum {
+  fpRelative,
+  gpRelative,
+  classRelative
+} Segment;
+
+class Location : public ArenaObject {
+ public:
+  Location(Segment seg, int offset, const char *name);
+
+  const char *GetName() { return variableName; }
+  Segment GetSegment() { return segment; }
+  int GetOffset() { return offset; }
+  void SetOffset(int o) { offset = o; }
+
+  // Register given to the variable for its whole function by the
+  // register allocator (an index into the target's callee-saved
+  // registers), or -1 if it lives in its stack slot.
+  int GetRegister() { return reg; }
+  void SetRegister(int r) { reg = r; }
+
+  // Set on the "this" parameter of a method, which is never null: a
+  // method is only entered through an object, and a call checks its
+  // receiver first. Copies made by a Renaming do not keep it.
+  bool IsNonNull() { return nonNull; }
+  void SetNonNull() { nonNull = true; }
+
+ protected:
+  const char *variableName;
+  Segment segment;
+  int offset;
+  int reg;
+  bool nonNull;
+};
+
+// Says what the operands and labels of an instruction become in a
+// copy of it (see Instruction::Clone). Labels it does not know are
+// kept.
+class Renaming {
+ public:
+  virtual ~Renaming() {}
+  virtual Location *Rename(Location *var) = 0;
+  virtual const char *Relabel(const char *label) = 0;
+};
+
+// base class from which all Tac instructions derived
+// has the interface for the 2 polymorphic messages: Print & Emit
+
+class Instruction : public ArenaObject {
+ public:
+  Instruction() : numDead(0) {}
+  virtual ~Instruction() {}
+	virtual void Print();
+	virtual void EmitSpecific(TargetEmitter *target) = 0;
+	virtual void Emit(TargetEmitter *target);
+
+  // Operands, for the dataflow passes: the Location written (NULL if
+  // none) and the Locations read. A Store writes memory, not a
+  // Location, so both of its operands are sources.
+  virtual Location *GetDst() { return NULL; }
+  virtual int NumSrcs() { return 0; }
+  virtual Location *GetSrc(int i) { return NULL; }
+
+  // A copy of the instruction with its operands and labels renamed,
+  // used to inline a function body. Function and vtable markers are
+  // never copied.
+  virtual Instruction *Clone(Renaming *r);
+
+  // Operands whose value is never read again once this instruction
+  // has executed. The backend drops them from its registers rather
+  // than storing them back to the stack.
+  static const int MaxDead = 3;
+  void ClearDead() { numDead = 0; }
+  void AddDead(Location *var);
+  int NumDead() { return numDead; }
+  Location *GetDead(int i) { return dead[i]; }
+
+ protected:
+  char printed[128];
+  Location *dead[MaxDead];
+  int numDead;
+};
+
+// for convenience, the instruction classes are listed here.
+// the interfaces for the classes follows below
+
+class LoadConstant;
+class LoadStringConstant;
+class LoadLabel;
+class Assign;
+class Load;
+class Store;
+class BinaryOp;
+class Label;
+class Goto;
+class IfZ;
+class IfCompare;
+class JumpTable;
+class BeginFunc;
+class EndFunc;
+class Return;
+class PushParam;
+class RemoveParams;
+class LCall;
+class ACall;
+class VTable;
+
+class LoadConstant : public Instruction {
+ public:
+  LoadConstant(Location *dst, int val);
+  int GetValue() { return val; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+
+ private:
+  Location *dst;
+  int val;
+};
+
+class LoadStringConstant : public Instruction {
+ public:
+  LoadStringConstant(Location *dst, const char *s);
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+
+ private:
+  Location *dst;
+  char *str;
+};
+
+class LoadLabel : public Instruction {
+ public:
+  LoadLabel(Location *dst, const char *label);
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+ private:
+  Location *dst;
+  const char *label;
+};
+
+class Assign : public Instruction {
+ public:
+  Assign(Location *dst, Location *src);
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return src; }
+ private:
+  Location *dst;
+  Location *src;
+};
+
+class Load : public Instruction {
+ public:
+  Load(Location *dst, Location *src, int offset = 0);
+  int GetOffset() { return offset; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return src; }
+ private:
+  Location *dst, *src;
+  int offset;
+};
+
+class Store : public Instruction {
+ public:
+  Store(Location *d, Location *s, int offset = 0);
+  int GetOffset() { return offset; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  int NumSrcs() { return 2; }
+  Location *GetSrc(int i) { return i == 0 ? dst : src; }
+ private:
+  Location *dst, *src;
+  int offset;
+};
+
+class BinaryOp : public Instruction {
+ public:
+  typedef enum {
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Eq,
+    NotEq,
+    Less,
+    LessEq,
+    Greater,
+    GreaterEq,
+    And,
+    Or,
+    Xor,
+    Shl,
+    Shr,
+    LessEqU,
+    GreaterU,
+    NumOps
+  } OpCode;
+  static const char* const opName[NumOps];
+  static OpCode OpCodeForName(const char *name);
+  // Computes a op b as both targets do, 32-bit wrap-around included
+  // (MIPS adds and subtracts with addu/subu, which never trap).
+  // Returns false where the result is not known at compile time
+  // (division by zero and its overflowing cousin).
+  static bool Evaluate(OpCode code, int a, int b, int *result);
+  // Comparisons, and the comparison true exactly when code is false.
+  // LessEqU and GreaterU compare as unsigned; they compare addresses
+  // and never come from Decaf source.
+  static bool IsRelational(OpCode code);
+  static OpCode Negate(OpCode code);
+
+ protected:
+  OpCode code;
+  Location *dst, *op1, *op2;
+  int imm;
+
+ public:
+  BinaryOp(OpCode c, Location *dst, Location *op1, Location *op2);
+  // The second operand is the constant imm, which the target must be
+  // able to encode in the instruction (see TargetEmitter::FitsImmediate).
+  BinaryOp(OpCode c, Location *dst, Location *op1, int imm);
+  OpCode GetOpCode() { return code; }
+  bool HasImmediate() { return op2 == NULL; }
+  int GetImmediate() { return imm; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+  int NumSrcs() { return HasImmediate() ? 1 : 2; }
+  Location *GetSrc(int i) { return i == 0 ? op1 : op2; }
+};
+
+class Label : public Instruction {
+ public:
+  Label(const char *label);
+  const char *GetLabel() { return label; }
+  void Print();
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+
+ private:
+  const char *label;
+};
+
+class Goto : public Instruction {
+ public:
+  Goto(const char *label);
+  const char *GetLabel() { return label; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+
+ private:
+  const char *label;
+};
+
+class IfZ : public Instruction {
+ public:
+  IfZ(Location *test, const char *label);
+  const char *GetLabel() { return label; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return test; }
+
+ private:
+  Location *test;
+  const char *label;
+};
+
+// Branches to label if op1 rel op2 holds. A comparison whose only use
+// is the IfZ right after it is fused into one of these.
+class IfCompare : public Instruction {
+ public:
+  IfCompare(BinaryOp::OpCode rel, Location *op1, Location *op2,
+            const char *label);
+  BinaryOp::OpCode GetRelation() { return rel; }
+  const char *GetLabel() { return label; }
+  int NumSrcs() { return 2; }
+  Location *GetSrc(int i) { return i == 0 ? op1 : op2; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+
+ private:
+  BinaryOp::OpCode rel;
+  Location *op1, *op2;
+  const char *label;
+};
+
+// Branches to the index'th of targets, by way of a table of their
+// addresses laid out under tableLabel. The index must be in range.
+class JumpTable : public Instruction {
+ public:
+  JumpTable(Location *index, const char *tableLabel,
+            List<const char*> *targets);
+  const char *GetTableLabel() { return tableLabel; }
+  List<const char*> *GetTargets() { return targets; }
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return index; }
+  void Print();
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+
+ private:
+  Location *index;
+  const char *tableLabel;
+  List<const char*> *targets;
+};
+
+class BeginFunc : public Instruction {
+ public:
+  BeginFunc();
+  // used to backpatch the instruction with frame size once known
+  void SetFrameSize(int numBytesForAllLocalsAndTemps);
+  int GetFrameSize() { return frameSize; }
+  // Set by the register allocator: the registers the body uses, as a
+  // bit mask, and the parameters to load into theirs on entry.
+  void SetSavedRegisters(int mask) { savedRegs = mask; }
+  void AddRegisterParam(Location *param) { regParams->Append(param); }
+  // The parameters passed in argument registers, in order. They live
+  // in the function's own frame.
+  void AddArgParam(Location *param) { argParams->Append(param); }
+  List<Location*> *GetArgParams() { return argParams; }
+  // A leaf makes no calls, so it needs no frame pointer or saved $ra.
+  void SetLeaf(bool l) { leaf = l; }
+  void EmitSpecific(TargetEmitter *target);
+
+ private:
+  int frameSize;
+  int savedRegs;
+  List<Location*> *regParams;
+  List<Location*> *argParams;
+  bool leaf;
+};
+
+class EndFunc : public Instruction {
+ public:
+  EndFunc();
+  void EmitSpecific(TargetEmitter *target);
+
+  // When every path through the function ends in a Return, nothing
+  // falls off the end and the implicit return is left out.
+  void SetReachable(bool r) { reachable = r; }
+
+ protected:
+  bool reachable;
+};
+
+class Return : public Instruction {
+ public:
+  Return(Location *val);
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  int NumSrcs() { return val ? 1 : 0; }
+  Location *GetSrc(int i) { return val; }
+
+ private:
+  Location *val;
+};
+
+// Passes param on the stack, or in argument register argReg if that
+// is not -1.
+class PushParam : public Instruction {
+ public:
+  PushParam(Location *param, int argReg = -1);
+  int GetArgReg() { return argReg; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return param; }
+
+ private:
+  Location *param;
+  int argReg;
+};
+
+class PopParams : public Instruction {
+ public:
+  PopParams(int numBytesOfParamsToRemove);
+  int GetNumBytes() { return numBytes; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+
+ private:
+  int numBytes;
+};
+
+class LCall : public Instruction {
+ public:
+  LCall(const char *labe, Location *result);
+  const char *GetLabel() { return label; }
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+
+ private:
+  const char *label;
+  Location *dst;
+};
+
+class ACall: public Instruction {
+ public:
+  ACall(Location *meth, Location *result);
+  void EmitSpecific(TargetEmitter *target);
+  Instruction *Clone(Renaming *r);
+  Location *GetDst() { return dst; }
+  int NumSrcs() { return 1; }
+  Location *GetSrc(int i) { return methodAddr; }
+
+ private:
+  Location *dst;
+  Location *methodAddr;
+};
+
+class VTable: public Instruction {
+ public:
+  VTable(const char *labelForTable, List<const char *> *methodLabels);
+  void Print();
+  void EmitSpecific(TargetEmitter *target);
+
+ private:
+  List<const char *> *methodLabels;
+  const char *label;
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif
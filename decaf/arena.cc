@@ -0,0 +1,71 @@
+/* File: arena.cc
+ * --------------
+ * Implementation of the bump-pointer Arena.
+ */
+
+#include <stdlib.h>
+
+#include "decaf/arena.h"
+#include "decaf/utility.h"
+
+Arena::Arena() {
+  blocks = NULL;
+  cur = end = NULL;
+  bytesAllocated = 0;
+  numBlocks = 0;
+}
+
+/* Arena::NewBlock
+ * ---------------
+ * Links in a block with at least size bytes of payload and returns
+ * the start of that payload.  The block header is padded so the
+ * payload keeps the arena's alignment.
+ */
+char *Arena::NewBlock(size_t size) {
+  size_t header = (sizeof(Block) + kAlignment - 1) & ~(kAlignment - 1);
+  Block *b = (Block *) malloc(header + size);
+  if (b == NULL) {
+    Failure("Arena::NewBlock(): Malloc out of memory");
+  }
+  b->next = blocks;
+  blocks = b;
+  numBlocks++;
+  return (char *) b + header;
+}
+
+void *Arena::Alloc(size_t size) {
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  bytesAllocated += size;
+
+  if (size > (size_t) (end - cur)) {
+    // Oversized requests get a block of their own so they don't waste
+    // the rest of the current one.
+    if (size > kBlockSize / 4) {
+      return NewBlock(size);
+    }
+    cur = NewBlock(kBlockSize);
+    end = cur + kBlockSize;
+  }
+
+  void *p = cur;
+  cur += size;
+  return p;
+}
+
+void Arena::Release() {
+  while (blocks != NULL) {
+    Block *next = blocks->next;
+    free(blocks);
+    blocks = next;
+  }
+  cur = end = NULL;
+  bytesAllocated = 0;
+  numBlocks = 0;
+}
+
+Arena *CompilationArena() {
+  static Arena *arena = new Arena;
+  return arena;
+}
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,87 @@
+/* File: arena.h                                         -*- C++ -*-
+ * -------------
+ * A bump-pointer arena for the objects that live as long as the
+ * compilation does: AST nodes, symbols and scopes, and the TAC
+ * Locations and Instructions built from them.  None of these is ever
+ * freed on its own, so rather than paying malloc for each one they are
+ * carved out of large blocks and the whole arena is dropped at once
+ * when compilation is over.  Objects allocated together also end up
+ * next to each other, which helps the tree walks in Check and Emit.
+ *
+ * Classes opt in by deriving from ArenaObject, after which a plain
+ * "new Foo(...)" is served from the compilation arena.  Anything else
+ * (e.g. a yyltype) can be placed there explicitly:
+ *
+ *       yyltype *loc = new (CompilationArena()) yyltype(l);
+ *
+ * Destructors are not run when the arena is released, so arena objects
+ * must not own resources that need one.
+ */
+
+#ifndef DCC_ARENA_H__
+#define DCC_ARENA_H__
+
+#include <stddef.h>
+
+class Arena {
+ public:
+  Arena();
+  ~Arena() { Release(); }
+
+  // Returns size bytes of uninitialized, suitably aligned memory.
+  void *Alloc(size_t size);
+
+  // Frees every block at once; all pointers into the arena die here.
+  void Release();
+
+  // Totals for the debug report.
+  size_t BytesAllocated() const { return bytesAllocated; }
+  int NumBlocks() const { return numBlocks; }
+
+ private:
+  struct Block {
+    Block *next;
+  };
+
+  static const size_t kAlignment = 8;
+  static const size_t kBlockSize = 64 * 1024;
+
+  Block *blocks;
+  char *cur, *end;    // free space left in the current block
+  size_t bytesAllocated;
+  int numBlocks;
+
+  char *NewBlock(size_t size);
+
+  Arena(const Arena&);
+  Arena& operator=(const Arena&);
+};
+
+// The arena for the current compilation unit.  Created on first use,
+// since static initializers (the built-in Types) already allocate.
+Arena *CompilationArena();
+
+inline void *operator new(size_t size, Arena *arena) {
+  return arena->Alloc(size);
+}
+
+// Nothing to undo; only called if a constructor throws.
+inline void operator delete(void *, Arena *) {}
+
+// Base class for objects allocated from the compilation arena.
+class ArenaObject {
+ public:
+  static void *operator new(size_t size) {
+    return CompilationArena()->Alloc(size);
+  }
+  static void *operator new(size_t size, Arena *arena) {
+    return arena->Alloc(size);
+  }
+
+  // Arena memory is reclaimed in bulk, never one object at a time.
+  static void operator delete(void *) {}
+  static void operator delete(void *, Arena *) {}
+};
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* DCC_ARENA_H__ */
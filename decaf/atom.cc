@@ -0,0 +1,110 @@
+/* File: atom.cc
+ * -------------
+ * The string interning table behind atom.h.  This is the one place in
+ * the compiler where a name is hashed by its characters: an open
+ * addressing table keyed on the string contents, whose entries point
+ * into large character blocks so interning does not allocate per
+ * string.
+ *
+ * The table is built from zero-initialized statics and set up on first
+ * use, because static initializers elsewhere (the built-in Types)
+ * intern names before main runs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "decaf/atom.h"
+
+namespace {
+
+struct AtomSlot {
+  unsigned int hash;
+  const char *str;    // NULL while the slot is empty
+};
+
+const int kInitialCapacity = 1024;
+const int kBlockSize = 16 * 1024;
+
+AtomSlot *slots;
+int capacity;
+int count;
+
+char *block;          // current character block
+int blockLeft;
+
+unsigned int Hash(const char *str, int len) {
+  unsigned int h = 2166136261u;   // 32-bit FNV-1a
+  for (int i = 0; i < len; i++) {
+    h ^= (unsigned char) str[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+const char *Store(const char *str, int len) {
+  if (len + 1 > blockLeft) {
+    int size = len + 1 > kBlockSize ? len + 1 : kBlockSize;
+    block = (char *) malloc(size);
+    blockLeft = size;
+  }
+  char *copy = block;
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  block += len + 1;
+  blockLeft -= len + 1;
+  return copy;
+}
+
+void Grow() {
+  AtomSlot *old = slots;
+  int oldCapacity = capacity;
+
+  capacity = capacity ? capacity * 2 : kInitialCapacity;
+  slots = (AtomSlot *) calloc(capacity, sizeof(AtomSlot));
+
+  unsigned int mask = capacity - 1;
+  for (int i = 0; i < oldCapacity; i++) {
+    if (old[i].str == NULL) {
+      continue;
+    }
+    unsigned int j = old[i].hash & mask;
+    while (slots[j].str != NULL) {
+      j = (j + 1) & mask;
+    }
+    slots[j] = old[i];
+  }
+  free(old);
+}
+
+} // namespace
+
+Atom Intern(const char *str) {
+  return Intern(str, strlen(str));
+}
+
+Atom Intern(const char *str, int len) {
+  if ((count + 1) * 2 > capacity) {
+    Grow();
+  }
+
+  unsigned int hash = Hash(str, len);
+  unsigned int mask = capacity - 1;
+  unsigned int i = hash & mask;
+  for ( ; slots[i].str != NULL; i = (i + 1) & mask) {
+    if (slots[i].hash == hash && strncmp(slots[i].str, str, len) == 0 &&
+        slots[i].str[len] == '\0') {
+      return slots[i].str;
+    }
+  }
+
+  slots[i].hash = hash;
+  slots[i].str = Store(str, len);
+  count++;
+  return slots[i].str;
+}
+
+const Atom kAtomThis = Intern("this");
+const Atom kAtomLength = Intern("length");
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
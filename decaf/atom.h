@@ -0,0 +1,32 @@
+/* File: atom.h
+ * ------------
+ * Interned strings, or "atoms".  Intern returns the single canonical
+ * copy of a string, so two atoms name the same string exactly when
+ * they are the same pointer.
+ *
+ * The lexer interns every identifier once, and from then on names
+ * travel through the AST, the symbol tables and the Hashtable as
+ * atoms: they are compared with == and hashed by address, never
+ * copied or strcmp'd.  Anything handed to a Hashtable or SymTable as
+ * a key must be an atom.
+ *
+ * Atoms live until the compiler exits; they are never freed.
+ */
+
+#ifndef DCC_ATOM_H__
+#define DCC_ATOM_H__
+
+typedef const char *Atom;
+
+// Returns the atom for the NUL-terminated string str.
+Atom Intern(const char *str);
+
+// Returns the atom for the first len characters of str.
+Atom Intern(const char *str, int len);
+
+// Atoms for the few names the compiler looks up on its own.
+extern const Atom kAtomThis;
+extern const Atom kAtomLength;
+
+/* vim: set ai ts=2 sts=2 sw=2 et: */
+#endif /* DCC_ATOM_H__ */
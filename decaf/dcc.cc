@@ -8,11 +8,16 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "decaf/arena.h"
 #include "decaf/utility.h"
 #include "decaf/errors.h"
 #include "decaf/dcc.h"
 
 int kTestFlag = 0;
+int kCallFlag = CALL_STACK;
+int kTargetFlag = TARGET_MIPS;
+int kPeepholeWindow = 16;
+int kGCFlag = 0;
 FILE* kOutputFile = NULL;
 
 /// @function main
@@ -29,6 +34,12 @@ int main(int argc, char *argv[]) {
   InitLexer();
   InitParser();
   yyparse();
+
+  // Everything the compiler built (tree, scopes, TAC) is done with.
+  Arena *arena = CompilationArena();
+  PrintDebug("arena", "%lu bytes in %d blocks",
+             (unsigned long) arena->BytesAllocated(), arena->NumBlocks());
+  arena->Release();
   return (ReportError::NumErrors() == 0 ? 0 : -1);
 }
 
@@ -119,6 +119,8 @@ static const char* const kErrorArrOutOfBounds =
     "Decaf runtime error: Array subscript out of bounds\\n";
 static const char* const kErrorArrBadSize =
     "Decaf runtime error: Array size is <= 0\\n";
+static const char* const kErrorNullObject =
+    "Decaf runtime error: Method called on a null object\\n";
 
 /* vim: set ai ts=2 sts=2 sw=2 et: */
 #endif /* DCC_ERRORS_H__ */
@@ -1,12 +1,21 @@
 /* File: hashtable.h                                     -*- C++ -*-
  * -----------------
  * This is a simple table for storing values associated with a string
- * key, supporting simple operations for Enter and Lookup.  It is not
- * much more than a thin cover over the STL associative map container,
- * but hides the awkward C++ template syntax and provides a more
- * familiar interface.
+ * key, supporting simple operations for Enter and Lookup.  Every
+ * scope in the compiler owns one of these, so it sits right on the
+ * hot path of both semantic analysis and code generation.
  *
- * The keys are always strings, but the values can be of any type
+ * Keys are atoms (see decaf/atom.h): interned strings that are equal
+ * exactly when their pointers are equal.  The table never copies or
+ * compares key characters; it hashes and compares the pointers.
+ *
+ * The table uses open addressing with linear probing over a
+ * power-of-two array of slots.  Each slot caches the hash of its key
+ * and a chain of the values entered under it, most recent first,
+ * which is how shadowing is kept cheap: Lookup simply returns the
+ * head of the chain.
+ *
+ * The keys are always atoms, but the values can be of any type
  * (ok, that's actually kind of a fib, it expects the type to be
  * some sort of pointer to conform to using NULL for "not found").
  * The typename for a Hashtable includes the value type in angle
@@ -16,9 +25,14 @@
  * The same notation is used on the matching iterator for the table,
  * i.e. a Hashtable<char*> supports an Iterator<char*>.
  *
+ * A table given an arena takes its slots and entries from there, so
+ * it can itself live in the arena: nothing is freed until the arena
+ * is released, and its destructor need never run.
+ *
  * An iterator is provided for iterating over the entries in a table.
  * The iterator walks through the values, one by one, in alphabetical
- * order by the key. Sample iteration usage:
+ * order by the key (values sharing a key come out in the order they
+ * were entered). Sample iteration usage:
  *
  *       void PrintNames(Hashtable<Decl*> *table)
  *       {
@@ -33,14 +47,12 @@
 #ifndef _H_hashtable
 #define _H_hashtable
 
-#include <map>
+#include <algorithm>
+#include <vector>
 #include <string.h>
 
-struct ltstr {
-  bool operator()(const char* s1, const char* s2) const {
-    return strcmp(s1, s2) < 0;
-  }
-};
+#include "decaf/arena.h"
+#include "decaf/atom.h"
 
 template <class Value>
 class Iterator;
@@ -48,11 +60,55 @@ class Iterator;
 template<class Value>
 class Hashtable {
  private:
-  std::multimap<const char*, Value, ltstr> mmap;
+  // One value entered under a key.  Entries for the same key are
+  // chained from newest to oldest so Lookup never has to search.
+  struct Entry {
+    Value value;
+    Atom key;
+    int seq;            // order of insertion, keeps iteration stable
+    Entry *shadowed;    // next older entry under the same key
+  };
+
+  struct Slot {
+    Atom key;           // NULL when the slot is empty or deleted
+    unsigned int hash;
+    bool deleted;       // tombstone, keeps probe sequences intact
+    Entry *chain;
+  };
+
+  struct EntryLess {
+    bool operator()(const Entry *a, const Entry *b) const {
+      int cmp = strcmp(a->key, b->key);
+      return cmp < 0 || (cmp == 0 && a->seq < b->seq);
+    }
+  };
+
+  static const int kInitialCapacity = 8;
+
+  Arena *arena;         // where storage comes from, NULL for the heap
+  Slot *slots;
+  int capacity;         // always a power of two (or 0 before first Enter)
+  int numKeys;          // slots holding a live key
+  int numDeleted;       // tombstones
+  int numEntries;       // values, counting shadowed ones
+  int nextSeq;
+
+  static unsigned int Hash(Atom key);
+  Slot *FindSlot(Atom key, unsigned int hash) const;
+  void Grow();
+  Entry *NewEntry();
+  void FreeEntry(Entry *e);
+
+  // The table owns its entries, so it is never copied.
+  Hashtable(const Hashtable&);
+  Hashtable& operator=(const Hashtable&);
 
  public:
-  // ctor creates a new empty hashtable
-  Hashtable() {}
+  // ctor creates a new empty hashtable, drawing on arena if given
+  Hashtable(Arena *a = NULL)
+      : arena(a), slots(NULL), capacity(0), numKeys(0), numDeleted(0),
+        numEntries(0), nextSeq(0) {}
+  ~Hashtable();
 
   // Returns number of entries currently in table
   int NumEntries() const;
@@ -63,37 +119,37 @@ class Hashtable {
   // from the table entirely) or just shadows it (keeps previous
   // and adds additional entry). The lastmost entered one for an
   // key will be the one returned by Lookup.
-  void Enter(const char *key, Value value,
+  void Enter(Atom key, Value value,
              bool overwriteInsteadOfShadow = true);
 
   // Removes a given key->value pair.  Any other values
   // for that key are not affected. If this is the last
   // remaining value for that key, the key is removed
   // entirely.
-  void Remove(const char *key, Value value);
+  void Remove(Atom key, Value value);
 
   // Returns value stored under key or NULL if no match.
   // If more than one value for key (ie shadow feature was
   // used during Enter), returns the lastmost entered one.
-  Value Lookup(const char *key);
+  Value Lookup(Atom key);
 
   // Returns an Iterator object (see below) that can be used to
   // visit each value in the table in alphabetical order.
   Iterator<Value> GetIterator();
 };
 
-/* Don't worry too much about how the Iterator is implemented, see
- * sample usage above for how to iterate over a hashtable using an
- * iterator.
+/* The iterator works on a sorted snapshot of the table taken when it
+ * is created, so the table itself never has to keep its keys in
+ * order.  See sample usage above for how to iterate over a hashtable
+ * using an iterator.
  */
 template <class Value>
 class Iterator {
   friend class Hashtable<Value>;
  private:
-  typename std::multimap<const char*, Value , ltstr>::iterator cur, end;
-  Iterator(std::multimap<const char*, Value, ltstr>& t)
-    : cur(t.begin()), end(t.end()) {
-  }
+  std::vector<Value> values;
+  size_t cur;
+  Iterator() : cur(0) {}
 
  public:
   // Returns current value and advances iterator to next.
@@ -102,19 +158,166 @@ class Iterator {
   Value GetNextValue();
 };
 
+/* Hashtable::~Hashtable
+ * ---------------------
+ * Releases every entry still in the table, unless the arena owns
+ * them.
+ */
+template <class Value>
+Hashtable<Value>::~Hashtable() {
+  if (arena != NULL) {
+    return;
+  }
+  for (int i = 0; i < capacity; i++) {
+    Entry *e = slots[i].chain;
+    while (e != NULL) {
+      Entry *next = e->shadowed;
+      delete e;
+      e = next;
+    }
+  }
+  delete[] slots;
+}
+
+/* Hashtable::NewEntry, Hashtable::FreeEntry
+ * -----------------------------------------
+ * Entries come from the arena when the table has one; it takes them
+ * back all at once, so freeing one is then a no-op.
+ */
+template <class Value>
+typename Hashtable<Value>::Entry *Hashtable<Value>::NewEntry() {
+  return arena != NULL ? new (arena) Entry : new Entry;
+}
+
+template <class Value>
+void Hashtable<Value>::FreeEntry(Entry *e) {
+  if (arena == NULL) {
+    delete e;
+  }
+}
+
+/* Hashtable::Hash
+ * ---------------
+ * Hashes the atom's address. Atoms are packed back to back, so
+ * neighbours differ only in their low bits; mix before masking.
+ */
+template <class Value>
+unsigned int Hashtable<Value>::Hash(Atom key) {
+  unsigned int h = (unsigned int) (size_t) key;
+  h ^= h >> 16;
+  h *= 0x45d9f3bu;
+  h ^= h >> 16;
+  return h;
+}
+
+/* Hashtable::FindSlot
+ * -------------------
+ * Probes for key. Returns its slot if present, otherwise the slot
+ * where it should be inserted (the first tombstone seen, or the empty
+ * slot that ended the probe). Returns NULL if the table has no slots.
+ */
+template <class Value>
+typename Hashtable<Value>::Slot *
+Hashtable<Value>::FindSlot(Atom key, unsigned int hash) const {
+  if (capacity == 0) {
+    return NULL;
+  }
+
+  unsigned int mask = capacity - 1;
+  Slot *reuse = NULL;
+  for (unsigned int i = hash & mask; ; i = (i + 1) & mask) {
+    Slot *s = &slots[i];
+    if (s->key == NULL) {
+      if (!s->deleted) {
+        return reuse ? reuse : s;
+      }
+      if (reuse == NULL) {
+        reuse = s;
+      }
+    } else if (s->key == key) {
+      return s;
+    }
+  }
+}
+
+/* Hashtable::Grow
+ * ---------------
+ * Rehashes into a fresh slot array, dropping tombstones. The array
+ * only doubles when live keys (not tombstones) are what filled it.
+ */
+template <class Value>
+void Hashtable<Value>::Grow() {
+  Slot *old = slots;
+  int oldCapacity = capacity;
+
+  if (capacity == 0) {
+    capacity = kInitialCapacity;
+  } else if (numKeys * 2 >= capacity) {
+    capacity *= 2;
+  }
+
+  if (arena != NULL) {
+    slots = static_cast<Slot*>(arena->Alloc(capacity * sizeof(Slot)));
+  } else {
+    slots = new Slot[capacity];
+  }
+  memset(slots, 0, capacity * sizeof(Slot));
+  numDeleted = 0;
+
+  unsigned int mask = capacity - 1;
+  for (int i = 0; i < oldCapacity; i++) {
+    if (old[i].key == NULL) {
+      continue;
+    }
+    unsigned int j = old[i].hash & mask;
+    while (slots[j].key != NULL) {
+      j = (j + 1) & mask;
+    }
+    slots[j] = old[i];
+  }
+  if (arena == NULL) {
+    delete[] old;
+  }
+}
+
 /* Hashtable::Enter
  * ----------------
  * Stores new value for given identifier. If the key already
  * has an entry and flag is to overwrite, will remove previous entry first,
- * otherwise it just adds another entry under same key. Copies the
- * key, so you don't have to worry about its allocation.
+ * otherwise it just adds another entry under same key. The key is
+ * an atom and is stored as is, never copied.
  */
 template <class Value>
-void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite) {
+void Hashtable<Value>::Enter(Atom key, Value val, bool overwrite) {
   Value prev;
   if (overwrite && (prev = Lookup(key)))
     Remove(key, prev);
-  mmap.insert(std::make_pair(strdup(key), val));
+
+  // Keep the load (tombstones included) under two thirds.
+  if ((numKeys + numDeleted + 1) * 3 > capacity * 2) {
+    Grow();
+  }
+
+  unsigned int hash = Hash(key);
+  Slot *s = FindSlot(key, hash);
+  if (s->key == NULL) {
+    if (s->deleted) {
+      numDeleted--;
+    }
+    s->key = key;
+    s->hash = hash;
+    s->deleted = false;
+    s->chain = NULL;
+    numKeys++;
+  }
+
+  Entry *e = NewEntry();
+  e->value = val;
+  e->key = s->key;
+  e->seq = nextSeq++;
+  e->shadowed = s->chain;
+  s->chain = e;
+  numEntries++;
 }
 
 /* Hashtable::Remove
@@ -123,19 +326,34 @@ void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite) {
  * changes are made.  Does not affect any other entries under that key.
  */
 template <class Value>
-void Hashtable<Value>::Remove(const char *key, Value val) {
-  if (mmap.count(key) == 0) { // no matches at all
+void Hashtable<Value>::Remove(Atom key, Value val) {
+  Slot *s = FindSlot(key, Hash(key));
+  if (s == NULL || s->key == NULL) { // no matches at all
     return;
   }
 
-  typename std::multimap<const char *, Value>::iterator itr;
-  itr = mmap.find(key); // start at first occurrence
-  while (itr != mmap.upper_bound(key)) {
-    if (itr->second == val) { // iterate to find matching pair
-      mmap.erase(itr);
-      break;
+  // Of several identical pairs the oldest goes first, so walk the
+  // whole chain remembering the last match.
+  Entry **link = NULL;
+  for (Entry **l = &s->chain; *l != NULL; l = &(*l)->shadowed) {
+    if ((*l)->value == val) {
+      link = l;
     }
-    ++itr;
+  }
+  if (link == NULL) {
+    return;
+  }
+
+  Entry *victim = *link;
+  *link = victim->shadowed;
+  FreeEntry(victim);
+  numEntries--;
+
+  if (s->chain == NULL) { // last value for this key
+    s->key = NULL;
+    s->deleted = true;
+    numKeys--;
+    numDeleted++;
   }
 }
 
@@ -145,21 +363,12 @@ void Hashtable<Value>::Remove(const char *key, Value val) {
  *if there is no matching entry
  */
 template <class Value>
-Value Hashtable<Value>::Lookup(const char *key) {
-  Value found = NULL;
-  if (mmap.count(key) > 0) {
-    typename std::multimap<const char *, Value>::iterator cur, last, prev;
-    cur = mmap.find(key); // start at first occurrence
-    last = mmap.upper_bound(key);
-    while (cur != last) { // iterate to find last entered
-      prev = cur;
-      if (++cur == mmap.upper_bound(key)) { // have to go one too far
-        found = prev->second; // one before last was it
-        break;
-      }
-    }
+Value Hashtable<Value>::Lookup(Atom key) {
+  Slot *s = FindSlot(key, Hash(key));
+  if (s == NULL || s->key == NULL) {
+    return NULL;
   }
-  return found;
+  return s->chain->value;
 }
 
 /* Hashtable::NumEntries
@@ -167,16 +376,32 @@ Value Hashtable<Value>::Lookup(const char *key) {
  */
 template <class Value>
 int Hashtable<Value>::NumEntries() const {
-  return mmap.size();
+  return numEntries;
 }
 
 /* Hashtable:GetIterator
  * ---------------------
  * Returns iterator which can be used to walk through all values in table.
+ * Sorting happens here rather than on every Enter; iteration is rare
+ * (error reporting and debug dumps) compared to lookups.
  */
 template <class Value>
 Iterator<Value> Hashtable<Value>::GetIterator() {
-  return Iterator<Value>(mmap);
+  std::vector<Entry*> entries;
+  entries.reserve(numEntries);
+  for (int i = 0; i < capacity; i++) {
+    for (Entry *e = slots[i].chain; e != NULL; e = e->shadowed) {
+      entries.push_back(e);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), EntryLess());
+
+  Iterator<Value> iter;
+  iter.values.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    iter.values.push_back(entries[i]->value);
+  }
+  return iter;
 }
 
 /* Iterator::GetNextValue
@@ -186,7 +411,7 @@ Iterator<Value> Hashtable<Value>::GetIterator() {
  */
 template <class Value>
 Value Iterator<Value>::GetNextValue() {
-  return (cur == end ? NULL : (*cur++).second);
+  return (cur == values.size() ? NULL : values[cur++]);
 }
 
 /* vim: set ai ts=2 sts=2 sw=2 et: */
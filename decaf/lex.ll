@@ -3,6 +3,7 @@
 #include <cstring>
 #include <vector>
 
+#include "decaf/atom.h"
 #include "decaf/lexer.h"
 #include "decaf/utility.h"
 #include "decaf/errors.h"
@@ -285,14 +286,11 @@ SINGLE_COMMENT  ("//"[^\n]*)
 }
 
 {IDENTIFIER} {
-  int len = strlen(yytext);
-  if (len > MaxIdentLen) {
+  if (yyleng > MaxIdentLen) {
     ReportError::LongIdentifier(&yylloc, yytext);
-    strncpy(yylval.identifier, yytext, MaxIdentLen);
-    yylval.identifier[MaxIdentLen] = '\0';
+    yylval.identifier = Intern(yytext, MaxIdentLen);
   } else {
-    strncpy(yylval.identifier, yytext, len);
-    yylval.identifier[len] = '\0';
+    yylval.identifier = Intern(yytext, yyleng);
   }
   return T_Identifier;
 }
@@ -17,6 +17,7 @@
  * by your code here.
  */
 
+#include "decaf/atom.h"
 #include "decaf/errors.h"
 #include "decaf/lexer.h"
 #include "decaf/dcc.h"
@@ -45,7 +46,7 @@ void yyerror(const char *msg);
   bool             boolConstant;
   char             *stringConstant;
   double           doubleConstant;
-  char             identifier[MaxIdentLen+1];
+  Atom             identifier;
   Decl             *decl;
   List<Decl*>      *declList;
   VarDecl          *varDecl;
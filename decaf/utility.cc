@@ -67,16 +67,48 @@ void PrintDebug(const char *key, const char *format, ...) {
   printf("+++ (%s): %s%s", key, buf, buf[strlen(buf)-1] != '\n'? "\n" : "");
 }
 
+// Takes -target NAME (or --target NAME) out of argv before getopt
+// sees it, since getopt would read it as -t arget. Returns the new
+// argc.
+static int ParseTarget(int argc, char *argv[]) {
+  int n = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-target") != 0 && strcmp(argv[i], "--target") != 0) {
+      argv[n++] = argv[i];
+      continue;
+    }
+    if (i + 1 == argc) {
+      fprintf(stderr, "Option %s requires an argument\n", argv[i]);
+      fprintf(stderr, "usage\n");
+      exit(1);
+    } else if (strcmp(argv[++i], "mips") == 0) {
+      kTargetFlag = TARGET_MIPS;
+    } else if (strcmp(argv[i], "x86") == 0) {
+      kTargetFlag = TARGET_X86;
+    } else {
+      fprintf(stderr, "Unknown target %s\n", argv[i]);
+      fprintf(stderr, "usage\n");
+      exit(1);
+    }
+  }
+  argv[n] = NULL;
+  return n;
+}
+
 void ParseCommandLine(int argc, char *argv[]) {
   int c;
   kTestFlag = TEST_NONE;
+  kCallFlag = CALL_STACK;
+  kTargetFlag = TARGET_MIPS;
+  kGCFlag = 0;
   char* test_type = NULL;
-  char* debug_level = NULL;
   char* output_file = NULL;
-  while ((c = getopt(argc, argv, "o:d:t:")) != -1) {
+  argc = ParseTarget(argc, argv);
+  while ((c = getopt(argc, argv, "o:d:t:c:p:g")) != -1) {
     switch (c) {
      case 'd':
-      debug_level = strdup(optarg);
+      // Keys are kept for the whole run, and -d may be repeated.
+      SetDebugForKey(strdup(optarg), true);
       break;
      case 't':
       test_type = strdup(optarg);
@@ -84,8 +116,33 @@ void ParseCommandLine(int argc, char *argv[]) {
      case 'o':
       output_file = strdup(optarg);
       break;
+     case 'c':
+      if (strcmp(optarg, "register") == 0) {
+        kCallFlag = CALL_REGISTER;
+      } else if (strcmp(optarg, "stack") == 0) {
+        kCallFlag = CALL_STACK;
+      } else {
+        fprintf(stderr, "Unknown calling convention %s\n", optarg);
+        fprintf(stderr, "usage\n");
+        exit(1);
+      }
+      break;
+     case 'p': {
+      char *end;
+      long n = strtol(optarg, &end, 10);
+      if (*optarg == '\0' || *end != '\0' || n < 0 || n > INT32_MAX) {
+        fprintf(stderr, "Bad peephole window %s\n", optarg);
+        fprintf(stderr, "usage\n");
+        exit(1);
+      }
+      kPeepholeWindow = (int) n;
+      break;
+     }
+     case 'g':
+      kGCFlag = 1;
+      break;
      case '?':
-      if (optopt == 'c') {
+      if (optopt == 'c' || optopt == 'p') {
         fprintf(stderr, "Option -%c requires an argument\n", optopt);
       } else if (optopt == 't') {
         fprintf(stderr, "Option -%c requires an argument\n", optopt);
@@ -97,6 +154,16 @@ void ParseCommandLine(int argc, char *argv[]) {
     }
   }
 
+  // The x86 backend has no argument registers and always builds a
+  // full frame, and its runtime has no garbage collector.
+  if (kTargetFlag == TARGET_X86) {
+    kCallFlag = CALL_STACK;
+    if (kGCFlag) {
+      fprintf(stderr, "Option -g is only supported for the MIPS target\n");
+      kGCFlag = 0;
+    }
+  }
+
   if (optind != argc - 1) {
     fprintf(stderr, "usage\n");
     exit(1);
@@ -107,10 +174,6 @@ void ParseCommandLine(int argc, char *argv[]) {
     exit(1);
   }
 
-  if (debug_level != NULL) {
-    SetDebugForKey(optarg, true);
-    free(debug_level);
-  }
   if (test_type != NULL) {
     if (strcmp(test_type, "lexer") == 0) {
       kTestFlag = TEST_LEXER;
@@ -17,7 +17,26 @@ enum {
   TEST_NONE,
 };
 
+// Calling conventions for Decaf functions, chosen with -c (stack
+// unless -c register is given)
+enum {
+  CALL_REGISTER = 1,  // first arguments in registers, leaf frames elided
+  CALL_STACK,         // every argument on the stack, full frames
+};
+
+// Instruction sets dcc generates code for, chosen with -target
+enum {
+  TARGET_MIPS = 1,    // SPIM, with etc/exceptions.s
+  TARGET_X86,         // Linux i386, linked with arch/x86/libdecaf.s
+};
+
 extern int kTestFlag;
+extern int kCallFlag;
+extern int kTargetFlag;
+// Lines the MIPS peephole optimizer looks over, set with -p (0 is off)
+extern int kPeepholeWindow;
+// Turns on the runtime's garbage collector, set with -g
+extern int kGCFlag;
 extern FILE* kOutputFile;
 
 #define __DEBUG_TAC 1
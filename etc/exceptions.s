@@ -65,6 +65,7 @@ __excp:	.word __e0_, __e1_, __e2_, __e3_, __e4_, __e5_, __e6_, __e7_, __e8_, __e
 	.word __e28_, __e29_, __e30_, __e31_
 s1:	.word 0
 s2:	.word 0
+s3:	.word 0
 
 # This is the exception handler code that the processor runs when
 # an exception occurs. It only prints some information about the
@@ -83,6 +84,19 @@ s2:	.word 0
 	.set at
 	sw $v0 s1		# Not re-entrant and we can't trust $sp
 	sw $a0 s2		# But we need to use these registers
+	sw $a1 s3
+
+	# Write out what the program printed before the exception.
+	#
+	lw $a1 _outLen
+	beqz $a1 flushed
+	la $a0 _outBuf
+	addu $a1 $a0 $a1
+	sb $0 ($a1)
+	li $v0 4		# syscall 4 (print_str)
+	syscall
+	sw $0 _outLen
+flushed:
 
 	mfc0 $k0 $13		# Cause register
 	srl $a0 $k0 2		# Extract ExcCode Field
@@ -144,6 +158,7 @@ ret:
 #
 	lw $v0 s1		# Restore other registers
 	lw $a0 s2
+	lw $a1 s3
 
 	.set noat
 	move $at $k1		# Restore $at
@@ -177,11 +192,11 @@ __start:
 	addiu $a2 $a1 4		# envp
 	sll $v0 $a0 2
 	addu $a2 $a2 $v0
+	sw $sp _gcStackTop	# the collector scans the stack up to here
 	jal main
 	nop
 
-	li $v0 10
-	syscall			# syscall 10 (exit)
+	j _Halt			# exit, after any collector statistics
 
 
 	#  From here down is the standard library which is linked into all
@@ -196,99 +211,1079 @@ __start:
 	#  Library function ptr = Alloc(int size)
 	#  -----------------------------------------
 	#  Used for New and NewArray.
-	#  Allocates space in heap and returns address in $v0
+	#  Allocates space in heap and returns address in $v0, zeroed.
+	#  The heap is a run of 4096-byte pages. Requests up to 1024 bytes
+	#  are rounded up to a size class: every word up to 128 bytes,
+	#  then 256, 512 and 1024. Each class bumps through a page of its
+	#  own, whose tail holds a mark bit per slot for the collector,
+	#  and reuses the slots the collector swept free once that runs
+	#  out. Larger requests get whole pages. Pages come from sbrk, 64K
+	#  beyond the request at a time.
 	.globl _Alloc
 _Alloc:
-	  
         lw $a0, 4($sp)        # get number of bytes
-        li $v0, 9             # 9 is code for srbk sys call
-        syscall
-        beqz $v0, _AFail
+        addiu $a0, $a0, 3     # round up to a whole word
+        li $a1, -4
+        and $a0, $a0, $a1
+        bnez $a0, _ASized
+        li $a0, 4             # empty requests still get a slot of their own
+  _ASized:
+        la $a1, _AllocClasses
+        li $a2, 128
+        bgtu $a0, $a2, _AMid
+        sll $a2, $a0, 2       # class size/4, and entries are 16 bytes
+        addu $a1, $a1, $a2
+  _ABump:
+        lw $v0, 0($a1)        # next free slot of the class
+        addu $a2, $v0, $a0
+        lw $a3, 4($a1)        # end of its page
+        bgtu $a2, $a3, _AFree
+        sw $a2, 0($a1)
+        jr $ra
+  _AMid:
+        li $a2, 1024
+        bgtu $a0, $a2, _ALarge
+        addiu $a1, $a1, 528   # class 33 is the 256 byte one
+        li $a2, 256
+  _AMidNext:
+        bleu $a0, $a2, _AMidFound
+        addiu $a1, $a1, 16
+        sll $a2, $a2, 1
+        b _AMidNext
+  _AMidFound:
+        move $a0, $a2         # the slot is the whole class size
+        b _ABump
+  _AFree:
+        lw $v0, 8($a1)        # a slot swept free, if any
+        beqz $v0, _ASlow
+        lw $a2, 0($v0)        # links are stored plus one, so that the
+        addiu $a2, $a2, -1    # collector never takes them for pointers
+        sw $a2, 8($a1)
+        move $a2, $v0
+  _AClear:
+        sw $zero, 0($a2)
+        addiu $a2, $a2, 4
+        addiu $a0, $a0, -4
+        bnez $a0, _AClear
+        jr $ra
+  _ALarge:
+        li $a1, 0             # no class, whole pages
+	#  Needs new pages: $a0 is the slot size and $a1 its class entry, or
+	#  the request size and 0. Collects first when enabled and the heap
+	#  has grown enough since the last collection, or when out of memory.
+  _ASlow:
+        subu $sp, $sp, 40
+        sw $ra, 36($sp)
+        sw $s0, 4($sp)        # the program's registers are roots, so
+        sw $s1, 8($sp)        # they go on the stack before the
+        sw $s2, 12($sp)       # collector can run
+        sw $s3, 16($sp)
+        sw $s4, 20($sp)
+        sw $s5, 24($sp)
+        sw $s6, 28($sp)
+        sw $s7, 32($sp)
+        move $s0, $a0
+        move $s1, $a1
+        li $s2, 0             # set once collected
+  _ARetry:
+        li $s3, 1             # pages wanted
+        bnez $s1, _AWant
+        addiu $s3, $s0, 4095
+        srl $s3, $s3, 12
+  _AWant:
+        lw $a0, _gcOn
+        beqz $a0, _ATake
+        bnez $s2, _ATake
+        lw $a0, _heapPages
+        lw $a1, _freePages
+        subu $a0, $a0, $a1
+        addu $a0, $a0, $s3
+        lw $a1, _gcNext
+        bleu $a0, $a1, _ATake
+  _ACollect:
+        jal _GCCollect
+        li $s2, 1
+        beqz $s1, _ARetry
+        lw $a0, 8($s1)
+        beqz $a0, _ARetry
+        move $a0, $s0         # take a slot it swept free
+        move $a1, $s1
+        jal _ARestore
+        b _AFree
+  _ATake:
+        move $a0, $s3
+        li $a1, 255           # first page of a large object
+        move $a2, $s0
+        beqz $s1, _ATakeKind
+        la $a1, _AllocClasses
+        subu $a1, $s1, $a1
+        srl $a1, $a1, 4       # or the class of its slots
+        li $a2, 4096
+  _ATakeKind:
+        jal _AGetPages
+        bnez $v0, _AGot
+        lw $a0, _gcOn
+        beqz $a0, _AFail
+        beqz $s2, _ACollect
+        b _AFail
+  _AGot:
+        beqz $s1, _ADone
+        addu $a0, $v0, $s0    # the first slot is taken
+        sw $a0, 0($s1)
+        move $a0, $s0
+        jal _ASlots
+        mul $a1, $a1, $s0
+        addu $a1, $v0, $a1    # the slots end at the mark bits
+        sw $a1, 4($s1)
+  _ADone:
+        jal _ARestore
         jr $ra
+  _ARestore:                  # pops _ASlow's frame into $ra
+        move $a2, $ra
+        lw $ra, 36($sp)
+        lw $s0, 4($sp)
+        lw $s1, 8($sp)
+        lw $s2, 12($sp)
+        lw $s3, 16($sp)
+        lw $s4, 20($sp)
+        lw $s5, 24($sp)
+        lw $s6, 28($sp)
+        lw $s7, 32($sp)
+        addiu $sp, $sp, 40
+        jr $a2
     _AFail:
         .data
         _memErrStr:  .asciiz "Allocate failed: out of memory"
         .text
         la $a0, _memErrStr    # print error message
-        li $v0, 4	
-        syscall
+        jal _OutStr
+        jal _OutFlush
         li $v0, 10            # 10 is code for exit syscall
         syscall
 
+	#  Sets $a1 to the number of slots a page holds for slots of $a0
+	#  bytes, leaving a bit for each.
+  _ASlots:
+        sll $a1, $a0, 3
+        addiu $a1, $a1, 1
+        li $a2, 32768
+        divu $a1, $a2, $a1
+        jr $ra
+
+	#  Returns in $v0 the first of $a0 contiguous pages, or 0 if
+	#  there is no more memory, and sets their kind: $a1 for the
+	#  first and 254 for the rest. Free pages are reused before the
+	#  heap grows, with their first $a2 bytes zeroed. Uses $s4-$s7.
+  _AGetPages:
+        move $s6, $a2
+        lw $s4, _freePages
+        bltu $s4, $a0, _AGPool
+        la $s5, _pageKinds
+        lw $s7, _heapPages
+        li $a2, 0             # next page
+        li $a3, 0             # free pages in a row before it
+  _AGPScan:
+        beq $a2, $s7, _AGPool
+        addu $v0, $s5, $a2
+        lbu $v0, 0($v0)
+        addiu $a2, $a2, 1
+        addiu $a3, $a3, 1
+        beqz $v0, _AGPRun
+        li $a3, 0
+  _AGPRun:
+        bne $a3, $a0, _AGPScan
+        subu $a2, $a2, $a0
+        subu $s4, $s4, $a0
+        sw $s4, _freePages
+        li $s7, 1             # they hold whatever was swept
+        b _AGPMark
+  _AGPool:
+        lw $a2, _heapPages
+        addu $a3, $a2, $a0
+        li $v0, 16384
+        bgtu $a3, $v0, _AGPNone
+        lw $v0, _heapBase
+        beqz $v0, _AGPGrow
+        sll $a3, $a3, 12
+        addu $a3, $a3, $v0
+        lw $v0, _heapEnd
+        bgtu $a3, $v0, _AGPGrow
+        addu $a3, $a2, $a0
+        sw $a3, _heapPages
+        li $s7, 0             # fresh from sbrk, so already zero
+  _AGPMark:
+        la $a3, _pageKinds
+        addu $a3, $a3, $a2
+        sb $a1, 0($a3)
+        li $v0, 254
+  _AGPRest:
+        addiu $a0, $a0, -1
+        beqz $a0, _AGPAddress
+        addiu $a3, $a3, 1
+        sb $v0, 0($a3)
+        b _AGPRest
+  _AGPAddress:
+        lw $v0, _heapBase
+        sll $a2, $a2, 12
+        addu $v0, $v0, $a2
+        beqz $s7, _AGPDone
+        move $a3, $s6
+        move $a2, $v0
+  _AGPClear:
+        sw $zero, 0($a2)
+        addiu $a2, $a2, 4
+        addiu $a3, $a3, -4
+        bnez $a3, _AGPClear
+  _AGPDone:
+        jr $ra
+  _AGPGrow:
+        move $s4, $a0
+        move $s5, $a1
+        sll $a0, $a0, 12
+        lui $a3, 1            # 64K more, which also covers aligning
+        addu $a0, $a0, $a3
+        li $v0, 9             # 9 is code for sbrk syscall
+        syscall
+        beqz $v0, _AGPNone
+        lw $a3, _heapEnd
+        addu $a0, $v0, $a0
+        sw $a0, _heapEnd
+        beq $v0, $a3, _AGPGrown
+        addiu $v0, $v0, 4095  # a new block starts on a page
+        li $a3, -4096
+        and $v0, $v0, $a3
+        lw $a3, _heapBase
+        bnez $a3, _AGPGap
+        lui $a3, 1            # the first page is above the globals,
+        srl $a3, $a3, 1       # which run up from $gp for at most 32K
+        addu $a3, $a3, $gp
+        bgeu $v0, $a3, _AGPBase
+        move $v0, $a3
+  _AGPBase:
+        sw $v0, _heapBase
+        b _AGPGrown
+  _AGPGap:                    # the pages up to it are not the heap's
+        subu $v0, $v0, $a3
+        srl $v0, $v0, 12
+        li $a3, 16384
+        bgtu $v0, $a3, _AGPNone
+        lw $a2, _heapPages
+        la $a3, _pageKinds
+        addu $a3, $a3, $a2
+        li $a1, 252
+  _AGPSkip:
+        beq $a2, $v0, _AGPSkipped
+        sb $a1, 0($a3)
+        addiu $a2, $a2, 1
+        addiu $a3, $a3, 1
+        b _AGPSkip
+  _AGPSkipped:
+        sw $v0, _heapPages
+  _AGPGrown:
+        move $a0, $s4
+        move $a1, $s5
+        b _AGPool
+  _AGPNone:
+        li $v0, 0
+        jr $ra
+
+
+	#  Library function GCInit(int globalBytes, bool report)
+	#  -----------------------------------------------------
+	#  Called first thing in main by programs compiled with -g, it
+	#  turns on the collector and tells it the extent of the globals
+	#  at $gp, and whether Halt reports what it did.
+	.globl _GCInit
+_GCInit:
+        lw $a0, 4($sp)
+        sw $a0, _gcGlobals
+        lw $a0, 8($sp)
+        sw $a0, _gcReport
+        li $a0, 1
+        sw $a0, _gcOn
+        jr $ra
+
+	#  Mark and sweep. The roots are the globals and the whole stack,
+	#  which holds every frame on the $fp chain and, through _ASlow,
+	#  the program's registers. Any word that points into an object
+	#  keeps all of it; the object's words are scanned in turn from a
+	#  stack of [start, end) ranges pushed below $sp. A range found
+	#  in the last word of the one being scanned takes its place, so
+	#  following a list's last pointer does not grow the stack. The
+	#  stack holds at most 256 ranges; an object marked when it is
+	#  full is left unscanned, and once the stack is empty every
+	#  marked object on the pages where that happened is scanned
+	#  again, until none was left out.
+	#  The sweep then
+	#  gives each page with a live slot back to its class as a free
+	#  list, frees pages with none, and frees unmarked large objects.
+  _GCCollect:
+        subu $sp, $sp, 24
+        sw $ra, 20($sp)
+        sw $s0, 4($sp)
+        sw $s1, 8($sp)
+        sw $s2, 12($sp)
+        sw $s3, 16($sp)
+        la $s3, _AllocClasses
+        move $a0, $s3
+        li $a1, 36
+  _GCRetire:                  # every slot comes back from the sweep
+        sw $zero, 0($a0)
+        sw $zero, 4($a0)
+        sw $zero, 8($a0)
+        addiu $a0, $a0, 16
+        addiu $a1, $a1, -1
+        bnez $a1, _GCRetire
+        lw $s0, _heapBase
+        lw $s1, _heapPages
+        sll $s1, $s1, 12
+        addu $s1, $s1, $s0    # end of the heap
+        la $s2, _pageKinds
+        li $s5, 0             # words scanned
+        li $s6, 0             # bytes marked
+        move $s4, $sp         # the ranges are all done back here
+        addiu $a0, $s4, -2064 # room for the roots and 256 more
+        sw $a0, _gcMarkLimit
+        li $a0, -1
+        sw $a0, _gcLeftLo
+        sw $zero, _gcLeftHi
+        lw $a0, _gcStackTop
+        lw $a1, _gcGlobals
+        addu $a1, $gp, $a1
+        subu $sp, $sp, 16
+        sw $s4, 0($sp)
+        sw $a0, 4($sp)
+        sw $gp, 8($sp)
+        sw $a1, 12($sp)
+  _GMNext:
+        beq $sp, $s4, _GMDrained
+        lw $a0, 0($sp)
+        lw $a1, 4($sp)
+        bltu $a0, $a1, _GMWord
+        addiu $sp, $sp, 8
+        b _GMNext
+  _GMWord:
+        addiu $a2, $a0, 4
+        sw $a2, 0($sp)
+        addiu $s5, $s5, 1
+        lw $a0, 0($a0)
+        andi $a1, $a0, 3
+        bnez $a1, _GMNext
+        bltu $a0, $s0, _GMNext
+        bgeu $a0, $s1, _GMNext
+        subu $a1, $a0, $s0
+        srl $a1, $a1, 12
+        addu $a2, $s2, $a1
+        lbu $a3, 0($a2)
+        beqz $a3, _GMNext
+        li $v0, 36
+        bltu $a3, $v0, _GMSlot
+        li $v0, 254
+        bne $a3, $v0, _GMLarge
+  _GMFirst:                   # back to the object's first page
+        addiu $a2, $a2, -1
+        lbu $a3, 0($a2)
+        beq $a3, $v0, _GMFirst
+  _GMLarge:
+        li $v0, 255           # not marked yet, and not a gap
+        bne $a3, $v0, _GMNext
+        li $v0, 253
+        sb $v0, 0($a2)
+        subu $a1, $a2, $s2
+        sll $a1, $a1, 12
+        addu $a1, $a1, $s0
+        move $a0, $a1
+        li $v0, 254
+  _GMPages:
+        addiu $a2, $a2, 1
+        addiu $a0, $a0, 4096
+        lbu $a3, 0($a2)
+        beq $a3, $v0, _GMPages
+        subu $a3, $a0, $a1
+        addu $s6, $s6, $a3
+  _GMBound:                   # the large object at a1 ends at a0
+        subu $a3, $a0, $a1
+        lw $a2, 0($a1)        # an array only reaches as far as its
+        srl $a3, $a3, 2       # length says, and what lies beyond
+        bgeu $a2, $a3, _GMPush  # was not zeroed
+        addiu $a2, $a2, 1
+        sll $a2, $a2, 2
+        addu $a0, $a1, $a2
+        b _GMPush
+  _GMSlot:
+        sll $a3, $a3, 4
+        addu $a3, $a3, $s3
+        lw $a3, 12($a3)       # slot size
+        li $v0, -4096
+        and $a2, $a0, $v0     # page
+        subu $a0, $a0, $a2
+        divu $a0, $a0, $a3    # slot
+        sll $v0, $a3, 3
+        addiu $v0, $v0, 1
+        li $a1, 32768
+        divu $v0, $a1, $v0    # slots in the page
+        bgeu $a0, $v0, _GMNext
+        mul $v0, $v0, $a3
+        addu $v0, $v0, $a2    # mark bits
+        srl $a1, $a0, 3
+        addu $v0, $v0, $a1
+        andi $a1, $a0, 7
+        li $s7, 1
+        sllv $s7, $s7, $a1
+        mul $a0, $a0, $a3
+        addu $a1, $a0, $a2    # object
+        lbu $a2, 0($v0)
+        and $a0, $a2, $s7
+        bnez $a0, _GMNext
+        or $a2, $a2, $s7
+        sb $a2, 0($v0)
+        addu $s6, $s6, $a3
+        addu $a0, $a1, $a3
+  _GMPush:                    # scan [a1, a0) too
+        beq $sp, $s4, _GMGrow
+        lw $a2, 0($sp)
+        lw $a3, 4($sp)
+        bne $a2, $a3, _GMGrow
+        sw $a1, 0($sp)        # the range on top is done: replace it
+        sw $a0, 4($sp)
+        b _GMNext
+  _GMGrow:
+        lw $a2, _gcMarkLimit
+        bleu $sp, $a2, _GMFull
+        subu $sp, $sp, 8
+        sw $a1, 0($sp)
+        sw $a0, 4($sp)
+        b _GMNext
+  _GMFull:                    # note the page a1 was left on
+        subu $a2, $a1, $s0
+        srl $a2, $a2, 12
+        lw $a3, _gcLeftLo
+        bgeu $a2, $a3, _GMFullHi
+        sw $a2, _gcLeftLo
+  _GMFullHi:
+        addiu $a2, $a2, 1
+        lw $a3, _gcLeftHi
+        bleu $a2, $a3, _GMNext
+        sw $a2, _gcLeftHi
+        b _GMNext
+  _GMDrained:                 # in a rescan, go on to the next object
+        lw $a0, _gcWalking
+        bnez $a0, _GWPage
+        lw $a1, _gcLeftHi
+        beqz $a1, _GSweep
+        lw $a0, _gcLeftLo     # rescan the pages objects were left on
+        sw $a0, _gcWalkPage
+        sw $a1, _gcWalkEnd
+        sw $zero, _gcWalkSlot
+        li $a0, -1
+        sw $a0, _gcLeftLo
+        sw $zero, _gcLeftHi
+        li $a0, 1
+        sw $a0, _gcWalking
+  _GWPage:                    # each marked object is scanned alone
+        lw $a0, _gcWalkPage
+        lw $a1, _gcWalkEnd
+        beq $a0, $a1, _GWDone
+        addu $a2, $s2, $a0
+        lbu $a3, 0($a2)
+        beqz $a3, _GWNextPage
+        li $v0, 36
+        bltu $a3, $v0, _GWClass
+        li $v0, 253
+        bne $a3, $v0, _GWNextPage
+        addiu $a3, $a0, 1     # a marked large object
+        sw $a3, _gcWalkPage
+        sll $a1, $a0, 12
+        addu $a1, $a1, $s0
+        move $a0, $a1
+        li $v0, 254
+  _GWPages:
+        addiu $a2, $a2, 1
+        addiu $a0, $a0, 4096
+        lbu $a3, 0($a2)
+        beq $a3, $v0, _GWPages
+        b _GMBound
+  _GWClass:
+        sll $a3, $a3, 4
+        addu $a3, $a3, $s3
+        lw $a3, 12($a3)       # slot size
+        sll $a1, $a0, 12
+        addu $a1, $a1, $s0    # page
+        sll $v0, $a3, 3
+        addiu $v0, $v0, 1
+        li $a0, 32768
+        divu $a0, $a0, $v0    # slots in the page
+        mul $v0, $a0, $a3
+        addu $v0, $v0, $a1    # mark bits, just past the slots
+        lw $a2, _gcWalkSlot
+        mul $a0, $a2, $a3
+        addu $a1, $a1, $a0    # slot to look at
+  _GWSlot:
+        bgeu $a1, $v0, _GWNextPage
+        srl $a0, $a2, 3
+        addu $a0, $a0, $v0
+        lbu $a0, 0($a0)
+        andi $s7, $a2, 7
+        srlv $a0, $a0, $s7
+        andi $a0, $a0, 1
+        addiu $a2, $a2, 1
+        bnez $a0, _GWSlotMarked
+        addu $a1, $a1, $a3
+        b _GWSlot
+  _GWSlotMarked:
+        sw $a2, _gcWalkSlot
+        addu $a0, $a1, $a3
+        b _GMPush
+  _GWNextPage:
+        lw $a0, _gcWalkPage
+        addiu $a0, $a0, 1
+        sw $a0, _gcWalkPage
+        sw $zero, _gcWalkSlot
+        b _GWPage
+  _GWDone:
+        sw $zero, _gcWalking
+        b _GMDrained
+  _GSweep:
+        lw $a0, _gcCount
+        addiu $a0, $a0, 1
+        sw $a0, _gcCount
+        lw $a0, _gcScanned
+        addu $a0, $a0, $s5
+        sw $a0, _gcScanned
+        lw $a0, _gcLongest
+        bgeu $a0, $s5, _GSLongest
+        sw $s5, _gcLongest
+  _GSLongest:
+        sw $s6, _gcLive
+        lw $s1, _heapPages
+        li $s4, 0             # page
+  _GSPage:
+        beq $s4, $s1, _GSDone
+        addu $a2, $s2, $s4
+        lbu $a3, 0($a2)
+        sll $a0, $s4, 12
+        addu $a0, $a0, $s0
+        addiu $s4, $s4, 1
+        beqz $a3, _GSPage
+        li $v0, 36
+        bltu $a3, $v0, _GSSlots
+        li $v0, 253
+        bne $a3, $v0, _GSUnmarked
+        li $v0, 255
+        sb $v0, 0($a2)
+        b _GSPage
+  _GSUnmarked:
+        li $v0, 255
+        bne $a3, $v0, _GSPage
+  _GSFree:                    # an unreached large object
+        sb $zero, 0($a2)
+        lw $a0, _freePages
+        addiu $a0, $a0, 1
+        sw $a0, _freePages
+        beq $s4, $s1, _GSDone
+        addu $a2, $s2, $s4
+        lbu $a3, 0($a2)
+        li $v0, 254
+        bne $a3, $v0, _GSPage
+        addiu $s4, $s4, 1
+        b _GSFree
+  _GSSlots:
+        sll $a3, $a3, 4
+        addu $a3, $a3, $s3    # class
+        lw $a1, 12($a3)       # slot size
+        sll $v0, $a1, 3
+        addiu $v0, $v0, 1
+        li $s5, 32768
+        divu $s5, $s5, $v0    # slots in the page
+        mul $s6, $s5, $a1
+        addu $s6, $s6, $a0    # mark bits
+        addiu $v0, $s5, 7
+        srl $v0, $v0, 3
+        move $s7, $s6
+  _GSAny:
+        lbu $a2, 0($s7)
+        bnez $a2, _GSKeep
+        addiu $s7, $s7, 1
+        addiu $v0, $v0, -1
+        bnez $v0, _GSAny
+        addu $a2, $s2, $s4    # nothing live: free the page
+        sb $zero, -1($a2)
+        lw $a0, _freePages
+        addiu $a0, $a0, 1
+        sw $a0, _freePages
+        b _GSPage
+  _GSKeep:
+        li $v0, 0
+  _GSSlot:
+        srl $a2, $v0, 3
+        addu $a2, $a2, $s6
+        lbu $a2, 0($a2)
+        andi $s7, $v0, 7
+        srlv $a2, $a2, $s7
+        andi $a2, $a2, 1
+        bnez $a2, _GSLive
+        lw $a2, 8($a3)        # onto the free list
+        addiu $a2, $a2, 1
+        sw $a2, 0($a0)
+        sw $a0, 8($a3)
+  _GSLive:
+        addu $a0, $a0, $a1
+        addiu $v0, $v0, 1
+        bne $v0, $s5, _GSSlot
+        addiu $v0, $s5, 7
+        srl $v0, $v0, 3
+  _GSClear:
+        sb $zero, 0($s6)
+        addiu $s6, $s6, 1
+        addiu $v0, $v0, -1
+        bnez $v0, _GSClear
+        b _GSPage
+  _GSDone:
+        lw $a0, _freePages    # next time the heap has doubled
+        subu $a0, $s1, $a0
+        sll $a0, $a0, 1
+        li $a1, 64
+        bgeu $a0, $a1, _GSNext
+        move $a0, $a1
+  _GSNext:
+        sw $a0, _gcNext
+        lw $ra, 20($sp)
+        lw $s0, 4($sp)
+        lw $s1, 8($sp)
+        lw $s2, 12($sp)
+        lw $s3, 16($sp)
+        addiu $sp, $sp, 24
+        jr $ra
+
+	#  Size classes: next free slot, end of the page's slots, the list
+	#  of slots swept free, and the slot size. Code the compiler
+	#  inlines for New indexes this table by size / 4 and bumps the
+	#  first word itself; CodeGenerator::MaxInlineAllocSize and the
+	#  AllocClass constants in codegen/codegen.h describe this layout.
+        .data
+        .align 2
+        .globl _AllocClasses
+        _AllocClasses: .word 0, 0, 0, 0
+                       .word 0, 0, 0, 4
+                       .word 0, 0, 0, 8
+                       .word 0, 0, 0, 12
+                       .word 0, 0, 0, 16
+                       .word 0, 0, 0, 20
+                       .word 0, 0, 0, 24
+                       .word 0, 0, 0, 28
+                       .word 0, 0, 0, 32
+                       .word 0, 0, 0, 36
+                       .word 0, 0, 0, 40
+                       .word 0, 0, 0, 44
+                       .word 0, 0, 0, 48
+                       .word 0, 0, 0, 52
+                       .word 0, 0, 0, 56
+                       .word 0, 0, 0, 60
+                       .word 0, 0, 0, 64
+                       .word 0, 0, 0, 68
+                       .word 0, 0, 0, 72
+                       .word 0, 0, 0, 76
+                       .word 0, 0, 0, 80
+                       .word 0, 0, 0, 84
+                       .word 0, 0, 0, 88
+                       .word 0, 0, 0, 92
+                       .word 0, 0, 0, 96
+                       .word 0, 0, 0, 100
+                       .word 0, 0, 0, 104
+                       .word 0, 0, 0, 108
+                       .word 0, 0, 0, 112
+                       .word 0, 0, 0, 116
+                       .word 0, 0, 0, 120
+                       .word 0, 0, 0, 124
+                       .word 0, 0, 0, 128
+                       .word 0, 0, 0, 256
+                       .word 0, 0, 0, 512
+                       .word 0, 0, 0, 1024
+  _heapBase:    .word 0       # first page, 0 until first Alloc
+  _heapPages:   .word 0       # pages taken from sbrk so far
+  _heapEnd:     .word 0       # end of the memory from sbrk
+  _freePages:   .word 0       # pages freed by the collector
+  _gcOn:        .word 0       # set by GCInit
+  _gcGlobals:   .word 0       # bytes of globals at $gp
+  _gcStackTop:  .word 0       # $sp as main is called
+  _gcNext:      .word 64      # pages in use that start a collection
+  _gcCount:     .word 0       # collections so far
+  _gcScanned:   .word 0       # words they scanned
+  _gcLongest:   .word 0       # most in one of them
+  _gcLive:      .word 0       # bytes marked by the last one
+  _gcReport:    .word 0       # whether Halt reports them
+  _gcMarkLimit: .word 0       # lowest $sp for the mark stack
+  _gcLeftLo:    .word 0       # pages [lo, hi) hold every object
+  _gcLeftHi:    .word 0       # marked but left unscanned, if hi > 0
+  _gcWalking:   .word 0       # rescanning marked objects, from
+  _gcWalkPage:  .word 0       # this page
+  _gcWalkSlot:  .word 0       # and slot
+  _gcWalkEnd:   .word 0       # up to this page
+	#  What each page holds: 0 nothing, 1-35 slots of that class,
+	#  255 the start of a large object (253 once marked), 254 more
+	#  of one, 252 memory that is not the heap's.
+  _pageKinds:   .space 16384
+        .text
+
 	  
+	#  Output is kept in _outBuf and written out with one print_str
+	#  when it fills, before the program reads input, and when it
+	#  halts. _outLen bytes of it are in use; the byte past the end
+	#  is room for the null print_str needs.
+        .data
+        .align 2
+  _outLen:      .word 0
+  _outBuf:      .space 4097
+  _outDigits:   .space 12     # an int in decimal, sign and null
+        .text
+
+	#  Appends the string at $a0 to the output. Trashes a0-a3 and v0.
+  _OutStr:
+        lw $a1, _outLen
+        la $a3, _outBuf
+        addu $a1, $a1, $a3    # a1 = next free byte
+        addiu $a3, $a3, 4096  # a3 = end of buffer
+    _OSLoop:
+        lb $a2, ($a0)
+        beqz $a2, _OSDone
+        bne $a1, $a3, _OSPut
+        move $a2, $a0         # full: write it out and start over
+        sb $zero, ($a1)
+        la $a0, _outBuf
+        li $v0, 4             # 4 is code for print string syscall
+        syscall
+        move $a0, $a2
+        la $a1, _outBuf
+        j _OSLoop
+    _OSPut:
+        sb $a2, ($a1)
+        addiu $a0, $a0, 1
+        addiu $a1, $a1, 1
+        j _OSLoop
+    _OSDone:
+        la $a3, _outBuf
+        subu $a1, $a1, $a3
+        sw $a1, _outLen
+        jr $ra
+
+	#  Appends the int in $a0 to the output, in decimal. Negation
+	#  leaves the most negative int as it is, which divu still reads
+	#  right. Trashes a0-a3 and v0.
+  _OutInt:
+        la $a1, _outDigits
+        addiu $a1, $a1, 11
+        sb $zero, ($a1)
+        move $a3, $a0         # a3 keeps the sign
+        bgez $a0, _OIDigit
+        subu $a0, $zero, $a0
+    _OIDigit:
+        li $a2, 10
+        divu $a0, $a2
+        mfhi $v0
+        mflo $a0
+        addiu $v0, $v0, 48    # ASCII '0'
+        addiu $a1, $a1, -1
+        sb $v0, ($a1)
+        bnez $a0, _OIDigit
+        bgez $a3, _OIDone
+        li $v0, 45            # ASCII '-'
+        addiu $a1, $a1, -1
+        sb $v0, ($a1)
+    _OIDone:
+        move $a0, $a1
+        j _OutStr
+
+	#  Appends true or false to the output as $a0 is. Trashes a0-a3
+	#  and v0.
+  _OutBool:
+        .data
+        _trueStr:  .asciiz "true" # string constants for true/false
+        _falseStr: .asciiz "false"
+        .text
+        beqz $a0, _OBFalse
+        la $a0, _trueStr
+        j _OutStr
+    _OBFalse:
+        la $a0, _falseStr
+        j _OutStr
+
+	#  Writes out the output kept so far. Trashes a0, a1 and v0.
+  _OutFlush:
+        lw $a1, _outLen
+        beqz $a1, _OFDone
+        la $a0, _outBuf
+        addu $a1, $a0, $a1
+        sb $zero, ($a1)
+        li $v0, 4             # 4 is code for print string syscall
+        syscall
+        sw $zero, _outLen
+    _OFDone:
+        jr $ra
+
 	#  Library function PrintInt(int n)
 	#  --------------------------------
 	#  Prints number given as argument to console
 	.globl _PrintInt
   _PrintInt:
-        lw $a0, 4($sp)        # syscall expects arg in a0
-        li $v0, 1             # 1 is code for print int syscall
-        syscall
-        jr $ra
+        lw $a0, 4($sp)
+        j _OutInt
 
 	#  Library function PrintBool(bool b)
 	#  ----------------------------------
 	#  Prints true/false value given to console
 	.globl _PrintBool
   _PrintBool:
-        .data
-        _trueStr:  .asciiz "true" # string constants for true/false
-        _falseStr: .asciiz "false"
-        .text
         lw $a0, 4($sp)
-        li $v0, 4                # 4 is print string syscall
-        beqz $a0 _PBFalse
-        la $a0, _trueStr
-        syscall
-        jr $ra
-    _PBFalse:
-        la $a0, _falseStr
-        syscall
-        jr $ra
+        j _OutBool
 
 	#  Library function PrintString(address str)
 	#  -----------------------------------------
 	#  Prints string located at the address to console
 	.globl _PrintString
   _PrintString:
-        lw $a0, 4($sp)        # syscall expects arg in a0
-        li $v0, 4             # 4 is code for print string syscall
+        lw $a0, 4($sp)
+        j _OutStr
+
+	#  Library function Print(address kinds, ...)
+	#  ------------------------------------------
+	#  Prints the arguments after kinds, one for each of its letters:
+	#  i for an int, b for a bool and s for a string. The compiler
+	#  calls it for a Print statement of several arguments.
+	.globl _Print
+  _Print:
+        subu $sp, $sp, 16
+        sw $ra, 12($sp)
+        lw $a0, 20($sp)
+        sw $a0, 8($sp)        # 8(sp) = next kind
+        addiu $a0, $sp, 24
+        sw $a0, 4($sp)        # 4(sp) = its argument
+    _PNext:
+        lw $a1, 8($sp)
+        lb $a2, ($a1)
+        beqz $a2, _PDone
+        addiu $a1, $a1, 1
+        sw $a1, 8($sp)
+        lw $a1, 4($sp)
+        lw $a0, ($a1)
+        addiu $a1, $a1, 4
+        sw $a1, 4($sp)
+        li $a1, 105           # ASCII 'i'
+        beq $a2, $a1, _PInt
+        li $a1, 98            # ASCII 'b'
+        beq $a2, $a1, _PBool
+        jal _OutStr
+        j _PNext
+    _PInt:
+        jal _OutInt
+        j _PNext
+    _PBool:
+        jal _OutBool
+        j _PNext
+    _PDone:
+        lw $ra, 12($sp)
+        addiu $sp, $sp, 16
+        jr $ra
+
+	#  Input is read 4096 bytes at a time into _inBuf, of which
+	#  _inNext up to _inEnd is still to be taken.
+        .data
+        .align 2
+  _inNext:      .word 0
+  _inEnd:       .word 0
+  _inBuf:       .space 4096
+        .text
+
+	#  Refills the input with a read syscall, returning in $v0 the
+	#  bytes read, none at the end of input. Trashes a0-a2 and v0.
+  _InFill:
+        li $v0, 14            # 14 is code for read syscall
+        li $a0, 0             # from stdin
+        la $a1, _inBuf
+        li $a2, 4096
         syscall
+        sw $zero, _inNext
+        sw $zero, _inEnd
+        blez $v0, _IFDone
+        sw $v0, _inEnd
+    _IFDone:
+        jr $ra
+
+	#  Takes the next character of input into $v0, -1 at the end of
+	#  input. Trashes a0-a2 and v0.
+  _InChar:
+        lw $a0, _inNext
+        lw $a1, _inEnd
+        bne $a0, $a1, _ICHave
+        li $v0, 14            # empty: refill as _InFill does
+        li $a0, 0
+        la $a1, _inBuf
+        li $a2, 4096
+        syscall
+        sw $zero, _inNext
+        sw $zero, _inEnd
+        blez $v0, _ICEnd
+        sw $v0, _inEnd
+        li $a0, 0
+    _ICHave:
+        la $a1, _inBuf
+        addu $a1, $a1, $a0
+        lbu $v0, ($a1)
+        addiu $a0, $a0, 1
+        sw $a0, _inNext
+        jr $ra
+    _ICEnd:
+        li $v0, -1
         jr $ra
 
 	#  Library function n = ReadInteger()
 	#  ----------------------------------
-	#  Reads a number from the console and returns it in $v0
+	#  Reads a line from the console and returns the number it starts
+	#  with (after any blanks and a sign) in $v0, 0 if none
 	.globl _ReadInteger
   _ReadInteger:
-        li $v0, 5             # 5 is code for read int syscall
-        syscall
+        subu $sp, $sp, 12
+        sw $ra, 8($sp)
+        jal _OutFlush         # show any prompt first
+        sw $zero, 4($sp)      # 4(sp) = 1 if negative
+        li $a3, 0             # a3 = the number so far
+    _RIBlank:
+        jal _InChar
+        li $a0, 32            # ASCII ' '
+        beq $v0, $a0, _RIBlank
+        li $a0, 9             # ASCII tab
+        beq $v0, $a0, _RIBlank
+        li $a0, 45            # ASCII '-'
+        bne $v0, $a0, _RIPlus
+        li $a0, 1
+        sw $a0, 4($sp)
+        j _RINext
+    _RIPlus:
+        li $a0, 43            # ASCII '+'
+        bne $v0, $a0, _RIDigit
+    _RINext:
+        jal _InChar
+    _RIDigit:
+        addiu $a0, $v0, -48   # ASCII '0'
+        sltiu $a1, $a0, 10    # unsigned, so below '0' fails too
+        beqz $a1, _RIRest
+        sll $a1, $a3, 3       # a3 = 10 * a3 + digit
+        sll $a3, $a3, 1
+        addu $a3, $a3, $a1
+        addu $a3, $a3, $a0
+        j _RINext
+    _RIRest:
+        li $a0, 10            # drop the rest of the line
+        beq $v0, $a0, _RISigned
+        bltz $v0, _RISigned
+        jal _InChar
+        j _RIRest
+    _RISigned:
+        move $v0, $a3
+        lw $a0, 4($sp)
+        beqz $a0, _RIDone
+        subu $v0, $zero, $v0
+    _RIDone:
+        lw $ra, 8($sp)
+        addiu $sp, $sp, 12
         jr $ra
 
 	#  Library function s = ReadLine()
 	#  -------------------------------
-	#  Reads a line from the console into heap-allocated buffer and
-	#  returns its address in $v0
+	#  Reads a line from the console, however long, and returns its
+	#  address in $v0, without the newline, in a heap string of just
+	#  its size. A line that runs past the input buffer is gathered
+	#  a buffer at a time, each time into a string long enough for
+	#  all of it so far.
 	.globl _ReadLine
   _ReadLine:
-        li $a0, 64       # allocate space, fixed size 64
-        li $v0, 9        # make sbrk syscall
-        syscall
-        move $a0, $v0    # copy return value from sbrk as 1st arg
-        li $a1, 64       # push size of buffer
-        li $v0, 8        # read_string syscall
-        syscall
-        move $v0, $a0    # put result in v0
-                         # now go find \n and terminate over it
-    _RLLoopTop:
-        lb $a1, ($a0)           # use a1 to hold next char
-        beqz $a1, _RLLoopDone  # halt if find null terminator
-        addi $a1, $a1, -10      # subtract ASCII newline
-        beqz $a1, _RLLoopDone  # halt if find newline
-        addi $a0, $a0, 1        # advance by one
-        j _RLLoopTop
-   _RLLoopDone:
-        sb $a1, ($a0)           # store 0 over newline
+        subu $sp, $sp, 28
+        sw $ra, 24($sp)
+        sw $zero, 20($sp)     # 20(sp) = the line so far
+        sw $zero, 16($sp)     # 16(sp) = its length
+        jal _OutFlush         # show any prompt first
+    _RLChunk:
+        lw $a0, _inNext
+        lw $a1, _inEnd
+        bne $a0, $a1, _RLScan
+        jal _InFill
+        blez $v0, _RLEnd
+        lw $a0, _inNext
+        lw $a1, _inEnd
+    _RLScan:
+        la $a2, _inBuf
+        addu $a3, $a2, $a1    # a3 = end of input
+        addu $a0, $a2, $a0    # a0 = start of this piece
+        move $a1, $a0
+    _RLFind:
+        beq $a1, $a3, _RLPart
+        lbu $v0, ($a1)
+        addi $v0, $v0, -10    # subtract ASCII newline
+        beqz $v0, _RLLine
+        addiu $a1, $a1, 1
+        j _RLFind
+    _RLLine:
+        li $v0, 1
+        j _RLTake
+    _RLPart:
+        li $v0, 0
+    _RLTake:
+        sw $v0, 8($sp)        # 8(sp) = 1 if the piece ends the line
+        subu $a1, $a1, $a0
+        sw $a1, 12($sp)       # 12(sp) = its length
+        lw $a2, _inNext       # take it and any newline
+        addu $a2, $a2, $a1
+        addu $a2, $a2, $v0
+        sw $a2, _inNext
+        lw $a0, 16($sp)
+        addu $a0, $a0, $a1
+        addiu $a0, $a0, 1
+        sw $a0, 4($sp)
+        jal _Alloc
+        lw $a0, 20($sp)       # copy the line so far
+        lw $a2, 16($sp)
+        move $a1, $v0
+    _RLOld:
+        beqz $a2, _RLNew
+        lbu $a3, ($a0)
+        sb $a3, ($a1)
+        addiu $a0, $a0, 1
+        addiu $a1, $a1, 1
+        addiu $a2, $a2, -1
+        j _RLOld
+    _RLNew:
+        lw $a0, _inNext       # then the piece, still in the buffer
+        lw $a2, 12($sp)
+        subu $a0, $a0, $a2
+        lw $a3, 8($sp)
+        subu $a0, $a0, $a3
+        la $a3, _inBuf
+        addu $a0, $a0, $a3
+    _RLCopy:
+        beqz $a2, _RLCopied
+        lbu $a3, ($a0)
+        sb $a3, ($a1)
+        addiu $a0, $a0, 1
+        addiu $a1, $a1, 1
+        addiu $a2, $a2, -1
+        j _RLCopy
+    _RLCopied:
+        sb $zero, ($a1)
+        sw $v0, 20($sp)
+        lw $a0, 16($sp)
+        lw $a2, 12($sp)
+        addu $a0, $a0, $a2
+        sw $a0, 16($sp)
+        lw $a0, 8($sp)
+        beqz $a0, _RLChunk
+    _RLEnd:
+        lw $v0, 20($sp)
+        bnez $v0, _RLDone
+        li $a0, 1             # nothing before the end of input
+        sw $a0, 4($sp)
+        jal _Alloc
+    _RLDone:
+        lw $ra, 24($sp)
+        addiu $sp, $sp, 28
         jr $ra
 
 	  
@@ -296,10 +1291,33 @@ _Alloc:
 	#  ----------------------------------------------------
 	#  Compares two strings for equality (case-sensitive)
 	#  returns true/false in $v0
+	#  The same string, as pooled literals often are, is equal at
+	#  once. Word-aligned strings are compared a word at a time up
+	#  to the word holding the null, or to a word that differs,
+	#  which the byte loop then finishes.
 	.globl _StringEqual
  _StringEqual:
         lw $a0, 4($sp)
         lw $a2, 8($sp)
+        beq $a0, $a2, _SEmatch
+        or $a1, $a0, $a2
+        andi $a1, $a1, 3
+        bnez $a1, _SELoopTop      # not both aligned: bytes only
+        lui $v0, 0x0101
+        ori $v0, $v0, 0x0101      # 0x01010101
+    _SEWord:
+        lw $a1, ($a0)             # load next 2 words
+        lw $a3, ($a2)
+        bne $a1, $a3, _SELoopTop
+        subu $a3, $a1, $v0        # a null byte sets its top bit in
+        nor $a1, $a1, $zero       # (w - 0x01010101) & ~w & 0x80808080
+        and $a3, $a3, $a1
+        sll $a1, $v0, 7
+        and $a3, $a3, $a1
+        bnez $a3, _SEmatch        # return true if the word ends them
+        addi $a0, $a0, 4          # advance both by a word
+        addi $a2, $a2, 4
+        j _SEWord
     _SELoopTop:
         lb $a1, ($a0)              # load next 2 chars
         lb $a3, ($a2)              #
@@ -318,9 +1336,45 @@ _Alloc:
 
 	#  Library function Halt()
 	#  -----------------------
-	#  Exits process
+	#  Exits process, first reporting what the collector did if the
+	#  program was compiled with -g -d gc, and writing out the output
 	.globl _Halt
   _Halt:
+        lw $a0, _gcReport
+        beqz $a0, _HExit
+        .data
+        _gcStrCount:    .asciiz "GC: "
+        _gcStrScanned:  .asciiz " collections, "
+        _gcStrLongest:  .asciiz " words scanned, longest "
+        _gcStrHeap:     .asciiz "; heap "
+        _gcStrLive:     .asciiz " bytes, "
+        _gcStrEnd:      .asciiz " live\n"
+        .text
+        la $a0, _gcStrCount
+        jal _OutStr
+        lw $a0, _gcCount
+        jal _OutInt
+        la $a0, _gcStrScanned
+        jal _OutStr
+        lw $a0, _gcScanned
+        jal _OutInt
+        la $a0, _gcStrLongest
+        jal _OutStr
+        lw $a0, _gcLongest
+        jal _OutInt
+        la $a0, _gcStrHeap
+        jal _OutStr
+        lw $a0, _heapPages
+        sll $a0, $a0, 12
+        jal _OutInt
+        la $a0, _gcStrLive
+        jal _OutStr
+        lw $a0, _gcLive
+        jal _OutInt
+        la $a0, _gcStrEnd
+        jal _OutStr
+  _HExit:
+        jal _OutFlush
 	li $v0, 10			  # 10 is code for exit syscall
 	syscall
 
@@ -1,32 +1,60 @@
 #!/usr/bin/env python
 
 import os
+import sys
 from subprocess import *
 
 TEST_DIRECTORY = 'test/codegen'
 EXCEPTION_FILE = 'etc/exceptions.s'
+X86_LIBRARY = 'arch/x86/libdecaf.s'
+
+# Run as "test-codegen.py x86" to build the tests natively with
+# -target x86 instead of running them under spim.
+def run_command(target):
+  if target == 'x86':
+    return ('as --32 -o tmp.o tmp.asm && '
+            'ld -m elf_i386 -o tmp.bin tmp.o libdecaf.o && ./tmp.bin')
+  return 'spim -exception_file ' + EXCEPTION_FILE + ' -file tmp.asm'
 
 def main():
   total_tests = 0
   passed_tests = 0
-  print "=== Codegen tests ==="
+  target = sys.argv[1] if len(sys.argv) > 1 else 'mips'
+  print "=== Codegen tests (%s) ===" % target
+  if target == 'x86':
+    Popen('as --32 -o libdecaf.o ' + X86_LIBRARY, shell = True).wait()
   for _, _, files in os.walk(TEST_DIRECTORY):
     for file in files:
       if not (file.endswith('.decaf')):
         continue
+      # A test may give extra options for dcc in a .flags file
+      flags = ''
+      flags_name = os.path.join(TEST_DIRECTORY, "%s.flags" % file.split('.')[0])
+      if os.path.exists(flags_name):
+        flags = open(flags_name).read().strip() + ' '
+      # The garbage collector is only in the MIPS runtime
+      if target == 'x86' and '-g' in flags.split():
+        continue
+      # Output only one target can produce, such as a native fault,
+      # is expected in a .<target>.out file and not run on the other
+      ref_name = os.path.join(TEST_DIRECTORY, "%s.%s.out" %
+                              (file.split('.')[0], target))
+      if not os.path.exists(ref_name):
+        ref_name = os.path.join(TEST_DIRECTORY, "%s.out" % file.split('.')[0])
+      if not os.path.exists(ref_name):
+        continue
       total_tests += 1
-      ref_name = os.path.join(TEST_DIRECTORY, "%s.out" % file.split('.')[0])
       test_name = os.path.join(TEST_DIRECTORY, file)
-      result = Popen('./dcc ' + test_name + ' -o tmp.asm', 
-                     shell = True, stderr = STDOUT)
+      result = Popen('./dcc -target ' + target + ' ' + flags + test_name +
+                     ' -o tmp.asm', shell = True, stderr = STDOUT)
       result.wait()
      
       input_name = os.path.join(TEST_DIRECTORY, "%s.in" % file.split('.')[0])
       if os.path.exists(input_name):
-        result = Popen('spim -exception_file ' + EXCEPTION_FILE + ' -file tmp.asm < ' + input_name,
+        result = Popen(run_command(target) + ' < ' + input_name,
                        shell = True, stderr = STDOUT, stdout = PIPE)
       else:
-        result = Popen('spim -exception_file ' + EXCEPTION_FILE + ' -file tmp.asm',
+        result = Popen(run_command(target),
                        shell = True, stderr = STDOUT, stdout = PIPE)
       
       result = Popen('diff -w - ' + ref_name, 